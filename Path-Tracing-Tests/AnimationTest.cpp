@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "SceneGraph.h"
+
+using namespace PathTracingTests;
+
+using Sequence = PathTracing::AnimationNode::Sequence<glm::vec3>;
+
+namespace
+{
+
+Sequence CreateSequence()
+{
+    Sequence sequence;
+    sequence.AddKey(glm::vec3(0.0f), 1.0f);
+    sequence.AddKey(glm::vec3(2.0f), 2.0f);
+    sequence.AddKey(glm::vec3(4.0f), 4.0f);
+    return sequence;
+}
+
+// A child of the root moves along the x axis from 0 to 2 in the first 2 of 4 seconds
+PathTracing::SceneGraph CreateSceneGraph()
+{
+    PathTracing::AnimationNode node = { .SceneNodeIndex = 1 };
+    node.Positions.AddKey(glm::vec3(0.0f), 0.0f);
+    node.Positions.AddKey(glm::vec3(2.0f, 0.0f, 0.0f), 2.0f);
+    node.Rotations.AddKey(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 0.0f);
+    node.Scales.AddKey(glm::vec3(1.0f), 0.0f);
+
+    std::vector<PathTracing::SceneNode> sceneNodes = {
+        PathTracing::SceneNode { 0, glm::mat4(1.0f) },
+        PathTracing::SceneNode { 0, glm::mat4(1.0f) },
+    };
+    std::vector<PathTracing::Animation> animations;
+    animations.push_back({ .Nodes = { node }, .TickPerSecond = 1.0f, .Duration = 4.0f });
+
+    return PathTracing::SceneGraph(std::move(sceneNodes), { true, true }, std::move(animations));
+}
+
+float GetPositionX(const PathTracing::SceneGraph &sceneGraph)
+{
+    // Transforms are stored transposed, the translation is the last column of the rows
+    return sceneGraph.GetTransforms()[1][0][3];
+}
+
+}
+
+TEST(AnimationTest, FindKeyAtBoundaries)
+{
+    Sequence sequence = CreateSequence();
+
+    EXPECT_EQ(sequence.FindKey(1.0f), 0);
+    EXPECT_EQ(sequence.FindKey(2.0f), 1);
+    EXPECT_EQ(sequence.FindKey(4.0f), 2);
+
+    EXPECT_EQ(sequence.FindKey(1.5f), 0);
+    EXPECT_EQ(sequence.FindKey(3.9f), 1);
+}
+
+TEST(AnimationTest, FindKeyOutsideKeys)
+{
+    Sequence sequence = CreateSequence();
+
+    EXPECT_EQ(sequence.FindKey(0.0f), 0);
+    EXPECT_EQ(sequence.FindKey(10.0f), 2);
+    EXPECT_EQ(sequence.FindKey(-1.0f), 0);
+}
+
+TEST(AnimationTest, FindKeyAfterSeeking)
+{
+    Sequence sequence = CreateSequence();
+
+    // Playing forward moves one key at a time, seeking backwards has to search again
+    for (float tick = 1.0f; tick < 5.0f; tick += 0.25f)
+        EXPECT_EQ(sequence.FindKey(tick), tick < 2.0f ? 0 : tick < 4.0f ? 1 : 2);
+
+    EXPECT_EQ(sequence.FindKey(1.0f), 0);
+    EXPECT_EQ(sequence.FindKey(4.5f), 2);
+    EXPECT_EQ(sequence.FindKey(2.5f), 1);
+}
+
+TEST(AnimationTest, SampleOutsideKeys)
+{
+    Sequence sequence = CreateSequence();
+
+    EXPECT_EQ(sequence.Sample(0.0f), glm::vec3(0.0f));
+    EXPECT_EQ(sequence.Sample(1.0f), glm::vec3(0.0f));
+    EXPECT_EQ(sequence.Sample(1.5f), glm::vec3(1.0f));
+    EXPECT_EQ(sequence.Sample(3.0f), glm::vec3(3.0f));
+    EXPECT_EQ(sequence.Sample(4.0f), glm::vec3(4.0f));
+    EXPECT_EQ(sequence.Sample(10.0f), glm::vec3(4.0f));
+}
+
+TEST(AnimationTest, SeekSceneGraph)
+{
+    PathTracing::SceneGraph sceneGraph = CreateSceneGraph();
+
+    EXPECT_TRUE(sceneGraph.Seek(1.0f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 1.0f);
+
+    // After the last key the node holds its last position
+    EXPECT_TRUE(sceneGraph.Seek(3.0f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 2.0f);
+    EXPECT_FALSE(sceneGraph.Seek(3.5f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 2.0f);
+
+    // Times wrap around the duration in both directions
+    EXPECT_TRUE(sceneGraph.Seek(4.5f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 0.5f);
+    EXPECT_TRUE(sceneGraph.Seek(-1.0f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 2.0f);
+
+    EXPECT_TRUE(sceneGraph.Seek(0.0f));
+    EXPECT_FLOAT_EQ(GetPositionX(sceneGraph), 0.0f);
+    EXPECT_FLOAT_EQ(sceneGraph.GetTime(), 0.0f);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "Scene.h"
+
+using namespace PathTracingTests;
+
+using PathTracing::Geometry;
+using PathTracing::SceneBuilder;
+
+namespace
+{
+
+// Appends a quad at the given depth and returns a geometry covering it
+Geometry AddQuad(SceneBuilder &sceneBuilder, float depth, bool isOpaque = true)
+{
+    auto &vertices = sceneBuilder.GetVertices();
+    auto &indices = sceneBuilder.GetIndices();
+
+    const Geometry geometry = {
+        .VertexOffset = static_cast<uint32_t>(vertices.size()),
+        .VertexLength = 4,
+        .IndexOffset = static_cast<uint32_t>(indices.size()),
+        .IndexLength = 6,
+        .IsOpaque = isOpaque,
+        .IsAnimated = false,
+    };
+
+    const std::array corners = {
+        glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f), glm::vec2(0.0f, 1.0f),
+    };
+    for (glm::vec2 corner : corners)
+        vertices.push_back(PathTracing::Shaders::Vertex {
+            .Position = glm::vec3(corner, depth),
+            .TexCoords = corner,
+            .Normal = glm::vec3(0.0f, 0.0f, 1.0f),
+            .Tangent = glm::vec3(1.0f, 0.0f, 0.0f),
+            .Bitangent = glm::vec3(0.0f, 1.0f, 0.0f),
+        });
+    indices.insert(indices.end(), { 0, 1, 2, 0, 2, 3 });
+
+    return geometry;
+}
+
+uint32_t AddIndexedGeometry(
+    SceneBuilder &sceneBuilder, uint32_t vertexCount, std::span<const uint32_t> geometryIndices
+)
+{
+    auto &vertices = sceneBuilder.GetVertices();
+    auto &indices = sceneBuilder.GetIndices();
+
+    Geometry geometry = {
+        .VertexOffset = static_cast<uint32_t>(vertices.size()),
+        .VertexLength = vertexCount,
+        .IndexOffset = static_cast<uint32_t>(indices.size()),
+        .IndexLength = static_cast<uint32_t>(geometryIndices.size()),
+        .IsOpaque = true,
+        .IsAnimated = false,
+    };
+
+    for (uint32_t i = 0; i < vertexCount; i++)
+        vertices.push_back(PathTracing::Shaders::Vertex { .Position = glm::vec3(static_cast<float>(i)) });
+    indices.insert(indices.end(), geometryIndices.begin(), geometryIndices.end());
+
+    return sceneBuilder.AddGeometry(std::move(geometry));
+}
+
+}
+
+TEST(SceneBuilderTest, DuplicateGeometryIsMerged)
+{
+    SceneBuilder sceneBuilder;
+
+    bool isDuplicate = true;
+    const uint32_t first = sceneBuilder.AddGeometry(AddQuad(sceneBuilder, 0.0f), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+
+    const uint32_t second = sceneBuilder.AddGeometry(AddQuad(sceneBuilder, 0.0f), &isDuplicate);
+    EXPECT_TRUE(isDuplicate);
+    EXPECT_EQ(first, second);
+}
+
+TEST(SceneBuilderTest, DifferentGeometryIsKept)
+{
+    SceneBuilder sceneBuilder;
+
+    bool isDuplicate = true;
+    const uint32_t first = sceneBuilder.AddGeometry(AddQuad(sceneBuilder, 0.0f), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+
+    const uint32_t moved = sceneBuilder.AddGeometry(AddQuad(sceneBuilder, 1.0f), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+    EXPECT_NE(first, moved);
+
+    // Same content, but the geometry is not opaque so hits run the any hit shader
+    const uint32_t transparent = sceneBuilder.AddGeometry(AddQuad(sceneBuilder, 0.0f, false), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+    EXPECT_NE(first, transparent);
+    EXPECT_NE(moved, transparent);
+}
+
+TEST(SceneBuilderTest, AnimatedGeometryIsNotMerged)
+{
+    SceneBuilder sceneBuilder;
+    const Geometry geometry = { 0, 4, 0, 6, true, true };
+
+    bool isDuplicate = true;
+    const uint32_t first = sceneBuilder.AddGeometry(Geometry(geometry), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+
+    const uint32_t second = sceneBuilder.AddGeometry(Geometry(geometry), &isDuplicate);
+    EXPECT_FALSE(isDuplicate);
+    EXPECT_NE(first, second);
+}
+
+TEST(SceneBuilderTest, ShortIndicesArePacked)
+{
+    SceneBuilder sceneBuilder;
+
+    // Odd index counts leave the high half of the last word empty
+    const std::array<uint32_t, 3> triangle = { 2, 0, 1 };
+    const std::array<uint32_t, 6> quad = { 0, 1, 2, 0, 2, 3 };
+    const uint32_t triangleIndex = AddIndexedGeometry(sceneBuilder, 3, triangle);
+    const uint32_t quadIndex = AddIndexedGeometry(sceneBuilder, 4, quad);
+
+    auto scene = sceneBuilder.CreateSceneShared("Short Indices");
+    const auto geometries = scene->GetGeometries();
+    const std::vector<uint32_t> expected = { 2 | 0 << 16, 1, 0 | 1 << 16, 2 | 0 << 16, 2 | 3 << 16 };
+
+    EXPECT_TRUE(geometries[triangleIndex].HasShortIndices);
+    EXPECT_EQ(geometries[triangleIndex].IndexOffset, 0);
+    EXPECT_EQ(geometries[triangleIndex].IndexLength, triangle.size());
+
+    EXPECT_TRUE(geometries[quadIndex].HasShortIndices);
+    EXPECT_EQ(geometries[quadIndex].IndexOffset, 2);
+    EXPECT_EQ(geometries[quadIndex].IndexLength, quad.size());
+
+    EXPECT_EQ(std::vector<uint32_t>(scene->GetIndices().begin(), scene->GetIndices().end()), expected);
+}
+
+TEST(SceneBuilderTest, LongIndicesAreKept)
+{
+    SceneBuilder sceneBuilder;
+
+    // The largest geometry with short indices is followed by the smallest one that needs full indices
+    const uint32_t shortVertexCount = SceneBuilder::MaxShortIndexVertexCount;
+    const std::array<uint32_t, 3> shortTriangle = { 0, shortVertexCount - 1, 1 };
+    const std::array<uint32_t, 3> longTriangle = { 0, shortVertexCount, 1 };
+    const uint32_t shortIndex = AddIndexedGeometry(sceneBuilder, shortVertexCount, shortTriangle);
+    const uint32_t longIndex = AddIndexedGeometry(sceneBuilder, shortVertexCount + 1, longTriangle);
+
+    auto scene = sceneBuilder.CreateSceneShared("Long Indices");
+    const auto geometries = scene->GetGeometries();
+    const std::vector<uint32_t> expected = { 0 | (shortVertexCount - 1) << 16, 1, 0, shortVertexCount, 1 };
+
+    EXPECT_TRUE(geometries[shortIndex].HasShortIndices);
+    EXPECT_EQ(geometries[shortIndex].IndexOffset, 0);
+
+    EXPECT_FALSE(geometries[longIndex].HasShortIndices);
+    EXPECT_EQ(geometries[longIndex].IndexOffset, 2);
+    EXPECT_EQ(geometries[longIndex].IndexLength, longTriangle.size());
+
+    EXPECT_EQ(std::vector<uint32_t>(scene->GetIndices().begin(), scene->GetIndices().end()), expected);
+}
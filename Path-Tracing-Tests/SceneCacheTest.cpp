@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Application.h"
+#include "SceneCache.h"
+
+using namespace PathTracingTests;
+
+using PathTracing::SceneBuilder;
+using PathTracing::SceneCache;
+
+namespace
+{
+
+const std::filesystem::path TestDirectory =
+    std::filesystem::temp_directory_path() / "Path-Tracing-Tests" / "SceneCache";
+const std::filesystem::path ScenePath = TestDirectory / "scene.gltf";
+const std::filesystem::path DependencyPath = TestDirectory / "scene.bin";
+
+void WriteFile(const std::filesystem::path &path, const std::string &content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+// One animated node with a light and an instance of a quad with two meshes
+void FillScene(SceneBuilder &sceneBuilder)
+{
+    auto &vertices = sceneBuilder.GetVertices();
+    auto &indices = sceneBuilder.GetIndices();
+
+    const std::array corners = {
+        glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f), glm::vec2(0.0f, 1.0f),
+    };
+    for (glm::vec2 corner : corners)
+        vertices.push_back(PathTracing::Shaders::Vertex {
+            .Position = glm::vec3(corner, 0.0f),
+            .TexCoords = corner,
+            .Normal = glm::vec3(0.0f, 0.0f, 1.0f),
+            .Tangent = glm::vec3(1.0f, 0.0f, 0.0f),
+            .Bitangent = glm::vec3(0.0f, 1.0f, 0.0f),
+        });
+    indices.insert(indices.end(), { 0, 1, 2, 0, 2, 3 });
+
+    const uint32_t geometryIndex = sceneBuilder.AddGeometry({ 0, 4, 0, 6, true, false });
+    const PathTracing::Shaders::MaterialId materialId = sceneBuilder.AddMaterial(
+        "Material", PathTracing::Shaders::MetallicRoughnessMaterial { .Color = glm::vec4(0.5f), .Ior = 1.5f }
+    );
+
+    const std::array<PathTracing::MeshInfo, 2> meshInfos = {
+        PathTracing::MeshInfo { geometryIndex, materialId, PathTracing::MaterialType::MetallicRoughness,
+                                glm::mat3x4(1.0f) },
+        PathTracing::MeshInfo { geometryIndex, materialId, PathTracing::MaterialType::MetallicRoughness,
+                                glm::mat3x4(2.0f) },
+    };
+    const uint32_t modelIndex = sceneBuilder.AddModel(meshInfos);
+
+    const uint32_t nodeIndex = sceneBuilder.AddSceneNode(
+        { SceneBuilder::RootNodeIndex, glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f)) }
+    );
+    sceneBuilder.AddModelInstance(modelIndex, nodeIndex);
+    sceneBuilder.AddLight(
+        { .Color = glm::vec3(1.0f), .Position = glm::vec3(0.0f, 1.0f, 0.0f), .AttenuationConstant = 1.0f },
+        nodeIndex
+    );
+
+    PathTracing::AnimationNode animationNode = { .SceneNodeIndex = nodeIndex };
+    animationNode.Positions.AddKey(glm::vec3(0.0f), 0.0f);
+    animationNode.Positions.AddKey(glm::vec3(1.0f), 1.0f);
+    animationNode.Rotations.AddKey(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 0.0f);
+    animationNode.Scales.AddKey(glm::vec3(1.0f), 0.0f);
+    sceneBuilder.AddAnimation({
+        .Nodes = { std::move(animationNode) },
+        .TickPerSecond = 1.0f,
+        .Duration = 1.0f,
+    });
+}
+
+// The cache file name is a hash of the scene paths, the cache directory only holds the test scene
+std::filesystem::path FindCacheFile()
+{
+    const auto &config = PathTracing::Application::GetConfig();
+    const std::string extension = "." + config.SceneCacheExtension.string();
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(config.SceneCachePath))
+        paths.push_back(entry.path());
+
+    if (paths.size() != 1 || paths.front().extension() != extension)
+        return {};
+    return paths.front();
+}
+
+void SaveScene()
+{
+    WriteFile(DependencyPath, "buffer");
+
+    SceneBuilder sceneBuilder;
+    FillScene(sceneBuilder);
+
+    const std::array paths = { ScenePath };
+    const std::array dependencies = { DependencyPath };
+    SceneCache::Save(sceneBuilder, paths, std::monostate(), dependencies);
+}
+
+bool LoadScene(SceneBuilder &sceneBuilder)
+{
+    const std::array paths = { ScenePath };
+    return SceneCache::Load(sceneBuilder, paths, std::monostate());
+}
+
+class SceneCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        const auto &config = PathTracing::Application::GetConfig();
+        if (!config.CacheScenes)
+            GTEST_SKIP() << "Scene cache is disabled";
+
+        // The test application keeps its cache in the test directory, which is cleared for every test
+        ASSERT_EQ(config.SceneCachePath.parent_path(), TestDirectory);
+        std::filesystem::remove_all(TestDirectory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(TestDirectory);
+    }
+};
+
+}
+
+TEST_F(SceneCacheTest, RoundTrip)
+{
+    SaveScene();
+    ASSERT_FALSE(FindCacheFile().empty());
+
+    SceneBuilder expectedBuilder, loadedBuilder;
+    FillScene(expectedBuilder);
+    ASSERT_TRUE(LoadScene(loadedBuilder));
+
+    ASSERT_EQ(expectedBuilder.GetVertices().size(), loadedBuilder.GetVertices().size());
+    EXPECT_EQ(
+        std::memcmp(
+            expectedBuilder.GetVertices().data(), loadedBuilder.GetVertices().data(),
+            expectedBuilder.GetVertices().size() * sizeof(PathTracing::Shaders::Vertex)
+        ),
+        0
+    );
+    EXPECT_EQ(expectedBuilder.GetIndices(), loadedBuilder.GetIndices());
+
+    auto expected = expectedBuilder.CreateSceneShared("Expected");
+    auto loaded = loadedBuilder.CreateSceneShared("Loaded");
+
+    ASSERT_EQ(expected->GetGeometries().size(), loaded->GetGeometries().size());
+    for (int i = 0; i < expected->GetGeometries().size(); i++)
+    {
+        const auto &expectedGeometry = expected->GetGeometries()[i];
+        const auto &loadedGeometry = loaded->GetGeometries()[i];
+        EXPECT_EQ(expectedGeometry.VertexOffset, loadedGeometry.VertexOffset);
+        EXPECT_EQ(expectedGeometry.VertexLength, loadedGeometry.VertexLength);
+        EXPECT_EQ(expectedGeometry.IndexOffset, loadedGeometry.IndexOffset);
+        EXPECT_EQ(expectedGeometry.IndexLength, loadedGeometry.IndexLength);
+        EXPECT_EQ(expectedGeometry.IsOpaque, loadedGeometry.IsOpaque);
+        EXPECT_EQ(expectedGeometry.IsAnimated, loadedGeometry.IsAnimated);
+    }
+
+    ASSERT_EQ(expected->GetModels().size(), loaded->GetModels().size());
+    for (int i = 0; i < expected->GetModels().size(); i++)
+    {
+        const auto &expectedMeshes = expected->GetModels()[i].Meshes;
+        const auto &loadedMeshes = loaded->GetModels()[i].Meshes;
+        ASSERT_EQ(expectedMeshes.size(), loadedMeshes.size());
+        for (int j = 0; j < expectedMeshes.size(); j++)
+        {
+            EXPECT_EQ(expectedMeshes[j].GeometryIndex, loadedMeshes[j].GeometryIndex);
+            EXPECT_EQ(expectedMeshes[j].MaterialIndex, loadedMeshes[j].MaterialIndex);
+            EXPECT_EQ(expectedMeshes[j].TransformBufferOffset, loadedMeshes[j].TransformBufferOffset);
+        }
+    }
+
+    ASSERT_EQ(expected->GetModelInstances().size(), loaded->GetModelInstances().size());
+    for (int i = 0; i < expected->GetModelInstances().size(); i++)
+        EXPECT_EQ(expected->GetModelInstances()[i].Transform, loaded->GetModelInstances()[i].Transform);
+
+    EXPECT_EQ(expected->GetTransforms().size(), loaded->GetTransforms().size());
+    EXPECT_EQ(
+        expected->GetMetallicRoughnessMaterials().size(), loaded->GetMetallicRoughnessMaterials().size()
+    );
+    EXPECT_EQ(expected->GetPointLights().size(), loaded->GetPointLights().size());
+    EXPECT_EQ(expected->HasAnimations(), loaded->HasAnimations());
+}
+
+TEST_F(SceneCacheTest, TruncatedFile)
+{
+    SaveScene();
+    const std::filesystem::path cachePath = FindCacheFile();
+    ASSERT_FALSE(cachePath.empty());
+    const uintmax_t fileSize = std::filesystem::file_size(cachePath);
+
+    const std::array<uintmax_t, 3> sizes = { sizeof(uint32_t), fileSize / 2, fileSize - 1 };
+    for (uintmax_t size : sizes)
+    {
+        SaveScene();
+        std::filesystem::resize_file(cachePath, size);
+
+        // A rejected file must leave the builder untouched
+        SceneBuilder sceneBuilder;
+        sceneBuilder.GetIndices().push_back(7);
+        EXPECT_FALSE(LoadScene(sceneBuilder)) << "Truncated to " << size << " bytes";
+        EXPECT_EQ(sceneBuilder.GetIndices(), std::vector<uint32_t> { 7 });
+    }
+}
+
+TEST_F(SceneCacheTest, ChangedDependency)
+{
+    SaveScene();
+    WriteFile(DependencyPath, "changed buffer");
+
+    SceneBuilder sceneBuilder;
+    EXPECT_FALSE(LoadScene(sceneBuilder));
+}
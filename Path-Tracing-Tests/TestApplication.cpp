@@ -1,5 +1,6 @@
 #include <vulkan/vulkan.hpp>
 
+#include <filesystem>
 #include <ranges>
 #include <string_view>
 
@@ -88,6 +89,10 @@ void Application::Init(int argc, const char *argv[])
     s_Config = Config::Create(argc, argv);
     SetupLogger();
 
+    // Scene cache tests write and truncate cache files, which must not touch the caches of the application
+    s_Config.SceneCachePath =
+        std::filesystem::temp_directory_path() / "Path-Tracing-Tests" / "SceneCache" / "Cache";
+
     uint32_t version = vk::enumerateInstanceVersion();
 
     uint32_t variant = vk::apiVersionVariant(version);
@@ -0,0 +1,36 @@
+#include "Core/Input.h"
+
+namespace PathTracing
+{
+
+GLFWwindow *Input::s_Window = nullptr;
+
+void Input::SetWindow(GLFWwindow *window)
+{
+    s_Window = window;
+}
+
+void Input::LockCursor()
+{
+}
+
+void Input::UnlockCursor()
+{
+}
+
+bool Input::IsKeyPressed(Key key)
+{
+    return false;
+}
+
+bool Input::IsMouseButtonPressed(MouseButton mouseButton)
+{
+    return false;
+}
+
+glm::vec2 Input::GetMousePosition()
+{
+    return glm::vec2(0.0f);
+}
+
+}
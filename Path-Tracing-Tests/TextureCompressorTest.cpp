@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "TextureCompressor.h"
+
+using namespace PathTracingTests;
+
+using PathTracing::TextureCompressor;
+using PathTracing::TextureFormat;
+
+namespace
+{
+
+using Texels = std::array<glm::u8vec4, 16>;
+
+glm::vec3 FromRgb565(uint16_t color)
+{
+    const uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// Reference decoders following the BC1 and BC4 block layouts, both modes are decoded
+std::array<glm::vec3, 16> DecodeColorBlock(const std::byte *block)
+{
+    uint16_t color0, color1;
+    uint32_t indices;
+    std::memcpy(&color0, block, sizeof(uint16_t));
+    std::memcpy(&color1, block + 2, sizeof(uint16_t));
+    std::memcpy(&indices, block + 4, sizeof(uint32_t));
+
+    const glm::vec3 endpoint0 = FromRgb565(color0), endpoint1 = FromRgb565(color1);
+    std::array<glm::vec3, 4> palette = {
+        endpoint0,
+        endpoint1,
+        (endpoint0 * 2.0f + endpoint1) / 3.0f,
+        (endpoint0 + endpoint1 * 2.0f) / 3.0f,
+    };
+    if (color0 <= color1)
+    {
+        palette[2] = (endpoint0 + endpoint1) / 2.0f;
+        palette[3] = glm::vec3(0.0f);
+    }
+
+    std::array<glm::vec3, 16> colors;
+    for (uint32_t i = 0; i < colors.size(); i++)
+        colors[i] = palette[(indices >> (2 * i)) & 3];
+    return colors;
+}
+
+std::array<float, 16> DecodeChannelBlock(const std::byte *block)
+{
+    const float value0 = std::to_integer<uint8_t>(block[0]), value1 = std::to_integer<uint8_t>(block[1]);
+
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; i++)
+        indices |= std::to_integer<uint64_t>(block[2 + i]) << (8 * i);
+
+    std::array<float, 8> palette = { value0, value1, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 255.0f };
+    if (value0 > value1)
+        for (uint32_t i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+    else
+        for (uint32_t i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5.0f;
+
+    std::array<float, 16> values;
+    for (uint32_t i = 0; i < values.size(); i++)
+        values[i] = palette[(indices >> (3 * i)) & 7];
+    return values;
+}
+
+float GetMaxColorError(const Texels &texels, const std::byte *block)
+{
+    const std::array<glm::vec3, 16> colors = DecodeColorBlock(block);
+
+    float error = 0.0f;
+    for (uint32_t i = 0; i < texels.size(); i++)
+        for (uint32_t channel = 0; channel < 3; channel++)
+            error = std::max(error, std::abs(colors[i][channel] - texels[i][channel]));
+    return error;
+}
+
+float GetMaxChannelError(const Texels &texels, uint32_t channel, const std::byte *block)
+{
+    const std::array<float, 16> values = DecodeChannelBlock(block);
+
+    float error = 0.0f;
+    for (uint32_t i = 0; i < texels.size(); i++)
+        error = std::max(error, std::abs(values[i] - texels[i][channel]));
+    return error;
+}
+
+std::vector<std::byte> Compress(TextureFormat format, const Texels &texels)
+{
+    std::vector<std::byte> blocks(TextureCompressor::GetCompressedSize(format, 4, 4));
+    TextureCompressor::Compress(format, texels, 4, 4, blocks);
+    return blocks;
+}
+
+// Colors along a line through the RGB cube, alpha falls while the colors rise
+Texels CreateGradientBlock()
+{
+    Texels texels;
+    for (uint32_t i = 0; i < texels.size(); i++)
+        texels[i] = glm::u8vec4(16 + 14 * i, 200 - 8 * i, 64 + 4 * i, 255 - 12 * i);
+    return texels;
+}
+
+}
+
+// Quantizing an endpoint to 5 bits moves it by at most half of a step of 255 / 31
+static constexpr float EndpointError = 4.5f;
+
+TEST(TextureCompressorTest, CompressedSize)
+{
+    EXPECT_EQ(TextureCompressor::GetCompressedSize(TextureFormat::BC1, 4, 4), 8u);
+    EXPECT_EQ(TextureCompressor::GetCompressedSize(TextureFormat::BC1, 5, 3), 16u);
+    EXPECT_EQ(TextureCompressor::GetCompressedSize(TextureFormat::BC3, 5, 3), 32u);
+    EXPECT_EQ(TextureCompressor::GetCompressedSize(TextureFormat::BC5, 8, 8), 64u);
+}
+
+TEST(TextureCompressorTest, BC1UniformBlock)
+{
+    Texels texels;
+    texels.fill(glm::u8vec4(200, 100, 50, 255));
+
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC1, texels);
+    EXPECT_LE(GetMaxColorError(texels, blocks.data()), EndpointError);
+}
+
+TEST(TextureCompressorTest, BC1TwoColorBlock)
+{
+    Texels texels;
+    for (uint32_t i = 0; i < texels.size(); i++)
+        texels[i] = i % 3 == 0 ? glm::u8vec4(255, 0, 0, 255) : glm::u8vec4(0, 0, 255, 255);
+
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC1, texels);
+    EXPECT_LE(GetMaxColorError(texels, blocks.data()), EndpointError);
+}
+
+TEST(TextureCompressorTest, BC1GradientBlock)
+{
+    const Texels texels = CreateGradientBlock();
+
+    // 4 palette entries cover the 16 texels, so each texel is at most half an interval away
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC1, texels);
+    EXPECT_LE(GetMaxColorError(texels, blocks.data()), 14.0f * 15.0f / 6.0f + EndpointError);
+}
+
+TEST(TextureCompressorTest, BC3GradientBlock)
+{
+    const Texels texels = CreateGradientBlock();
+
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC3, texels);
+    EXPECT_LE(GetMaxChannelError(texels, 3, blocks.data()), 12.0f * 15.0f / 14.0f + 0.5f);
+    EXPECT_LE(GetMaxColorError(texels, blocks.data() + 8), 14.0f * 15.0f / 6.0f + EndpointError);
+}
+
+TEST(TextureCompressorTest, BC5GradientBlock)
+{
+    const Texels texels = CreateGradientBlock();
+
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC5, texels);
+    EXPECT_LE(GetMaxChannelError(texels, 0, blocks.data()), 14.0f * 15.0f / 14.0f + 0.5f);
+    EXPECT_LE(GetMaxChannelError(texels, 1, blocks.data() + 8), 8.0f * 15.0f / 14.0f + 0.5f);
+}
+
+TEST(TextureCompressorTest, BC5ExactChannels)
+{
+    // Channels with at most 8 distinct values on the palette of their endpoints are encoded exactly
+    Texels texels;
+    for (uint32_t i = 0; i < texels.size(); i++)
+        texels[i] = glm::u8vec4(10 + 7 * (i % 8), 255 - 35 * (i % 8), 0, 255);
+
+    const std::vector<std::byte> blocks = Compress(TextureFormat::BC5, texels);
+    EXPECT_LE(GetMaxChannelError(texels, 0, blocks.data()), 0.0f);
+    EXPECT_LE(GetMaxChannelError(texels, 1, blocks.data() + 8), 0.0f);
+}
+
+TEST(TextureCompressorTest, PartialBlock)
+{
+    // Blocks crossing the image edge repeat the edge texels instead of reading past the image
+    std::array<glm::u8vec4, 9> texels;
+    texels.fill(glm::u8vec4(40, 80, 120, 255));
+
+    std::vector<std::byte> blocks(TextureCompressor::GetCompressedSize(TextureFormat::BC1, 3, 3));
+    TextureCompressor::Compress(TextureFormat::BC1, texels, 3, 3, blocks);
+
+    Texels expected;
+    expected.fill(texels[0]);
+    EXPECT_LE(GetMaxColorError(expected, blocks.data()), EndpointError);
+}
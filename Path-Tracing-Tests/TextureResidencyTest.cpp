@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Renderer/TextureResidency.h"
+
+using namespace PathTracingTests;
+
+using PathTracing::TextureResidency;
+
+namespace
+{
+
+const vk::Extent2D Extent = vk::Extent2D(1024, 1024);
+const vk::Format Format = vk::Format::eR8G8B8A8Unorm;
+
+// Feedback that requests the full size of the textures
+constexpr uint32_t FullSizeFeedback = 11;
+constexpr uint32_t NoFeedback = PathTracing::Shaders::TextureFeedbackNone;
+// Level of textures that aren't sampled, their size is 128
+constexpr uint32_t UnusedLevel = 3;
+
+TextureResidency CreateResidency(const std::vector<uint32_t> &levels)
+{
+    const std::vector<vk::Extent2D> extents(levels.size(), Extent);
+    const std::vector<vk::Format> formats(levels.size(), Format);
+    return TextureResidency(extents, formats, levels);
+}
+
+size_t GetLevelMemory(uint32_t level)
+{
+    return CreateResidency({ level }).GetResidentMemory();
+}
+
+std::vector<uint32_t> Update(
+    TextureResidency &residency, const std::vector<uint32_t> &feedback, size_t budget, uint32_t maxChanges
+)
+{
+    residency.AddFeedback(feedback);
+    return residency.Update(budget, maxChanges);
+}
+
+}
+
+TEST(TextureResidencyTest, UpgradesRequestedTextures)
+{
+    TextureResidency residency = CreateResidency({ UnusedLevel, UnusedLevel });
+
+    const std::vector<uint32_t> changed = Update(residency, { FullSizeFeedback, NoFeedback }, SIZE_MAX, 4);
+    EXPECT_EQ(changed, std::vector<uint32_t> { 0 });
+    EXPECT_EQ(residency.GetLevel(0), 0u);
+    EXPECT_EQ(residency.GetLevel(1), UnusedLevel);
+}
+
+TEST(TextureResidencyTest, StaysWithinBudget)
+{
+    TextureResidency residency = CreateResidency({ UnusedLevel, UnusedLevel, UnusedLevel });
+    const std::vector<uint32_t> feedback = { FullSizeFeedback, FullSizeFeedback, FullSizeFeedback };
+
+    // Not every texture fits at full size, so the largest ones are scaled down until they do
+    const size_t budget = GetLevelMemory(0) + 2 * GetLevelMemory(UnusedLevel);
+    ASSERT_LE(residency.GetResidentMemory(), budget);
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        Update(residency, feedback, budget, 1);
+        EXPECT_LE(residency.GetResidentMemory(), budget);
+    }
+
+    EXPECT_TRUE(Update(residency, feedback, budget, 1).empty());
+    for (uint32_t i = 0; i < 3; i++)
+        EXPECT_LT(residency.GetLevel(i), UnusedLevel);
+}
+
+TEST(TextureResidencyTest, ScalesLargestTexturesDown)
+{
+    TextureResidency residency = CreateResidency({ UnusedLevel, UnusedLevel });
+    const size_t budget = 2 * GetLevelMemory(1);
+
+    Update(residency, { FullSizeFeedback, FullSizeFeedback }, budget, 4);
+    EXPECT_EQ(residency.GetLevel(0), 1u);
+    EXPECT_EQ(residency.GetLevel(1), 1u);
+    EXPECT_LE(residency.GetResidentMemory(), budget);
+}
+
+TEST(TextureResidencyTest, EvictionsBeforeUpgrades)
+{
+    // The budget only fits one texture at full size, the first one isn't sampled anymore
+    const size_t budget = GetLevelMemory(0) + GetLevelMemory(UnusedLevel);
+    const std::vector<uint32_t> feedback = { NoFeedback, FullSizeFeedback };
+
+    TextureResidency residency = CreateResidency({ 0, UnusedLevel });
+    EXPECT_EQ(Update(residency, feedback, budget, 4), std::vector<uint32_t>({ 0, 1 }));
+    EXPECT_EQ(residency.GetLevel(0), UnusedLevel);
+    EXPECT_EQ(residency.GetLevel(1), 0u);
+    EXPECT_LE(residency.GetResidentMemory(), budget);
+
+    // With a single change per update the upgrade waits for the eviction that makes room for it
+    TextureResidency limitedResidency = CreateResidency({ 0, UnusedLevel });
+    EXPECT_EQ(Update(limitedResidency, feedback, budget, 1), std::vector<uint32_t> { 0 });
+    EXPECT_EQ(Update(limitedResidency, feedback, budget, 1), std::vector<uint32_t> { 1 });
+    EXPECT_LE(limitedResidency.GetResidentMemory(), budget);
+}
+
+TEST(TextureResidencyTest, MaxChanges)
+{
+    TextureResidency residency = CreateResidency({ UnusedLevel, UnusedLevel, UnusedLevel, UnusedLevel, 1 });
+    const std::vector<uint32_t> feedback(5, FullSizeFeedback);
+
+    // Textures missing the most levels are upgraded first
+    const std::vector<uint32_t> first = Update(residency, feedback, SIZE_MAX, 2);
+    EXPECT_EQ(first.size(), 2u);
+    EXPECT_EQ(residency.GetLevel(4), 1u);
+
+    EXPECT_EQ(Update(residency, feedback, SIZE_MAX, 2).size(), 2u);
+    EXPECT_EQ(Update(residency, feedback, SIZE_MAX, 2), std::vector<uint32_t> { 4 });
+    EXPECT_TRUE(Update(residency, feedback, SIZE_MAX, 2).empty());
+
+    for (uint32_t i = 0; i < 5; i++)
+        EXPECT_EQ(residency.GetLevel(i), 0u);
+}
+
+TEST(TextureResidencyTest, EvictsUnusedTextures)
+{
+    TextureResidency residency = CreateResidency({ UnusedLevel });
+
+    Update(residency, { FullSizeFeedback }, SIZE_MAX, 1);
+    EXPECT_EQ(residency.GetLevel(0), 0u);
+
+    // Textures briefly out of view keep their level for a few updates
+    for (uint32_t i = 0; i < 3; i++)
+        EXPECT_TRUE(Update(residency, { NoFeedback }, SIZE_MAX, 1).empty());
+
+    EXPECT_EQ(Update(residency, { NoFeedback }, SIZE_MAX, 1), std::vector<uint32_t> { 0 });
+    EXPECT_EQ(residency.GetLevel(0), UnusedLevel);
+}
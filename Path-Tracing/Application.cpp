@@ -100,6 +100,8 @@ std::unique_ptr<Swapchain> Application::s_Swapchain = nullptr;
 
 Application::State Application::s_State = Application::State::Shutdown;
 bool Application::s_AdvanceFrameOfflineRendering = false;
+uint32_t Application::s_OfflineRenderingFrameIndex = 0;
+float Application::s_OfflineRenderingStartTime = 0.0f;
 
 Config Application::s_Config = {};
 std::array<BackgroundTask, Application::g_BackgroundTasks.size()> Application::s_BackgroundTasks = {};
@@ -331,7 +333,15 @@ void Application::Run()
                 if (!IsRendering())
                     updated = scene->Update(timeStep);
                 if (IsRendering() && s_AdvanceFrameOfflineRendering)
-                    updated = scene->Update(1.0f / Renderer::GetRenderFramerate());
+                {
+                    // Frames are sampled at exact times, so long renders don't accumulate time step errors
+                    const float framerate = Renderer::GetRenderFramerate();
+                    s_OfflineRenderingFrameIndex++;
+                    scene->SeekAnimations(
+                        s_OfflineRenderingStartTime + s_OfflineRenderingFrameIndex / framerate
+                    );
+                    updated = scene->Update(1.0f / framerate);
+                }
                 s_AdvanceFrameOfflineRendering = false;
 
                 Renderer::UpdateSceneData(scene, updated);
@@ -416,6 +426,8 @@ void Application::BeginOfflineRendering()
     const auto scene = SceneManager::GetActiveScene();
     if (scene->IsAnimationPaused())
         scene->ToggleAnimationPause();
+    s_OfflineRenderingFrameIndex = 0;
+    s_OfflineRenderingStartTime = scene->GetAnimationTime();
     InputCamera::DisableInput();
 }
 
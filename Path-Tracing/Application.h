@@ -94,6 +94,8 @@ private:
 
     static State s_State;
     static bool s_AdvanceFrameOfflineRendering;
+    static uint32_t s_OfflineRenderingFrameIndex;
+    static float s_OfflineRenderingStartTime;
 
     static Config s_Config;
     static std::array<BackgroundTask, g_BackgroundTasks.size()> s_BackgroundTasks;
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <filesystem>
+#include <fstream>
 #include <queue>
 #include <ranges>
+#include <span>
 #include <unordered_map>
+#include <vector>
+
+#include "Core/Core.h"
 
 namespace PathTracing
 {
@@ -35,6 +41,29 @@ inline constexpr size_t FNVHash<T>::operator()(const T &config) const noexcept
     return hash;
 }
 
+inline int64_t GetModificationTime(const std::filesystem::path &path)
+{
+    return std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+inline int64_t GetModificationTime(const std::filesystem::path &path, std::error_code &error)
+{
+    return std::filesystem::last_write_time(path, error).time_since_epoch().count();
+}
+
+inline size_t HashFile(const std::filesystem::path &path)
+{
+    const size_t chunkSize = 16_MiB;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> chunk(chunkSize);
+    std::vector<size_t> chunkHashes = {};
+    while (file.read(chunk.data(), chunkSize) || file.gcount() > 0)
+        chunkHashes.push_back(FNVHash<std::span<const char>>()(std::span(chunk.data(), file.gcount())));
+
+    return FNVHash<std::vector<size_t>>()(chunkHashes);
+}
+
 template<typename K, typename V> class LRUCache
 {
 public:
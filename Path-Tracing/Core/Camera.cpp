@@ -155,7 +155,7 @@ void InputCamera::EnableInput()
 
 AnimatedCamera::AnimatedCamera(
     float verticalFOV, float nearClip, float farClip, glm::vec3 position, glm::vec3 direction, glm::vec3 up,
-    const glm::mat4 &transform
+    const glm::mat3x4 &transform
 )
     : Camera(verticalFOV, nearClip, farClip, position, direction, up), m_RelativePosition(position),
       m_RelativeDirection(direction), m_RelativeUpDirection(up), m_Transform(transform)
@@ -71,7 +71,7 @@ class AnimatedCamera : public Camera
 public:
     AnimatedCamera(
         float verticalFOV, float nearClip, float farClip, glm::vec3 position, glm::vec3 direction,
-        glm::vec3 up, const glm::mat4 &transform
+        glm::vec3 up, const glm::mat3x4 &transform
     );
     ~AnimatedCamera() override = default;
 
@@ -82,7 +82,7 @@ private:
     const glm::vec3 m_RelativeDirection;
     const glm::vec3 m_RelativeUpDirection;
 
-    const glm::mat4 &m_Transform;
+    const glm::mat3x4 &m_Transform;
 };
 
 }
\ No newline at end of file
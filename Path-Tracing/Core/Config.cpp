@@ -165,6 +165,10 @@ Config Config::Create(int argc, const char *argv[])
         .OptimizeScene = true,
 #endif
 
+#ifdef CONFIG_DISABLE_VERTEX_PACKING
+        .PackVertices = false,
+#endif
+
         .LoggerLevel = GetLogLevel(),
 
 #ifdef CONFIG_LOG_TO_FILE
@@ -180,6 +184,17 @@ Config Config::Create(int argc, const char *argv[])
         .MaxBuffersPerLoaderThread = CONFIG_MAX_BUFFERS_PER_LOADER_THREAD,
 #endif
 
+#ifdef CONFIG_MAX_SCENE_IMPORT_THREADS
+        .MaxSceneImportThreads = CONFIG_MAX_SCENE_IMPORT_THREADS,
+#endif
+
+#ifdef CONFIG_DISABLE_SCENE_CACHE
+        .CacheScenes = false,
+#endif
+
+        .SceneCachePath = shaderDirectory.parent_path() / "SceneCache",
+        .SceneCacheExtension = "scenecache",
+
         .ShaderDirectoryPath = shaderDirectory,
 
 #ifdef CONFIG_SHADER_DEBUG_INFO
@@ -223,6 +238,39 @@ Config Config::Create(int argc, const char *argv[])
         .MaxStagingBufferSize = FromMiB(CONFIG_MAX_STAGING_BUFFER_SIZE_MIB),
 #endif
 
+#ifdef CONFIG_MAX_BLAS_BUILD_SCRATCH_SIZE_MIB
+        .MaxBlasBuildScratchSize = FromMiB(CONFIG_MAX_BLAS_BUILD_SCRATCH_SIZE_MIB),
+#endif
+
+#ifdef CONFIG_DISABLE_BLAS_COMPACTION
+        .CompactBlases = false,
+#endif
+
+#ifdef CONFIG_MAX_BLAS_REFIT_COUNT
+        .MaxBlasRefitCount = CONFIG_MAX_BLAS_REFIT_COUNT,
+#endif
+
+#ifdef CONFIG_MAX_BLAS_REBUILDS_PER_FRAME
+        .MaxBlasRebuildsPerFrame = CONFIG_MAX_BLAS_REBUILDS_PER_FRAME,
+#endif
+
+#ifdef CONFIG_DISABLE_BLAS_CACHE
+        .BlasCache = false,
+#endif
+
+        .BlasCachePath = shaderDirectory.parent_path() / "BlasCache",
+        .BlasCacheExtension = "blascache",
+
+#ifdef CONFIG_DISABLE_TEXTURE_CACHE
+        .CacheTextures = false,
+#endif
+
+#ifdef CONFIG_DISABLE_TEXTURE_COMPRESSION
+        .CompressTextures = false,
+#endif
+
+        .TextureCachePath = shaderDirectory.parent_path() / "TextureCache",
+
 #ifdef CONFIG_MAX_TEXTURE_MEMORY_BUDGET_ABSOLUTE_MIB
         .MaxTextureMemoryBudgetAbsolute = FromMiB(CONFIG_MAX_TEXTURE_MEMORY_BUDGET_ABSOLUTE_MIB),
 #endif
@@ -231,6 +279,10 @@ Config Config::Create(int argc, const char *argv[])
         .MaxTextureMemoryBudgetVramPercent = CONFIG_MAX_TEXTURE_MEMORY_BUDGET_VRAM_PERCENT,
 #endif
 
+#ifdef CONFIG_DISABLE_TEXTURE_STREAMING
+        .TextureStreaming = false,
+#endif
+
 #ifdef CONFIG_MAX_SAMPLES_PER_FRAME
         .MaxSamplesPerFrame = CONFIG_MAX_SAMPLES_PER_FRAME,
 #endif
@@ -136,6 +136,7 @@ struct Config
 
     std::filesystem::path AssetDirectoryPath;
     bool OptimizeScene = false;
+    bool PackVertices = true;
 
     LogLevel LoggerLevel = LogLevel::Error;
     bool LogToFile = false;
@@ -143,6 +144,10 @@ struct Config
 
     uint32_t MaxTextureLoaderThreads = std::numeric_limits<uint32_t>::max();
     uint32_t MaxBuffersPerLoaderThread = std::numeric_limits<uint32_t>::max();
+    uint32_t MaxSceneImportThreads = std::numeric_limits<uint32_t>::max();
+    bool CacheScenes = true;
+    std::filesystem::path SceneCachePath;
+    std::filesystem::path SceneCacheExtension;
 
     std::filesystem::path ShaderDirectoryPath;
     bool ShaderDebugInfo = false;
@@ -159,8 +164,19 @@ struct Config
     std::filesystem::path ShaderCacheExtension;
 
     uint64_t MaxStagingBufferSize = 64_MiB;
+    uint64_t MaxBlasBuildScratchSize = 128_MiB;
+    bool CompactBlases = true;
+    uint32_t MaxBlasRefitCount = 256;
+    uint32_t MaxBlasRebuildsPerFrame = 1;
+    bool BlasCache = true;
+    std::filesystem::path BlasCachePath;
+    std::filesystem::path BlasCacheExtension;
+    bool CacheTextures = true;
+    bool CompressTextures = true;
+    std::filesystem::path TextureCachePath;
     uint64_t MaxTextureMemoryBudgetAbsolute = std::numeric_limits<uint64_t>::max();
     uint32_t MaxTextureMemoryBudgetVramPercent = 80;
+    bool TextureStreaming = true;
 
     uint32_t MaxSamplesPerFrame = std::numeric_limits<uint32_t>::max();
     uint32_t MinRefreshRate = 60;
@@ -2,8 +2,12 @@
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <span>
 #include <thread>
+#include <vector>
 
 namespace PathTracing
 {
@@ -47,8 +51,10 @@ inline void ThreadDispatch<I, ReservedThreadCount>::Dispatch(size_t inputCount,
     {
         auto &thread = GetThreads()[threadId];
         thread = std::jthread([process, inputCount, threadId, this](std::stop_token stopToken) {
-            while (!stopToken.stop_requested() && m_InputIndex < inputCount)
-                process(threadId, m_InputIndex++, stopToken);
+            // The index has to be claimed before the check, otherwise two threads could both pass it
+            for (I index = m_InputIndex++; !stopToken.stop_requested() && index < inputCount;
+                 index = m_InputIndex++)
+                process(threadId, index, stopToken);
         });
     }
 }
@@ -77,4 +83,101 @@ inline std::span<std::jthread> ThreadDispatch<I, ReservedThreadCount>::GetThread
     return std::span<std::jthread>(m_Threads.data(), m_ThreadCount);
 }
 
+// Workers live as long as the pool, so dispatches can be too short to be worth starting threads for
+// The calling thread processes inputs too, so a pool without workers runs the dispatch serially
+class WorkerPool
+{
+public:
+    WorkerPool(size_t workerCount);
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void DispatchBlocking(uint32_t inputCount, const std::function<void(uint32_t)> &process);
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable_any m_WorkCondition;
+    std::condition_variable m_DoneCondition;
+
+    const std::function<void(uint32_t)> *m_Process = nullptr;
+    uint32_t m_InputCount = 0;
+    std::atomic<uint32_t> m_InputIndex = 0;
+    uint64_t m_DispatchIndex = 0;
+    uint32_t m_ActiveCount = 0;
+
+    // Threads are stopped and joined before the members they use are destroyed
+    std::vector<std::jthread> m_Workers;
+
+private:
+    void ProcessInputs(const std::function<void(uint32_t)> &process, uint32_t inputCount);
+    void FinishProcessing();
+};
+
+inline WorkerPool::WorkerPool(size_t workerCount)
+{
+    m_Workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+        m_Workers.emplace_back([this](std::stop_token stopToken) {
+            uint64_t dispatchIndex = 0;
+            while (true)
+            {
+                const std::function<void(uint32_t)> *process = nullptr;
+                uint32_t inputCount = 0;
+                {
+                    std::unique_lock lock(m_Mutex);
+                    if (!m_WorkCondition.wait(lock, stopToken, [this, &dispatchIndex]() {
+                            return m_DispatchIndex != dispatchIndex;
+                        }))
+                        return;
+
+                    // Workers that wake up after their dispatch finished see no inputs
+                    dispatchIndex = m_DispatchIndex;
+                    process = m_Process;
+                    inputCount = m_InputCount;
+                    m_ActiveCount++;
+                }
+
+                if (process != nullptr)
+                    ProcessInputs(*process, inputCount);
+                FinishProcessing();
+            }
+        });
+}
+
+inline void WorkerPool::DispatchBlocking(uint32_t inputCount, const std::function<void(uint32_t)> &process)
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Process = &process;
+        m_InputCount = inputCount;
+        m_InputIndex = 0;
+        m_DispatchIndex++;
+        m_ActiveCount++;
+    }
+    m_WorkCondition.notify_all();
+
+    ProcessInputs(process, inputCount);
+    FinishProcessing();
+
+    // Every input is claimed by now, so the dispatch is done once no thread is processing one
+    std::unique_lock lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this]() { return m_ActiveCount == 0; });
+    m_Process = nullptr;
+    m_InputCount = 0;
+}
+
+inline void WorkerPool::ProcessInputs(const std::function<void(uint32_t)> &process, uint32_t inputCount)
+{
+    for (uint32_t index = m_InputIndex++; index < inputCount; index = m_InputIndex++)
+        process(index);
+}
+
+inline void WorkerPool::FinishProcessing()
+{
+    std::lock_guard lock(m_Mutex);
+    if (--m_ActiveCount == 0)
+        m_DoneCondition.notify_all();
+}
+
 }
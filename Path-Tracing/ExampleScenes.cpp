@@ -502,8 +502,8 @@ void CreateDefaultScene(SceneBuilder &sceneBuilder)
         glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)), glm::vec3(-2.25f, 0.5f, 0.0f))
     );
 
-    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f), glm::mat4(1.0f) });
-    const uint32_t boxNode = sceneBuilder.AddSceneNode({ rootNode, boxTransform, glm::mat4(1.0f) });
+    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f) });
+    const uint32_t boxNode = sceneBuilder.AddSceneNode({ rootNode, boxTransform });
 
     const uint32_t boxInstance = sceneBuilder.AddModelInstance(box, boxNode);
 
@@ -516,7 +516,7 @@ void CreateDefaultScene(SceneBuilder &sceneBuilder)
             glm::vec3(0.3f)
         )
     );
-    const uint32_t leftCubeNode = sceneBuilder.AddSceneNode({ boxNode, leftCubeTransform, glm::mat4(1.0f) });
+    const uint32_t leftCubeNode = sceneBuilder.AddSceneNode({ boxNode, leftCubeTransform });
 
     const glm::mat4 rightCubeTransform = glm::transpose(
         glm::scale(
@@ -528,14 +528,14 @@ void CreateDefaultScene(SceneBuilder &sceneBuilder)
         )
     );
     const uint32_t rightCubeNode =
-        sceneBuilder.AddSceneNode({ boxNode, rightCubeTransform, glm::mat4(1.0f) });
+        sceneBuilder.AddSceneNode({ boxNode, rightCubeTransform });
 
     const uint32_t leftCubeInstance = sceneBuilder.AddModelInstance(metallicCube, leftCubeNode);
     const uint32_t rightCubeInstance = sceneBuilder.AddModelInstance(glassCube, rightCubeNode);
 
     const glm::mat4 lightTransform =
         glm::transpose(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.099f, 0.0f)));
-    const uint32_t lightNode = sceneBuilder.AddSceneNode({ boxNode, lightTransform, glm::mat4(1.0f) });
+    const uint32_t lightNode = sceneBuilder.AddSceneNode({ boxNode, lightTransform });
     sceneBuilder.AddModelInstance(light, lightNode);
 
     sceneBuilder.SetDirectionalLight(
@@ -612,20 +612,19 @@ void CreateMetallicRoughnessCubesScene(SceneBuilder &sceneBuilder)
         )
     );
 
-    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f), glm::mat4(1.0f) });
+    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f) });
     const uint32_t cube1inst1node =
-        sceneBuilder.AddSceneNode({ rootNode, cube1inst1transform, glm::mat4(1.0f) });
+        sceneBuilder.AddSceneNode({ rootNode, cube1inst1transform });
     const uint32_t cube1inst2node =
-        sceneBuilder.AddSceneNode({ rootNode, cube1inst2transform, glm::mat4(1.0f) });
-    const uint32_t cube2node = sceneBuilder.AddSceneNode({ rootNode, cube2transform, glm::mat4(1.0f) });
+        sceneBuilder.AddSceneNode({ rootNode, cube1inst2transform });
+    const uint32_t cube2node = sceneBuilder.AddSceneNode({ rootNode, cube2transform });
 
     const uint32_t cube1inst1 = sceneBuilder.AddModelInstance(cube1, cube1inst1node);
     const uint32_t cube1inst2 = sceneBuilder.AddModelInstance(cube1, cube1inst2node);
     const uint32_t cube2inst = sceneBuilder.AddModelInstance(cube2, cube2node);
 
     const uint32_t lightNode = sceneBuilder.AddSceneNode(
-        { rootNode, glm::transpose(glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 3.0f, 0.0f))),
-          glm::mat4(1.0f) }
+        { rootNode, glm::transpose(glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 3.0f, 0.0f))) }
     );
 
     sceneBuilder.AddLight(
@@ -640,13 +639,11 @@ void CreateMetallicRoughnessCubesScene(SceneBuilder &sceneBuilder)
     );
 
     AnimationNode animNode = { .SceneNodeIndex = lightNode };
-    animNode.Positions.Keys = {
-        { glm::vec3(-1.0f, 3.0f, 0.0f), 0.0f },
-        { glm::vec3(1.0f, 3.0f, 0.0f), 90.0f },
-        { glm::vec3(-1.0f, 3.0f, 0.0f), 180.0f },
-    };
-    animNode.Rotations.Keys = { { glm::quat(), 0.0f } };
-    animNode.Scales.Keys = { { glm::vec3(1.0f), 0.0f } };
+    animNode.Positions.AddKey(glm::vec3(-1.0f, 3.0f, 0.0f), 0.0f);
+    animNode.Positions.AddKey(glm::vec3(1.0f, 3.0f, 0.0f), 90.0f);
+    animNode.Positions.AddKey(glm::vec3(-1.0f, 3.0f, 0.0f), 180.0f);
+    animNode.Rotations.AddKey(glm::quat(), 0.0f);
+    animNode.Scales.AddKey(glm::vec3(1.0f), 0.0f);
 
     sceneBuilder.AddAnimation(Animation({ animNode }, 30.0f, 180.0f));
 
@@ -737,8 +734,8 @@ void CreateReuseMeshCubesScene(SceneBuilder &sceneBuilder)
 
     const uint32_t cube = sceneBuilder.AddModel(m);
 
-    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f), glm::mat4(1.0f) });
-    const uint32_t cube1node = sceneBuilder.AddSceneNode({ rootNode, glm::mat4(1.0f), glm::mat4(1.0f) });
+    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f) });
+    const uint32_t cube1node = sceneBuilder.AddSceneNode({ rootNode, glm::mat4(1.0f) });
     const uint32_t cube1inst = sceneBuilder.AddModelInstance(cube, cube1node);
 
     const auto skyboxPath = base / "skybox" / "sky_42_cubemap_(roblox)_2k";
@@ -821,7 +818,7 @@ void CreateRoughnessTestCubesScene(SceneBuilder &sceneBuilder)
         cubeModels[i] = sceneBuilder.AddModel(cubeMeshes[i]);
     }
 
-    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f), glm::mat4(1.0f) });
+    const uint32_t rootNode = sceneBuilder.AddSceneNode({ 0u, glm::mat4(1.0f) });
     std::array<glm::mat4, 36> cubeNodeTransforms;
     for (int i = 0; i < 6; i++)
     {
@@ -831,7 +828,7 @@ void CreateRoughnessTestCubesScene(SceneBuilder &sceneBuilder)
                 glm::translate(glm::mat4(1.0f), glm::vec3(j * -4.0f, 0.0f, i * -4.0f))
             );
             const uint32_t cubeNode =
-                sceneBuilder.AddSceneNode({ rootNode, cubeNodeTransforms[i * 6 + j], glm::mat4(1.0f) });
+                sceneBuilder.AddSceneNode({ rootNode, cubeNodeTransforms[i * 6 + j] });
             sceneBuilder.AddModelInstance(cubeModels[i * 6 + j], cubeNode);
         }
     }
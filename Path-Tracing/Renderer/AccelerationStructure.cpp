@@ -1,3 +1,11 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <ranges>
+#include <utility>
+
+#include "Core/Cache.h"
 #include "Core/Core.h"
 
 #include "AccelerationStructure.h"
@@ -9,86 +17,679 @@
 namespace PathTracing
 {
 
-AccelerationStructure::AccelerationStructure(
-    vk::DeviceAddress vertexBufferAddress, vk::DeviceAddress indexBufferAddress,
-    vk::DeviceAddress animatedVertexBufferAddress, vk::DeviceAddress animatedIndexBufferAddress,
-    vk::DeviceAddress transformBufferAddress, std::shared_ptr<const Scene> scene, uint32_t hitGroupCount
-)
-    : m_VertexBufferAddress(vertexBufferAddress), m_IndexBufferAddress(indexBufferAddress),
-      m_AnimatedVertexBufferAddress(animatedVertexBufferAddress),
-      m_AnimatedIndexBufferAddress(animatedIndexBufferAddress),
-      m_TransformBufferAddress(transformBufferAddress), m_Scene(std::move(scene)),
-      m_HitGroupCount(hitGroupCount),
-      m_ScratchOffsetAlignment(
+namespace
+{
+
+vk::BuildAccelerationStructureFlagsKHR GetFlags(bool allowUpdate)
+{
+    return allowUpdate ? vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
+                             vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate
+                       : vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+}
+
+}
+
+BlasSet::BlasSet(const GeometryBufferAddresses &addresses, const Scene &scene, bool isAnimated)
+    : m_ScratchOffsetAlignment(
           DeviceContext::GetAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment
-      )
+      ),
+      m_Addresses(addresses), m_IsAnimated(isAnimated),
+      m_AllowCompaction(!isAnimated && Application::GetConfig().CompactBlases),
+      m_IsCacheEnabled(!isAnimated && Application::GetConfig().BlasCache)
 {
-    Timer timer("Acceleration Structure Build");
+    if (m_IsCacheEnabled)
+    {
+        const std::filesystem::path &blasCachePath = Application::GetConfig().BlasCachePath;
+        if (!std::filesystem::is_directory(blasCachePath))
+        {
+            std::filesystem::remove(blasCachePath);
+            std::filesystem::create_directory(blasCachePath);
+        }
+    }
+
+    std::vector<Blas> cachedBlases = CreateBlases(scene);
+
+    if (!m_BlasInfos.empty())
+        BuildNewBlases();
+
+    if (m_IsCacheEnabled)
+    {
+        SerializeBlases();
+
+        Stats::AddStat(
+            "BLAS Cache", "BLAS Cache: {} loaded, {} built", cachedBlases.size(), m_Blases.size()
+        );
+        Stats::LogStat("BLAS Cache");
+
+        // Cached BLASes are neither compacted nor serialized again, so they join the set after the build
+        m_Blases.insert(m_Blases.end(), cachedBlases.begin(), cachedBlases.end());
+    }
+
+    // Static BLASes are never touched again after the build
+    if (!m_IsAnimated)
+        m_BlasInfos.clear();
+}
+
+BlasSet::~BlasSet()
+{
+    for (const auto &blas : m_Blases)
+        DeviceContext::GetLogical().destroyAccelerationStructureKHR(
+            blas.Handle, nullptr, Application::GetDispatchLoader()
+        );
+}
+
+void BlasSet::BuildNewBlases()
+{
+    // Split the BLASes into batches that share one scratch region within the budget
+    const vk::DeviceSize scratchBudget = Application::GetConfig().MaxBlasBuildScratchSize;
+    std::vector<size_t> batchEnds = {};
+    vk::DeviceSize batchScratchSize = 0, scratchSize = 0;
+    for (size_t i = 0; i < m_BlasInfos.size(); i++)
+    {
+        BlasInfo &info = m_BlasInfos[i];
+        const vk::DeviceSize size = Utils::AlignTo(info.BuildScratchSize, m_ScratchOffsetAlignment);
+
+        if (batchScratchSize > 0 && batchScratchSize + size > scratchBudget)
+        {
+            batchEnds.push_back(i);
+            batchScratchSize = 0;
+        }
 
+        info.BuildScratchOffset = batchScratchSize;
+        batchScratchSize += size;
+        scratchSize = std::max(scratchSize, batchScratchSize);
+    }
+    batchEnds.push_back(m_BlasInfos.size());
+
+    const Buffer scratchBuffer = BufferBuilder()
+                                     .SetUsageFlags(
+                                         vk::BufferUsageFlagBits::eStorageBuffer |
+                                         vk::BufferUsageFlagBits::eShaderDeviceAddress
+                                     )
+                                     .SetAlignment(m_ScratchOffsetAlignment)
+                                     .CreateDeviceBuffer(scratchSize, "BLAS Build Scratch Buffer");
+
+    logger::debug(
+        "Building {} BLASes in {} batches with {} bytes of scratch memory", m_BlasInfos.size(),
+        batchEnds.size(), scratchSize
+    );
+
+    vk::QueryPool queryPool = nullptr;
     Renderer::s_MainCommandBuffer->Begin();
-    CreateBlases();
-    BuildBlases(Renderer::s_MainCommandBuffer->Buffer, vk::BuildAccelerationStructureModeKHR::eBuild);
+    if (m_AllowCompaction)
+    {
+        queryPool = DeviceContext::GetLogical().createQueryPool(vk::QueryPoolCreateInfo(
+            vk::QueryPoolCreateFlags(), vk::QueryType::eAccelerationStructureCompactedSizeKHR, m_Blases.size()
+        ));
+        Renderer::s_MainCommandBuffer->Buffer.resetQueryPool(queryPool, 0, m_Blases.size());
+    }
+
+    std::vector<BlasInfo *> batch = {};
+    size_t batchBegin = 0;
+    for (size_t batchEnd : batchEnds)
+    {
+        if (batchBegin > 0)
+            AddScratchReuseBarrier(Renderer::s_MainCommandBuffer->Buffer);
+
+        batch.clear();
+        for (size_t i = batchBegin; i < batchEnd; i++)
+            batch.push_back(&m_BlasInfos[i]);
+
+        BuildBlases(
+            Renderer::s_MainCommandBuffer->Buffer, batch, scratchBuffer.GetDeviceAddress(),
+            vk::BuildAccelerationStructureModeKHR::eBuild
+        );
+        batchBegin = batchEnd;
+    }
     AddBuildSyncBarrier(Renderer::s_MainCommandBuffer->Buffer);
-    CreateTlas();
-    BuildTlas(Renderer::s_MainCommandBuffer->Buffer, vk::BuildAccelerationStructureModeKHR::eBuild);
+
+    if (m_AllowCompaction)
+    {
+        std::vector<vk::AccelerationStructureKHR> handles = {};
+        for (const Blas &blas : m_Blases)
+            handles.push_back(blas.Handle);
+
+        Renderer::s_MainCommandBuffer->Buffer.writeAccelerationStructuresPropertiesKHR(
+            handles, vk::QueryType::eAccelerationStructureCompactedSizeKHR, queryPool, 0,
+            Application::GetDispatchLoader()
+        );
+    }
     Renderer::s_MainCommandBuffer->SubmitBlocking();
+
+    if (m_AllowCompaction)
+    {
+        CompactBlases(queryPool);
+        DeviceContext::GetLogical().destroyQueryPool(queryPool);
+    }
 }
 
-AccelerationStructure::~AccelerationStructure()
+bool BlasSet::RecordUpdateCommands(vk::CommandBuffer commandBuffer, std::span<const uint32_t> modelVersions)
 {
-    for (const auto &blas : m_Blases)
+    assert(m_IsAnimated);
+
+    const auto &config = Application::GetConfig();
+
+    // Only BLASes of models with moving bones are updated
+    std::vector<BlasInfo *> refitInfos = {};
+    std::vector<BlasInfo *> rebuildInfos = {};
+    for (uint32_t i = 0; i < m_BlasInfos.size(); i++)
+    {
+        BlasInfo &info = m_BlasInfos[i];
+        const uint32_t version = modelVersions[m_Blases[i].ModelIndex];
+        if (info.ModelVersion == version)
+            continue;
+
+        info.ModelVersion = version;
+        if (info.RefitCount >= config.MaxBlasRefitCount)
+            rebuildInfos.push_back(&info);
+        else
+            refitInfos.push_back(&info);
+    }
+
+    // Refits degrade the BVH quality over time, the most refitted BLASes get rebuilt first
+    // Rebuilds are spread across frames, the rest of the BLASes get refitted one more time
+    std::ranges::sort(rebuildInfos, std::greater(), [](const BlasInfo *info) { return info->RefitCount; });
+    while (rebuildInfos.size() > config.MaxBlasRebuildsPerFrame)
+    {
+        refitInfos.push_back(rebuildInfos.back());
+        rebuildInfos.pop_back();
+    }
+
+    for (BlasInfo *info : refitInfos)
+        info->RefitCount++;
+
+    for (uint32_t i = 0; i < rebuildInfos.size(); i++)
+    {
+        rebuildInfos[i]->RefitCount = 0;
+        rebuildInfos[i]->BuildScratchOffset = i * m_RebuildScratchStride;
+    }
+
+    BuildBlases(
+        commandBuffer, refitInfos, m_UpdateScratchBuffer.GetDeviceAddress(),
+        vk::BuildAccelerationStructureModeKHR::eUpdate
+    );
+    BuildBlases(
+        commandBuffer, rebuildInfos, m_RebuildScratchBuffer.GetDeviceAddress(),
+        vk::BuildAccelerationStructureModeKHR::eBuild
+    );
+
+    return !refitInfos.empty() || !rebuildInfos.empty();
+}
+
+void BlasSet::AddBuildSyncBarrier(vk::CommandBuffer commandBuffer) const
+{
+    if (m_Blases.empty())
+        return;
+
+    m_BlasBuffer.AddBarrier(
+        commandBuffer, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
+    );
+}
+
+void BlasSet::CompactBlases(vk::QueryPool queryPool)
+{
+    const vk::DeviceSize originalSize = m_BlasBuffer.GetSize();
+
+    const std::vector<vk::DeviceSize> compactedSizes =
+        DeviceContext::GetLogical()
+            .getQueryPoolResults<vk::DeviceSize>(
+                queryPool, 0, m_Blases.size(), m_Blases.size() * sizeof(vk::DeviceSize),
+                sizeof(vk::DeviceSize), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait
+            )
+            .value;
+
+    std::vector<vk::DeviceSize> offsets = {};
+    vk::DeviceSize compactedBufferSize = 0;
+    for (vk::DeviceSize size : compactedSizes)
+    {
+        offsets.push_back(compactedBufferSize);
+        compactedBufferSize += Utils::AlignTo(size, 256);
+    }
+
+    Buffer compactedBuffer = BufferBuilder()
+                                 .SetUsageFlags(
+                                     vk::BufferUsageFlagBits::eStorageBuffer |
+                                     vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
+                                     vk::BufferUsageFlagBits::eShaderDeviceAddress
+                                 )
+                                 .CreateDeviceBuffer(compactedBufferSize, "Static BLAS Buffer");
+
+    // Copy every BLAS into the tightly packed buffer
+    std::vector<Blas> compactedBlases = {};
+    Renderer::s_MainCommandBuffer->Begin();
+    for (uint32_t i = 0; i < m_Blases.size(); i++)
+    {
+        vk::AccelerationStructureCreateInfoKHR createInfo(
+            vk::AccelerationStructureCreateFlagsKHR(), compactedBuffer.GetHandle(), offsets[i],
+            compactedSizes[i], vk::AccelerationStructureTypeKHR::eBottomLevel
+        );
+
+        vk::AccelerationStructureKHR blas = DeviceContext::GetLogical().createAccelerationStructureKHR(
+            createInfo, nullptr, Application::GetDispatchLoader()
+        );
+        vk::DeviceAddress address = DeviceContext::GetLogical().getAccelerationStructureAddressKHR(
+            { blas }, Application::GetDispatchLoader()
+        );
+
+        Renderer::s_MainCommandBuffer->Buffer.copyAccelerationStructureKHR(
+            vk::CopyAccelerationStructureInfoKHR(
+                m_Blases[i].Handle, blas, vk::CopyAccelerationStructureModeKHR::eCompact
+            ),
+            Application::GetDispatchLoader()
+        );
+
+        compactedBlases.emplace_back(blas, address, m_Blases[i].ModelIndex);
+        Utils::SetDebugName(blas, std::format("BLAS {}", m_Blases[i].ModelIndex));
+    }
+    compactedBuffer.AddBarrier(
+        Renderer::s_MainCommandBuffer->Buffer, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
+    );
+    Renderer::s_MainCommandBuffer->SubmitBlocking();
+
+    for (const Blas &blas : m_Blases)
         DeviceContext::GetLogical().destroyAccelerationStructureKHR(
             blas.Handle, nullptr, Application::GetDispatchLoader()
         );
-    DeviceContext::GetLogical().destroyAccelerationStructureKHR(
-        m_Tlas, nullptr, Application::GetDispatchLoader()
+
+    m_Blases = std::move(compactedBlases);
+    m_BlasBuffer = std::move(compactedBuffer);
+
+    Stats::AddStat(
+        "BLAS Memory", "BLAS Memory: {:.2f} MiB (compacted from {:.2f} MiB)",
+        static_cast<float>(compactedBufferSize) / 1_MiB, static_cast<float>(originalSize) / 1_MiB
     );
+    Stats::LogStat("BLAS Memory");
 }
 
-void AccelerationStructure::RecordUpdateCommands(vk::CommandBuffer commandBuffer)
+size_t BlasSet::GetCacheKey(const Scene &scene, const Model &model) const
 {
-    assert(m_Scene->HasAnimations());
+    // Serialized BLASes are only valid on the same device and driver
+    const auto &idProperties = DeviceContext::GetIDProperties();
+    std::vector<size_t> hashes = {
+        FNVHash<std::array<uint8_t, VK_UUID_SIZE>>()(idProperties.deviceUUID),
+        FNVHash<std::array<uint8_t, VK_UUID_SIZE>>()(idProperties.driverUUID),
+        static_cast<VkBuildAccelerationStructureFlagsKHR>(GetFlags(m_IsAnimated)),
+        m_AllowCompaction,
+    };
 
-    Timer timer("Acceleration Structure Update");
-    BuildBlases(commandBuffer, vk::BuildAccelerationStructureModeKHR::eUpdate);
-    AddBuildSyncBarrier(commandBuffer);
-    BuildTlas(commandBuffer, vk::BuildAccelerationStructureModeKHR::eUpdate);
-    AddTraceBarrier(commandBuffer);
+    // Only the data the build reads is part of the key
+    for (const auto &mesh : model.Meshes)
+    {
+        const Geometry &geometry = scene.GetGeometries()[mesh.GeometryIndex];
+        const auto positions = scene.GetVertices().subspan(geometry.VertexOffset, geometry.VertexLength) |
+                               std::views::transform([](const Shaders::Vertex &v) { return v.Position; });
+        const uint32_t indexWords =
+            geometry.HasShortIndices ? (geometry.IndexLength + 1) / 2 : geometry.IndexLength;
+        const auto indices = scene.GetIndices().subspan(geometry.IndexOffset, indexWords);
+
+        hashes.push_back(FNVHash<decltype(positions)>()(positions));
+        hashes.push_back(FNVHash<std::span<const uint32_t>>()(indices));
+        hashes.push_back(geometry.IsOpaque);
+        hashes.push_back(geometry.HasShortIndices);
+
+        if (mesh.TransformBufferOffset != SceneBuilder::IdentityTransformIndex)
+            hashes.push_back(FNVHash<std::span<const glm::mat3x4>>()(
+                scene.GetTransforms().subspan(mesh.TransformBufferOffset, 1)
+            ));
+    }
+
+    return FNVHash<std::vector<size_t>>()(hashes);
 }
 
-vk::AccelerationStructureKHR AccelerationStructure::GetTlas() const
+std::filesystem::path BlasSet::GetCachePath(size_t cacheKey) const
 {
-    return m_Tlas;
+    const auto &config = Application::GetConfig();
+    return config.BlasCachePath / std::format("{:016x}.{}", cacheKey, config.BlasCacheExtension.string());
+}
+
+bool BlasSet::LoadCachedBlas(size_t cacheKey, uint32_t modelIndex)
+{
+    const std::filesystem::path path = GetCachePath(cacheKey);
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // Serialized data starts with the driver UUID, compatibility UUID, serialized and deserialized sizes
+    std::array<std::byte, 2 * VK_UUID_SIZE + 2 * sizeof(uint64_t)> header = {};
+    const size_t fileSize = file.tellg();
+    file.seekg(0);
+    if (fileSize < header.size() || !file.read(reinterpret_cast<char *>(header.data()), header.size()))
+    {
+        logger::warn("BLAS cache file {} is corrupted", path.string());
+        return false;
+    }
+
+    uint64_t serializedSize = 0, deserializedSize = 0;
+    std::memcpy(&serializedSize, header.data() + 2 * VK_UUID_SIZE, sizeof(uint64_t));
+    std::memcpy(&deserializedSize, header.data() + 2 * VK_UUID_SIZE + sizeof(uint64_t), sizeof(uint64_t));
+
+    // Truncated files would make the deserialization read past the end of their data
+    if (serializedSize != fileSize || deserializedSize == 0)
+    {
+        logger::warn("BLAS cache file {} is corrupted", path.string());
+        return false;
+    }
+
+    vk::AccelerationStructureVersionInfoKHR versionInfo(reinterpret_cast<const uint8_t *>(header.data()));
+    const vk::AccelerationStructureCompatibilityKHR compatibility =
+        DeviceContext::GetLogical().getAccelerationStructureCompatibilityKHR(
+            versionInfo, Application::GetDispatchLoader()
+        );
+
+    if (compatibility != vk::AccelerationStructureCompatibilityKHR::eCompatible)
+    {
+        logger::debug("BLAS cache file {} is incompatible with the driver", path.string());
+        return false;
+    }
+
+    m_CachedBlases.emplace_back(modelIndex, cacheKey, deserializedSize, serializedSize, path);
+    return true;
+}
+
+void BlasSet::SerializeBlases() const
+{
+    if (m_BlasInfos.empty())
+        return;
+
+    // All BLASes built so far were cache misses
+    const uint32_t count = m_BlasInfos.size();
+    std::vector<vk::AccelerationStructureKHR> handles = {};
+    for (uint32_t i = 0; i < count; i++)
+        handles.push_back(m_Blases[i].Handle);
+
+    vk::QueryPool queryPool = DeviceContext::GetLogical().createQueryPool(vk::QueryPoolCreateInfo(
+        vk::QueryPoolCreateFlags(), vk::QueryType::eAccelerationStructureSerializationSizeKHR, count
+    ));
+
+    Renderer::s_MainCommandBuffer->Begin();
+    Renderer::s_MainCommandBuffer->Buffer.resetQueryPool(queryPool, 0, count);
+    Renderer::s_MainCommandBuffer->Buffer.writeAccelerationStructuresPropertiesKHR(
+        handles, vk::QueryType::eAccelerationStructureSerializationSizeKHR, queryPool, 0,
+        Application::GetDispatchLoader()
+    );
+    Renderer::s_MainCommandBuffer->SubmitBlocking();
+
+    const std::vector<vk::DeviceSize> sizes =
+        DeviceContext::GetLogical()
+            .getQueryPoolResults<vk::DeviceSize>(
+                queryPool, 0, count, count * sizeof(vk::DeviceSize), sizeof(vk::DeviceSize),
+                vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait
+            )
+            .value;
+    DeviceContext::GetLogical().destroyQueryPool(queryPool);
+
+    // Serialize in batches to keep the host visible memory within the scratch budget
+    const vk::DeviceSize budget = Application::GetConfig().MaxBlasBuildScratchSize;
+    uint32_t batchBegin = 0;
+    while (batchBegin < count)
+    {
+        std::vector<vk::DeviceSize> offsets = {};
+        vk::DeviceSize batchSize = 0;
+        uint32_t batchEnd = batchBegin;
+        for (; batchEnd < count; batchEnd++)
+        {
+            const vk::DeviceSize size = Utils::AlignTo(sizes[batchEnd], 256);
+            if (batchSize > 0 && batchSize + size > budget)
+                break;
+
+            offsets.push_back(batchSize);
+            batchSize += size;
+        }
+
+        const Buffer buffer = BufferBuilder()
+                                  .SetUsageFlags(vk::BufferUsageFlagBits::eShaderDeviceAddress)
+                                  .SetAlignment(256)
+                                  .CreateHostBuffer(batchSize, "BLAS Serialization Buffer");
+
+        Renderer::s_MainCommandBuffer->Begin();
+        for (uint32_t i = batchBegin; i < batchEnd; i++)
+            Renderer::s_MainCommandBuffer->Buffer.copyAccelerationStructureToMemoryKHR(
+                vk::CopyAccelerationStructureToMemoryInfoKHR(
+                    m_Blases[i].Handle, buffer.GetDeviceAddress() + offsets[i - batchBegin],
+                    vk::CopyAccelerationStructureModeKHR::eSerialize
+                ),
+                Application::GetDispatchLoader()
+            );
+
+        vk::MemoryBarrier2 barrier(
+            vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR, vk::AccessFlagBits2::eTransferWrite,
+            vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead
+        );
+        vk::DependencyInfo info;
+        info.setMemoryBarriers(barrier);
+        Renderer::s_MainCommandBuffer->Buffer.pipelineBarrier2(info);
+        Renderer::s_MainCommandBuffer->SubmitBlocking();
+
+        std::vector<std::byte> data(batchSize);
+        buffer.Readback(data);
+
+        // Files are renamed into place once written, so an interrupted write never leaves a partial file
+        for (uint32_t i = batchBegin; i < batchEnd; i++)
+        {
+            const std::filesystem::path path = GetCachePath(m_BlasInfos[i].CacheKey);
+            std::filesystem::path tempPath = path;
+            tempPath += ".tmp";
+
+            {
+                std::ofstream file(tempPath, std::ios::binary);
+                file.write(reinterpret_cast<const char *>(data.data() + offsets[i - batchBegin]), sizes[i]);
+                file.close();
+
+                if (!file.good())
+                {
+                    logger::warn("Could not write BLAS cache file {}", path.string());
+                    std::filesystem::remove(tempPath);
+                    continue;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(tempPath, path, error);
+            if (error)
+            {
+                logger::warn("Could not write BLAS cache file {}: {}", path.string(), error.message());
+                std::filesystem::remove(tempPath, error);
+            }
+        }
+
+        batchBegin = batchEnd;
+    }
+}
+
+std::vector<BlasSet::Blas> BlasSet::DeserializeBlases()
+{
+    if (m_CachedBlases.empty())
+        return {};
+
+    std::vector<vk::DeviceSize> offsets = {};
+    vk::DeviceSize totalSize = 0;
+    for (const CachedBlas &cached : m_CachedBlases)
+    {
+        offsets.push_back(totalSize);
+        totalSize += Utils::AlignTo(cached.Size, 256);
+    }
+
+    m_CachedBlasBuffer = BufferBuilder()
+                             .SetUsageFlags(
+                                 vk::BufferUsageFlagBits::eStorageBuffer |
+                                 vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
+                                 vk::BufferUsageFlagBits::eShaderDeviceAddress
+                             )
+                             .CreateDeviceBuffer(totalSize, "Cached BLAS Buffer");
+
+    // Upload the serialized data in batches that fit into the scratch budget
+    const vk::DeviceSize budget = Application::GetConfig().MaxBlasBuildScratchSize;
+    std::vector<std::byte> data;
+    std::vector<Blas> blases = {};
+    std::vector<CachedBlas> unreadable = {};
+    size_t batchBegin = 0;
+    while (batchBegin < m_CachedBlases.size())
+    {
+        std::vector<vk::DeviceSize> stagingOffsets = {};
+        vk::DeviceSize batchSize = 0;
+        size_t batchEnd = batchBegin;
+        for (; batchEnd < m_CachedBlases.size(); batchEnd++)
+        {
+            const vk::DeviceSize size = Utils::AlignTo(m_CachedBlases[batchEnd].SerializedSize, 256);
+            if (batchSize > 0 && batchSize + size > budget)
+                break;
+
+            stagingOffsets.push_back(batchSize);
+            batchSize += size;
+        }
+
+        const Buffer staging = BufferBuilder()
+                                   .SetUsageFlags(vk::BufferUsageFlagBits::eShaderDeviceAddress)
+                                   .SetAlignment(256)
+                                   .CreateHostBuffer(batchSize, "BLAS Deserialization Buffer");
+
+        Renderer::s_MainCommandBuffer->Begin();
+        for (size_t i = batchBegin; i < batchEnd; i++)
+        {
+            const CachedBlas &cached = m_CachedBlases[i];
+
+            // Only the current batch is kept in memory
+            data.resize(cached.SerializedSize);
+            std::ifstream file(cached.Path, std::ios::binary);
+            if (!file.read(reinterpret_cast<char *>(data.data()), data.size()))
+            {
+                logger::warn("BLAS cache file {} changed while loading", cached.Path.string());
+                unreadable.push_back(cached);
+                continue;
+            }
+            staging.Upload(BufferContent(data.data(), data.size()), stagingOffsets[i - batchBegin]);
+
+            vk::AccelerationStructureCreateInfoKHR createInfo(
+                vk::AccelerationStructureCreateFlagsKHR(), m_CachedBlasBuffer.GetHandle(), offsets[i],
+                cached.Size, vk::AccelerationStructureTypeKHR::eBottomLevel
+            );
+
+            vk::AccelerationStructureKHR blas = DeviceContext::GetLogical().createAccelerationStructureKHR(
+                createInfo, nullptr, Application::GetDispatchLoader()
+            );
+            vk::DeviceAddress address = DeviceContext::GetLogical().getAccelerationStructureAddressKHR(
+                { blas }, Application::GetDispatchLoader()
+            );
+
+            Renderer::s_MainCommandBuffer->Buffer.copyMemoryToAccelerationStructureKHR(
+                vk::CopyMemoryToAccelerationStructureInfoKHR(
+                    staging.GetDeviceAddress() + stagingOffsets[i - batchBegin], blas,
+                    vk::CopyAccelerationStructureModeKHR::eDeserialize
+                ),
+                Application::GetDispatchLoader()
+            );
+
+            blases.emplace_back(blas, address, cached.ModelIndex);
+            Utils::SetDebugName(blas, std::format("BLAS {}", cached.ModelIndex));
+        }
+        m_CachedBlasBuffer.AddBarrier(
+            Renderer::s_MainCommandBuffer->Buffer, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+            vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
+        );
+        Renderer::s_MainCommandBuffer->SubmitBlocking();
+
+        batchBegin = batchEnd;
+    }
+
+    m_CachedBlases = std::move(unreadable);
+    return blases;
+}
+
+void BlasSet::AddScratchReuseBarrier(vk::CommandBuffer commandBuffer)
+{
+    // The next batch overwrites the scratch memory of the previous one
+    vk::MemoryBarrier2 barrier(
+        vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+        vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        vk::AccessFlagBits2::eAccelerationStructureReadKHR |
+            vk::AccessFlagBits2::eAccelerationStructureWriteKHR
+    );
+    vk::DependencyInfo info;
+    info.setMemoryBarriers(barrier);
+    commandBuffer.pipelineBarrier2(info);
+}
+
+std::span<const BlasSet::Blas> BlasSet::GetBlases() const
+{
+    return m_Blases;
 }
 
-void AccelerationStructure::CreateBlases()
+bool BlasSet::IsOpaque() const
+{
+    return m_IsOpaque;
+}
+
+std::vector<BlasSet::Blas> BlasSet::CreateBlases(const Scene &scene)
 {
     vk::DeviceSize totalBlasBufferSize = 0;
-    vk::DeviceSize totalBlasScratchBufferSize = 0;
+    vk::DeviceSize totalUpdateScratchBufferSize = 0;
+    std::vector<uint32_t> modelIndices = {};
+    std::vector<std::pair<uint32_t, size_t>> newBlases = {};
+
+    // Find the BLASes missing from the cache
+    for (uint32_t modelIndex = 0; modelIndex < scene.GetModels().size(); modelIndex++)
+    {
+        const Model &model = scene.GetModels()[modelIndex];
+        const bool isAnimated = std::ranges::any_of(model.Meshes, [&scene](const Mesh &mesh) {
+            return scene.GetGeometries()[mesh.GeometryIndex].IsAnimated;
+        });
+
+        if (isAnimated != m_IsAnimated)
+            continue;
+
+        size_t cacheKey = 0;
+        if (m_IsCacheEnabled)
+        {
+            cacheKey = GetCacheKey(scene, model);
+            if (LoadCachedBlas(cacheKey, modelIndex))
+            {
+                for (const auto &mesh : model.Meshes)
+                    m_IsOpaque &= scene.GetGeometries()[mesh.GeometryIndex].IsOpaque;
+                continue;
+            }
+        }
+
+        newBlases.emplace_back(modelIndex, cacheKey);
+    }
+
+    // Cache files that can't be read anymore are dropped and their BLASes are built like any other miss
+    std::vector<Blas> cachedBlases = DeserializeBlases();
+    for (const CachedBlas &cached : m_CachedBlases)
+        newBlases.emplace_back(cached.ModelIndex, cached.CacheKey);
+    m_CachedBlases.clear();
 
     // Gather info about the BLASes
-    for (const auto &model : m_Scene->GetModels())
+    for (const auto [modelIndex, cacheKey] : newBlases)
     {
+        const Model &model = scene.GetModels()[modelIndex];
         std::vector<uint32_t> primitiveCounts = {};
 
         BlasInfo &blasInfo = m_BlasInfos.emplace_back();
+        blasInfo.CacheKey = cacheKey;
         blasInfo.Ranges.reserve(model.Meshes.size());
         blasInfo.Geometries.reserve(model.Meshes.size());
+        modelIndices.push_back(modelIndex);
 
         for (const auto &mesh : model.Meshes)
         {
-            const Geometry geometry = m_Scene->GetGeometries()[mesh.GeometryIndex];
+            const Geometry geometry = scene.GetGeometries()[mesh.GeometryIndex];
             const bool hasTransform = mesh.TransformBufferOffset != SceneBuilder::IdentityTransformIndex;
 
-            vk::DeviceAddress vertexBufferAddress =
-                geometry.IsAnimated ? m_AnimatedVertexBufferAddress : m_VertexBufferAddress;
+            vk::DeviceAddress positionBufferAddress =
+                geometry.IsAnimated ? m_Addresses.AnimatedPositions : m_Addresses.Positions;
             vk::DeviceAddress indexBufferAddress =
-                geometry.IsAnimated ? m_AnimatedIndexBufferAddress : m_IndexBufferAddress;
+                geometry.IsAnimated ? m_Addresses.AnimatedIndices : m_Addresses.Indices;
+            const vk::IndexType indexType =
+                geometry.HasShortIndices ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
 
             vk::AccelerationStructureGeometryTrianglesDataKHR geometryData(
-                vk::Format::eR32G32B32Sfloat, vertexBufferAddress, sizeof(Shaders::Vertex),
-                geometry.VertexLength - 1, vk::IndexType::eUint32, indexBufferAddress,
-                hasTransform ? m_TransformBufferAddress : vk::DeviceOrHostAddressConstKHR()
+                vk::Format::eR32G32B32Sfloat, positionBufferAddress, sizeof(glm::vec3),
+                geometry.VertexLength - 1, indexType, indexBufferAddress,
+                hasTransform ? m_Addresses.Transforms : vk::DeviceOrHostAddressConstKHR()
             );
 
             blasInfo.Geometries.emplace_back(
@@ -96,7 +697,6 @@ void AccelerationStructure::CreateBlases()
                 geometry.IsOpaque ? vk::GeometryFlagBitsKHR::eOpaque : vk::GeometryFlagsKHR()
             );
 
-            blasInfo.IsAnimated |= geometry.IsAnimated;
             m_IsOpaque &= geometry.IsOpaque;
             primitiveCounts.push_back(geometry.IndexLength / 3);
 
@@ -109,8 +709,13 @@ void AccelerationStructure::CreateBlases()
             );
         }
 
+        // Static BLASes are never refitted, so they don't pay for the update support
+        vk::BuildAccelerationStructureFlagsKHR flags = GetFlags(m_IsAnimated);
+        if (m_AllowCompaction)
+            flags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction;
+
         blasInfo.BuildInfo = vk::AccelerationStructureBuildGeometryInfoKHR(
-            vk::AccelerationStructureTypeKHR::eBottomLevel, GetFlags(blasInfo.IsAnimated)
+            vk::AccelerationStructureTypeKHR::eBottomLevel, flags
         );
         blasInfo.BuildInfo.setGeometries(blasInfo.Geometries);
 
@@ -121,22 +726,48 @@ void AccelerationStructure::CreateBlases()
             );
 
         blasInfo.BlasBufferOffset = totalBlasBufferSize;
-        blasInfo.BlasScratchBufferOffset = totalBlasScratchBufferSize;
         blasInfo.BlasBufferSize = buildSizesInfo.accelerationStructureSize;
+        blasInfo.BuildScratchSize = buildSizesInfo.buildScratchSize;
         totalBlasBufferSize += Utils::AlignTo(buildSizesInfo.accelerationStructureSize, 256);
-        totalBlasScratchBufferSize +=
-            Utils::AlignTo(buildSizesInfo.buildScratchSize, m_ScratchOffsetAlignment);
+
+        // Only animated BLASes keep their scratch memory for updates
+        if (m_IsAnimated)
+        {
+            blasInfo.UpdateScratchOffset = totalUpdateScratchBufferSize;
+            totalUpdateScratchBufferSize +=
+                Utils::AlignTo(buildSizesInfo.updateScratchSize, m_ScratchOffsetAlignment);
+            m_RebuildScratchStride = std::max<vk::DeviceSize>(
+                m_RebuildScratchStride,
+                Utils::AlignTo(buildSizesInfo.buildScratchSize, m_ScratchOffsetAlignment)
+            );
+        }
     }
 
+    if (m_BlasInfos.empty())
+        return cachedBlases;
+
     auto builder = BufferBuilder().SetUsageFlags(
         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
         vk::BufferUsageFlagBits::eShaderDeviceAddress
     );
 
-    m_BlasBuffer = builder.CreateDeviceBuffer(totalBlasBufferSize, "BLAS Buffer");
+    m_BlasBuffer = builder.CreateDeviceBuffer(
+        totalBlasBufferSize, m_IsAnimated ? "Animated BLAS Buffer" : "Static BLAS Buffer"
+    );
+
+    if (m_IsAnimated)
+    {
+        m_UpdateScratchBuffer =
+            builder.SetAlignment(m_ScratchOffsetAlignment)
+                .CreateDeviceBuffer(totalUpdateScratchBufferSize, "BLAS Update Scratch Buffer");
 
-    m_BlasScratchBuffer = builder.SetAlignment(m_ScratchOffsetAlignment)
-                              .CreateDeviceBuffer(totalBlasScratchBufferSize, "BLAS Scratch Buffer");
+        const uint32_t rebuildCount =
+            std::min<uint32_t>(Application::GetConfig().MaxBlasRebuildsPerFrame, m_BlasInfos.size());
+        if (rebuildCount > 0)
+            m_RebuildScratchBuffer = builder.CreateDeviceBuffer(
+                rebuildCount * m_RebuildScratchStride, "BLAS Rebuild Scratch Buffer"
+            );
+    }
 
     // Create the BLASes
     for (uint32_t i = 0; i < m_BlasInfos.size(); i++)
@@ -151,19 +782,155 @@ void AccelerationStructure::CreateBlases()
         vk::AccelerationStructureKHR blas = DeviceContext::GetLogical().createAccelerationStructureKHR(
             createInfo, nullptr, Application::GetDispatchLoader()
         );
-        blasInfo.BuildInfo.setSrcAccelerationStructure(blas).setDstAccelerationStructure(blas).setScratchData(
-            m_BlasScratchBuffer.GetDeviceAddress() + blasInfo.BlasScratchBufferOffset
-        );
+        blasInfo.BuildInfo.setSrcAccelerationStructure(blas).setDstAccelerationStructure(blas);
         vk::DeviceAddress address = DeviceContext::GetLogical().getAccelerationStructureAddressKHR(
             { blas }, Application::GetDispatchLoader()
         );
 
-        m_Blases.emplace_back(blas, address);
+        m_Blases.emplace_back(blas, address, modelIndices[i]);
+
+        Utils::SetDebugName(blas, std::format("BLAS {}", modelIndices[i]));
+    }
+
+    return cachedBlases;
+}
+
+void BlasSet::BuildBlases(
+    vk::CommandBuffer commandBuffer, std::span<BlasInfo *const> infos, vk::DeviceAddress scratchAddress,
+    vk::BuildAccelerationStructureModeKHR mode
+)
+{
+    if (infos.empty())
+        return;
+
+    const bool isUpdate = mode == vk::BuildAccelerationStructureModeKHR::eUpdate;
+
+    // Build all BLASes of the batch at once
+    std::vector<const vk::AccelerationStructureBuildRangeInfoKHR *> outRanges = {};
+    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> outBuild = {};
+    for (BlasInfo *info : infos)
+    {
+        info->BuildInfo.setMode(mode).setScratchData(
+            scratchAddress + (isUpdate ? info->UpdateScratchOffset : info->BuildScratchOffset)
+        );
+
+        outRanges.push_back(info->Ranges.data());
+        outBuild.push_back(info->BuildInfo);
+    }
 
-        Utils::SetDebugName(blas, std::format("BLAS {}", i));
+    {
+        Utils::DebugLabel label(commandBuffer, "BLAS Build", { 0.96f, 0.95f, 0.48f, 1.0f });
+        commandBuffer.buildAccelerationStructuresKHR(outBuild, outRanges, Application::GetDispatchLoader());
     }
 }
 
+AccelerationStructure::AccelerationStructure(
+    const GeometryBufferAddresses &addresses, const BlasSet &staticBlases,
+    std::shared_ptr<const Scene> scene, uint32_t hitGroupCount
+)
+    : m_ScratchOffsetAlignment(
+          DeviceContext::GetAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment
+      ),
+      m_HitGroupCount(hitGroupCount), m_Scene(std::move(scene))
+{
+    Timer timer("Acceleration Structure Build");
+
+    m_InstanceTransformsVersion = m_Scene->GetInstanceTransformsVersion();
+    m_BlasAddresses.resize(m_Scene->GetModels().size());
+    for (const auto &blas : staticBlases.GetBlases())
+        m_BlasAddresses[blas.ModelIndex] = blas.Address;
+    m_IsOpaque = staticBlases.IsOpaque();
+
+    if (m_Scene->HasSkeletalAnimations())
+    {
+        m_AnimatedBlases = std::make_unique<BlasSet>(addresses, *m_Scene, true);
+        for (const auto &blas : m_AnimatedBlases->GetBlases())
+            m_BlasAddresses[blas.ModelIndex] = blas.Address;
+        m_IsOpaque &= m_AnimatedBlases->IsOpaque();
+    }
+
+    if (m_Scene->HasAnimations() && DeviceContext::GetProperties().limits.timestampComputeAndGraphics)
+        m_TimestampQueryPool = DeviceContext::GetLogical().createQueryPool(
+            vk::QueryPoolCreateInfo(vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, 2)
+        );
+
+    Renderer::s_MainCommandBuffer->Begin();
+    CreateTlas();
+    BuildTlas(Renderer::s_MainCommandBuffer->Buffer, vk::BuildAccelerationStructureModeKHR::eBuild);
+    Renderer::s_MainCommandBuffer->SubmitBlocking();
+}
+
+AccelerationStructure::~AccelerationStructure()
+{
+    DeviceContext::GetLogical().destroyQueryPool(m_TimestampQueryPool);
+    DeviceContext::GetLogical().destroyAccelerationStructureKHR(
+        m_Tlas, nullptr, Application::GetDispatchLoader()
+    );
+}
+
+void AccelerationStructure::RecordUpdateCommands(vk::CommandBuffer commandBuffer)
+{
+    assert(m_Scene->HasAnimations());
+
+    Timer timer("Acceleration Structure Update");
+
+    if (m_TimestampQueryPool != nullptr)
+    {
+        ReadUpdateTime();
+        commandBuffer.resetQueryPool(m_TimestampQueryPool, 0, 2);
+        commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, m_TimestampQueryPool, 0);
+        m_IsTimestampPending = true;
+    }
+
+    bool isBlasUpdated = false;
+    if (m_AnimatedBlases != nullptr)
+        isBlasUpdated = m_AnimatedBlases->RecordUpdateCommands(commandBuffer, m_Scene->GetModelVersions());
+
+    if (isBlasUpdated)
+        m_AnimatedBlases->AddBuildSyncBarrier(commandBuffer);
+
+    // Refitted BLASes change the bounds of their instances, so the TLAS has to follow them
+    const uint32_t instanceTransformsVersion = m_Scene->GetInstanceTransformsVersion();
+    if (isBlasUpdated || m_InstanceTransformsVersion != instanceTransformsVersion)
+    {
+        m_InstanceTransformsVersion = instanceTransformsVersion;
+        BuildTlas(commandBuffer, vk::BuildAccelerationStructureModeKHR::eUpdate);
+        AddTraceBarrier(commandBuffer);
+    }
+
+    if (m_TimestampQueryPool != nullptr)
+        commandBuffer.writeTimestamp2(
+            vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR, m_TimestampQueryPool, 1
+        );
+}
+
+vk::AccelerationStructureKHR AccelerationStructure::GetTlas() const
+{
+    return m_Tlas;
+}
+
+void AccelerationStructure::ReadUpdateTime()
+{
+    if (!m_IsTimestampPending)
+        return;
+
+    // The frame that recorded the timestamps has already finished
+    const auto timestamps = DeviceContext::GetLogical().getQueryPoolResults<uint64_t>(
+        m_TimestampQueryPool, 0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64
+    );
+    if (timestamps.result != vk::Result::eSuccess)
+        return;
+
+    m_IsTimestampPending = false;
+    const float nanoseconds = static_cast<float>(timestamps.value[1] - timestamps.value[0]) *
+                              DeviceContext::GetProperties().limits.timestampPeriod;
+
+    Stats::AddStat(
+        "Acceleration Structure Update GPU", "Acceleration Structure Update (GPU): {:.3f} ms",
+        nanoseconds / 1000000.0f
+    );
+}
+
 void AccelerationStructure::CreateTlas()
 {
     const uint32_t instanceCount = m_Scene->GetModelInstances().size();
@@ -226,37 +993,6 @@ void AccelerationStructure::CreateTlas()
                               .CreateDeviceBuffer(scratchSize, "Scratch Buffer (TLAS)");
 }
 
-void AccelerationStructure::BuildBlases(
-    vk::CommandBuffer commandBuffer, vk::BuildAccelerationStructureModeKHR mode
-)
-{
-    if (m_BlasInfos.empty())
-        return;
-
-    // Build all BLASes at once
-    std::vector<const vk::AccelerationStructureBuildRangeInfoKHR *> outRanges = {};
-    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> outBuild = {};
-    for (const BlasInfo &info : m_BlasInfos)
-    {
-        outRanges.push_back(info.Ranges.data());
-        outBuild.push_back(info.BuildInfo);
-    }
-    
-    {
-        Utils::DebugLabel label(commandBuffer, "BLAS Build", { 0.96f, 0.95f, 0.48f, 1.0f });
-        commandBuffer.buildAccelerationStructuresKHR(outBuild, outRanges, Application::GetDispatchLoader());
-    }
-
-    // Prepare BLASes for updates
-    if (mode == vk::BuildAccelerationStructureModeKHR::eBuild)
-    {
-        std::erase_if(m_BlasInfos, [](auto &info) { return !info.IsAnimated; });
-
-        for (BlasInfo &info : m_BlasInfos)
-            info.BuildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eUpdate);
-    }
-}
-
 void AccelerationStructure::BuildTlas(
     vk::CommandBuffer commandBuffer, vk::BuildAccelerationStructureModeKHR mode
 )
@@ -270,7 +1006,7 @@ void AccelerationStructure::BuildTlas(
         instances.emplace_back(
             TrivialCopy<glm::mat3x4, vk::TransformMatrixKHR>(instance.Transform), customIndex, 0xff,
             m_Scene->GetModels()[instance.ModelIndex].MeshOffset * m_HitGroupCount,
-            vk::GeometryInstanceFlagsKHR(), m_Blases[instance.ModelIndex].Address
+            vk::GeometryInstanceFlagsKHR(), m_BlasAddresses[instance.ModelIndex]
         );
     }
 
@@ -300,14 +1036,6 @@ void AccelerationStructure::BuildTlas(
     }
 }
 
-void AccelerationStructure::AddBuildSyncBarrier(vk::CommandBuffer commandBuffer)
-{
-    m_BlasBuffer.AddBarrier(
-        commandBuffer, vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
-        vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
-    );
-}
-
 void AccelerationStructure::AddTraceBarrier(vk::CommandBuffer commandBuffer)
 {
     m_TlasBuffer.AddBarrier(
@@ -316,11 +1044,4 @@ void AccelerationStructure::AddTraceBarrier(vk::CommandBuffer commandBuffer)
     );
 }
 
-vk::BuildAccelerationStructureFlagsKHR AccelerationStructure::GetFlags(bool isAnimated) const
-{
-    return m_Scene->HasAnimations() ? vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace |
-                                          vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate
-                                    : vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
-}
-
 }
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <filesystem>
 #include <memory>
 #include <span>
 #include <vector>
@@ -13,39 +14,53 @@
 namespace PathTracing
 {
 
-class AccelerationStructure
+struct GeometryBufferAddresses
+{
+    vk::DeviceAddress Positions = 0;
+    vk::DeviceAddress Indices = 0;
+    vk::DeviceAddress AnimatedPositions = 0;
+    vk::DeviceAddress AnimatedIndices = 0;
+    vk::DeviceAddress Transforms = 0;
+};
+
+// Bottom level acceleration structures of either all static or all animated models of a scene
+// Static BLASes are serialized to disk and deserialized instead of being rebuilt on the next run
+class BlasSet
 {
 public:
-    AccelerationStructure(
-        vk::DeviceAddress vertexBufferAddress, vk::DeviceAddress indexBufferAddress,
-        vk::DeviceAddress animatedVertexBufferAddress, vk::DeviceAddress animatedIndexBufferAddress,
-        vk::DeviceAddress transformBufferAddress, std::shared_ptr<const Scene> scene, uint32_t hitGroupCount
-    );
-    ~AccelerationStructure();
+    BlasSet(const GeometryBufferAddresses &addresses, const Scene &scene, bool isAnimated);
+    ~BlasSet();
 
-    AccelerationStructure(const AccelerationStructure &) = delete;
-    AccelerationStructure &operator=(const AccelerationStructure &) = delete;
+    BlasSet(const BlasSet &) = delete;
+    BlasSet &operator=(const BlasSet &) = delete;
 
-    void RecordUpdateCommands(vk::CommandBuffer commandBuffer);
+    // Updates BLASes of models whose version changed, returns false if nothing was recorded
+    // BLASes that were refitted too many times are rebuilt instead, within a per frame budget
+    bool RecordUpdateCommands(vk::CommandBuffer commandBuffer, std::span<const uint32_t> modelVersions);
+    void AddBuildSyncBarrier(vk::CommandBuffer commandBuffer) const;
 
-    [[nodiscard]] vk::AccelerationStructureKHR GetTlas() const;
+    struct Blas
+    {
+        vk::AccelerationStructureKHR Handle;
+        vk::DeviceAddress Address;
+        uint32_t ModelIndex;
+    };
+
+    [[nodiscard]] std::span<const Blas> GetBlases() const;
+    [[nodiscard]] bool IsOpaque() const;
 
 private:
     const vk::DeviceSize m_ScratchOffsetAlignment;
-
-    vk::DeviceAddress m_VertexBufferAddress;
-    vk::DeviceAddress m_AnimatedVertexBufferAddress;
-    vk::DeviceAddress m_IndexBufferAddress;
-    vk::DeviceAddress m_AnimatedIndexBufferAddress;
-    vk::DeviceAddress m_TransformBufferAddress;
-
-    const uint32_t m_HitGroupCount;
-    std::shared_ptr<const Scene> m_Scene;
-
-    Buffer m_InstanceBuffer;
+    const GeometryBufferAddresses m_Addresses;
+    const bool m_IsAnimated;
+    const bool m_AllowCompaction;
+    const bool m_IsCacheEnabled;
 
     Buffer m_BlasBuffer;
-    Buffer m_BlasScratchBuffer;
+    Buffer m_CachedBlasBuffer;
+    Buffer m_UpdateScratchBuffer;
+    Buffer m_RebuildScratchBuffer;
+    vk::DeviceSize m_RebuildScratchStride = 0;
 
     struct BlasInfo
     {
@@ -54,36 +69,96 @@ private:
         vk::AccelerationStructureBuildGeometryInfoKHR BuildInfo;
 
         vk::DeviceSize BlasBufferOffset = 0;
-        vk::DeviceSize BlasScratchBufferOffset = 0;
         vk::DeviceSize BlasBufferSize = 0;
-        bool IsAnimated = false;
+        vk::DeviceSize BuildScratchSize = 0;
+        vk::DeviceSize BuildScratchOffset = 0;
+        vk::DeviceSize UpdateScratchOffset = 0;
+        uint32_t ModelVersion = -1;
+        uint32_t RefitCount = 0;
+        size_t CacheKey = 0;
     };
 
-    struct Blas
+    // Only the validated header is read up front, the data is read when its batch is deserialized
+    struct CachedBlas
     {
-        vk::AccelerationStructureKHR Handle;
-        vk::DeviceAddress Address;
+        uint32_t ModelIndex;
+        size_t CacheKey;
+        vk::DeviceSize Size;
+        vk::DeviceSize SerializedSize;
+        std::filesystem::path Path;
     };
 
     std::vector<BlasInfo> m_BlasInfos;
+    std::vector<CachedBlas> m_CachedBlases;
     std::vector<Blas> m_Blases;
 
     bool m_IsOpaque = true;
+
+private:
+    // Returns the BLASes loaded from the cache, the rest are created for BuildNewBlases
+    [[nodiscard]] std::vector<Blas> CreateBlases(const Scene &scene);
+    void BuildNewBlases();
+    void BuildBlases(
+        vk::CommandBuffer commandBuffer, std::span<BlasInfo *const> infos, vk::DeviceAddress scratchAddress,
+        vk::BuildAccelerationStructureModeKHR mode
+    );
+
+    void CompactBlases(vk::QueryPool queryPool);
+
+    [[nodiscard]] size_t GetCacheKey(const Scene &scene, const Model &model) const;
+    [[nodiscard]] std::filesystem::path GetCachePath(size_t cacheKey) const;
+    bool LoadCachedBlas(size_t cacheKey, uint32_t modelIndex);
+    void SerializeBlases() const;
+    // Cache files that fail to read are left in m_CachedBlases
+    [[nodiscard]] std::vector<Blas> DeserializeBlases();
+
+    static void AddScratchReuseBarrier(vk::CommandBuffer commandBuffer);
+};
+
+// Per frame in flight: animated BLASes and the TLAS, static BLASes are shared between frames
+class AccelerationStructure
+{
+public:
+    AccelerationStructure(
+        const GeometryBufferAddresses &addresses, const BlasSet &staticBlases,
+        std::shared_ptr<const Scene> scene, uint32_t hitGroupCount
+    );
+    ~AccelerationStructure();
+
+    AccelerationStructure(const AccelerationStructure &) = delete;
+    AccelerationStructure &operator=(const AccelerationStructure &) = delete;
+
+    void RecordUpdateCommands(vk::CommandBuffer commandBuffer);
+
+    [[nodiscard]] vk::AccelerationStructureKHR GetTlas() const;
+
+private:
+    const vk::DeviceSize m_ScratchOffsetAlignment;
+
+    const uint32_t m_HitGroupCount;
+    std::shared_ptr<const Scene> m_Scene;
+
+    std::unique_ptr<BlasSet> m_AnimatedBlases;
+    std::vector<vk::DeviceAddress> m_BlasAddresses;
+    uint32_t m_InstanceTransformsVersion = 0;
+
+    Buffer m_InstanceBuffer;
+
+    bool m_IsOpaque = true;
     Buffer m_TlasBuffer;
     Buffer m_TlasScratchBuffer;
     vk::AccelerationStructureKHR m_Tlas;
 
-private:
-    void CreateBlases();
-    void BuildBlases(vk::CommandBuffer commandBuffer, vk::BuildAccelerationStructureModeKHR mode);
+    vk::QueryPool m_TimestampQueryPool = nullptr;
+    bool m_IsTimestampPending = false;
 
+private:
     void CreateTlas();
     void BuildTlas(vk::CommandBuffer commandBuffer, vk::BuildAccelerationStructureModeKHR mode);
 
-    void AddBuildSyncBarrier(vk::CommandBuffer commandBuffer);
     void AddTraceBarrier(vk::CommandBuffer commandBuffer);
 
-    [[nodiscard]] vk::BuildAccelerationStructureFlagsKHR GetFlags(bool isAnimated) const;
+    void ReadUpdateTime();
 };
 
 }
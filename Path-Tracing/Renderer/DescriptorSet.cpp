@@ -88,7 +88,8 @@ void DescriptorSet::UpdateImageArray(
 }
 
 void DescriptorSet::UpdateImageArrayFromViews(
-    uint32_t binding, uint32_t frameIndex, std::span<const vk::ImageView> views, vk::Sampler sampler, vk::ImageLayout layout
+    uint32_t binding, uint32_t frameIndex, std::span<const vk::ImageView> views, vk::Sampler sampler,
+    vk::ImageLayout layout, uint32_t firstIndex
 )
 {
     assert(frameIndex < m_FramesInFlight);
@@ -100,7 +101,7 @@ void DescriptorSet::UpdateImageArrayFromViews(
     for (auto view : views)
         imageInfos.emplace_back(sampler, view, layout);
 
-    AddWrite(binding, frameIndex, 0, views.size());
+    AddWrite(binding, frameIndex, firstIndex, views.size());
     desc.ImageInfos.push_back(std::move(imageInfos));
     desc.Writes.back().setImageInfo(desc.ImageInfos.back());
 }
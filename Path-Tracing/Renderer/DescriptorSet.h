@@ -38,7 +38,7 @@ public:
     );
     void UpdateImageArrayFromViews(
         uint32_t binding, uint32_t frameIndex, std::span<const vk::ImageView> views, vk::Sampler sampler,
-        vk::ImageLayout layout
+        vk::ImageLayout layout, uint32_t firstIndex = 0
     );
 
     void FlushUpdate(uint32_t frameIndex);
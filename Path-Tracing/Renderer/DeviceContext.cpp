@@ -85,13 +85,15 @@ void DeviceContext::Init(vk::Instance instance, vk::SurfaceKHR surface)
     s_PhysicalDevice.Properties = s_PhysicalDevice.Handle.getProperties2();
     s_PhysicalDevice.QueueFamilyProperties = s_PhysicalDevice.Handle.getQueueFamilyProperties2();
     std::tie(
-        s_PhysicalDevice.RayTracingPipelineProperties, s_PhysicalDevice.AccelerationStructureProperties
+        s_PhysicalDevice.IDProperties, s_PhysicalDevice.RayTracingPipelineProperties,
+        s_PhysicalDevice.AccelerationStructureProperties
     ) = s_PhysicalDevice.Handle
             .getProperties2<
-                vk::PhysicalDeviceProperties2, vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
+                vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties,
+                vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
                 vk::PhysicalDeviceAccelerationStructurePropertiesKHR>()
             .get<
-                vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
+                vk::PhysicalDeviceIDProperties, vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
                 vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
 
     logger::info("Selected physical device: {}", s_PhysicalDevice.Properties.properties.deviceName.data());
@@ -105,6 +107,7 @@ void DeviceContext::Init(vk::Instance instance, vk::SurfaceKHR surface)
 
     vk::PhysicalDeviceFeatures2 features;
     features.features.setSamplerAnisotropy(vk::True);
+    features.features.setTextureCompressionBC(vk::True);
 
     vk::PhysicalDeviceSynchronization2Features synchronizationFeatures;
     synchronizationFeatures.setSynchronization2(vk::True);
@@ -216,6 +219,16 @@ VmaAllocator DeviceContext::GetAllocator()
     return s_Allocator;
 }
 
+const vk::PhysicalDeviceProperties &DeviceContext::GetProperties()
+{
+    return s_PhysicalDevice.Properties.properties;
+}
+
+const vk::PhysicalDeviceIDProperties &DeviceContext::GetIDProperties()
+{
+    return s_PhysicalDevice.IDProperties;
+}
+
 const vk::PhysicalDeviceRayTracingPipelinePropertiesKHR &DeviceContext::GetRayTracingPipelineProperties()
 {
     return s_PhysicalDevice.RayTracingPipelineProperties;
@@ -255,6 +268,12 @@ bool DeviceContext::CheckSuitable(
         return false;
     }
 
+    if (!features.textureCompressionBC)
+    {
+        logger::warn("{} does not support BC Texture Compression", deviceName);
+        return false;
+    }
+
     logger::info("{} is a suitable device", deviceName);
     return true;
 }
@@ -52,6 +52,8 @@ public:
 
     static VmaAllocator GetAllocator();
 
+    static const vk::PhysicalDeviceProperties &GetProperties();
+    static const vk::PhysicalDeviceIDProperties &GetIDProperties();
     static const vk::PhysicalDeviceRayTracingPipelinePropertiesKHR &GetRayTracingPipelineProperties();
     static const vk::PhysicalDeviceAccelerationStructurePropertiesKHR &GetAccelerationStructureProperties();
 
@@ -62,6 +64,7 @@ private:
 
         vk::PhysicalDeviceProperties2 Properties;
         std::vector<vk::QueueFamilyProperties2> QueueFamilyProperties;
+        vk::PhysicalDeviceIDProperties IDProperties;
         vk::PhysicalDeviceRayTracingPipelinePropertiesKHR RayTracingPipelineProperties;
         vk::PhysicalDeviceAccelerationStructurePropertiesKHR AccelerationStructureProperties;
     } s_PhysicalDevice;
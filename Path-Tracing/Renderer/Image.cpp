@@ -74,6 +74,13 @@ Image::Image(
         assert(layers == 6);
 
     vk::ImageCreateFlags flags = isCube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags();
+
+    // Storage views of formats that don't support storage use a compatible format instead
+    const bool hasStorageFormat = (usageFlags & vk::ImageUsageFlagBits::eStorage) &&
+                                  GetStorageFormat(format) != format;
+    if (hasStorageFormat)
+        flags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+
     VkImageCreateInfo createInfo = vk::ImageCreateInfo(
         flags, vk::ImageType::e2D, format, vk::Extent3D(extent, 1), mipLevels, layers,
         vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usageFlags
@@ -109,6 +116,10 @@ Image::Image(
         vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(), m_Handle, viewType, format)
             .setSubresourceRange(range);
 
+    vk::ImageViewUsageCreateInfo viewUsageCreateInfo(usageFlags & ~vk::ImageUsageFlagBits::eStorage);
+    if (hasStorageFormat)
+        viewCreateInfo.setPNext(&viewUsageCreateInfo);
+
     m_View = DeviceContext::GetLogical().createImageView(viewCreateInfo);
 
     SetDebugName(name);
@@ -171,22 +182,23 @@ uint32_t Image::GetMipLevels() const
     return m_MipLevels;
 }
 
-uint32_t Image::GetMip(vk::Extent2D extent) const
+uint32_t Image::GetMipLevels(vk::Extent2D extent)
 {
-    return m_MipLevels - std::ceil(std::log2(std::max(extent.width, extent.height))) - 1;
+    return ComputeMipLevels(extent);
 }
 
 vk::Extent2D Image::GetMipExtent(vk::Extent2D extent, uint32_t mip)
 {
-    return vk::Extent2D(extent.width / std::pow(2, mip), extent.height / std::pow(2, mip));
+    return vk::Extent2D(std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u));
 }
 
 vk::DeviceSize Image::GetSize(vk::Extent2D extent, vk::Format format)
 {
-    size_t texels = static_cast<size_t>(extent.width) * extent.height;
-    size_t texelsPerBlock =
-        vk::blockExtent(format)[0] * vk::blockExtent(format)[1] * vk::blockExtent(format)[2];
-    return std::ceil(static_cast<float>(texels) / texelsPerBlock) * vk::blockSize(format);
+    // Blocks are counted per dimension, since they can't span multiple rows of the image
+    const auto blockExtent = vk::blockExtent(format);
+    const size_t blocksX = (extent.width + blockExtent[0] - 1) / blockExtent[0];
+    const size_t blocksY = (extent.height + blockExtent[1] - 1) / blockExtent[1];
+    return blocksX * blocksY * vk::blockSize(format);
 }
 
 vk::Extent2D Image::GetMipExtent(uint32_t mip) const
@@ -200,28 +212,6 @@ size_t Image::GetMipSize(uint32_t mip) const
     return GetSize(GetMipExtent(mip), m_Format);
 }
 
-void Image::CopyMipTo(vk::CommandBuffer commandBuffer, const Image &image, uint32_t mip) const
-{
-    assert(m_Layers == 1);
-    vk::Offset3D offset(0, 0, 0);
-
-    assert(GetMipExtent(mip) >= image.GetExtent());
-
-    vk::ImageCopy region(
-        GetMipLayer(mip), offset, image.GetMipLayer(0), offset, vk::Extent3D(image.GetExtent(), 1)
-    );
-
-    Transition(
-        commandBuffer, image.GetHandle(), vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
-        0, 1
-    );
-
-    commandBuffer.copyImage(
-        m_Handle, vk::ImageLayout::eTransferSrcOptimal, image.GetHandle(),
-        vk::ImageLayout::eTransferDstOptimal, region
-    );
-}
-
 void Image::UploadFromBuffer(
     vk::CommandBuffer commandBuffer, const Buffer &buffer, vk::DeviceSize offset, vk::Extent2D extent,
     uint32_t baseMip, uint32_t mips
@@ -244,8 +234,8 @@ void Image::UploadFromBuffer(
         );
 
         offset += Image::GetSize(mipExtent, m_Format);
-        mipExtent.width /= 2;
-        mipExtent.height /= 2;
+        mipExtent.width = std::max(mipExtent.width / 2, 1u);
+        mipExtent.height = std::max(mipExtent.height / 2, 1u);
     }
 
     Transition(
@@ -254,65 +244,18 @@ void Image::UploadFromBuffer(
     );
 }
 
-void Image::GenerateFullMips(
-    vk::CommandBuffer commandBuffer, vk::ImageLayout layout, uint32_t layer, uint32_t layerCount
-) const
+vk::ImageView Image::CreateStorageView(uint32_t mip) const
 {
-    GenerateMips(commandBuffer, layout, 0, m_MipLevels - 1, layer, layerCount);
-}
-
-void Image::GenerateMips(
-    vk::CommandBuffer commandBuffer, vk::ImageLayout layout, uint32_t fromMip, uint32_t toMip, uint32_t layer,
-    uint32_t layerCount
-) const
-{
-    if (m_MipLevels == 1)
-    {
-        Transition(commandBuffer, vk::ImageLayout::eTransferDstOptimal, layout, layer, layerCount);
-        return;
-    }
-
-    TransitionMip(
-        commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, fromMip,
-        layer, layerCount
-    );
-
-    for (uint32_t level = fromMip + 1; level <= toMip; level++)
-    {
-        vk::ImageBlit imageBlit(
-            GetMipLayer(level - 1, layer, layerCount), GetMipLevelArea(level - 1),
-            GetMipLayer(level, layer, layerCount), GetMipLevelArea(level)
-        );
-
-        TransitionMip(
-            commandBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, level, layer,
-            layerCount
-        );
-
-        commandBuffer.blitImage(
-            m_Handle, vk::ImageLayout::eTransferSrcOptimal, m_Handle, vk::ImageLayout::eTransferDstOptimal,
-            imageBlit, vk::Filter::eLinear
-        );
-
-        TransitionMip(
-            commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, level,
-            layer, layerCount
-        );
-    }
-
-    if (fromMip > 0)
-        Transition(commandBuffer, m_Handle, vk::ImageLayout::eUndefined, layout, 0, fromMip, layer);
+    assert(mip < m_MipLevels);
 
-    Transition(
-        commandBuffer, m_Handle, vk::ImageLayout::eTransferSrcOptimal, layout, fromMip, toMip - fromMip + 1,
-        layer, layerCount
-    );
+    vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, mip, 1, 0, 1);
+    vk::ImageViewCreateInfo viewCreateInfo =
+        vk::ImageViewCreateInfo(
+            vk::ImageViewCreateFlags(), m_Handle, vk::ImageViewType::e2D, GetStorageFormat(m_Format)
+        )
+            .setSubresourceRange(range);
 
-    if (m_MipLevels - toMip - 1 > 0)
-        Transition(
-            commandBuffer, m_Handle, vk::ImageLayout::eUndefined, layout, toMip + 1, m_MipLevels - toMip - 1,
-            layer, layerCount
-        );
+    return DeviceContext::GetLogical().createImageView(viewCreateInfo);
 }
 
 void Image::SetDebugName(const std::string &name) const
@@ -321,6 +264,19 @@ void Image::SetDebugName(const std::string &name) const
     Utils::SetDebugName(m_View, std::format("ImageView: {}", name));
 }
 
+vk::Format Image::GetStorageFormat(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eR8G8B8A8Srgb:
+        return vk::Format::eR8G8B8A8Unorm;
+    case vk::Format::eB8G8R8A8Srgb:
+        return vk::Format::eB8G8R8A8Unorm;
+    default:
+        return format;
+    }
+}
+
 vk::AccessFlags2 Image::GetAccessFlags(vk::ImageLayout layout)
 {
     switch (layout)
@@ -392,7 +348,10 @@ void Image::TransitionWithQueueChange(
 {
     if (bufferFrom == bufferTo)
     {
-        Transition(bufferFrom, m_Handle, layoutFrom, layoutTo, stageFrom, stageTo, accessFrom, accessTo);
+        Transition(
+            bufferFrom, m_Handle, layoutFrom, layoutTo, stageFrom, stageTo, accessFrom, accessTo, 0,
+            m_MipLevels, 0, m_Layers
+        );
         return;
     }
 
@@ -446,11 +405,6 @@ std::array<vk::Offset3D, 2> Image::GetMipLevelArea(vk::Extent2D extent, uint32_t
     return { vk::Offset3D(), vk::Offset3D(extent.width >> level, extent.height >> level, 1) };
 }
 
-std::array<vk::Offset3D, 2> Image::GetMipLevelArea(uint32_t level) const
-{
-    return GetMipLevelArea(vk::Extent2D(m_Extent.width >> level, m_Extent.height >> level));
-}
-
 vk::ImageSubresourceLayers Image::GetMipLayer(uint32_t level, uint32_t layer, uint32_t layerCount) const
 {
     return { vk::ImageAspectFlagBits::eColor, level, layer, layerCount };
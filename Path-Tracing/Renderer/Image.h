@@ -14,6 +14,7 @@ namespace PathTracing
 class Image
 {
 public:
+    static uint32_t GetMipLevels(vk::Extent2D extent);
     static vk::Extent2D GetMipExtent(vk::Extent2D extent, uint32_t mip);
     static vk::DeviceSize GetSize(vk::Extent2D extent, vk::Format format);
 
@@ -47,10 +48,10 @@ public:
     [[nodiscard]] uint32_t GetMipLevels() const;
 
     [[nodiscard]] vk::Extent2D GetMipExtent(uint32_t mip) const;
-    [[nodiscard]] uint32_t GetMip(vk::Extent2D extent) const;
     [[nodiscard]] size_t GetMipSize(uint32_t mip) const;
 
-    void CopyMipTo(vk::CommandBuffer commandBuffer, const Image &image, uint32_t mip) const;
+    // The view is owned by the caller, srgb images are viewed as unorm since srgb can't be used for storage
+    [[nodiscard]] vk::ImageView CreateStorageView(uint32_t mip) const;
 
     void UploadFromBuffer(
         vk::CommandBuffer commandBuffer, const Buffer &buffer, vk::DeviceSize offset, vk::Extent2D extent,
@@ -59,13 +60,6 @@ public:
 
     void SetDebugName(const std::string &name) const;
 
-    void GenerateFullMips(
-        vk::CommandBuffer commandBuffer, vk::ImageLayout layout, uint32_t layer = 0, uint32_t layerCount = 1
-    ) const;
-    void GenerateMips(
-        vk::CommandBuffer commandBuffer, vk::ImageLayout layout, uint32_t fromMip, uint32_t toMip,
-        uint32_t layer = 0, uint32_t layerCount = 1
-    ) const;
     void Transition(
         vk::CommandBuffer buffer, vk::ImageLayout layoutFrom, vk::ImageLayout layoutTo, uint32_t layer = 0,
         uint32_t layerCount = 1
@@ -109,11 +103,11 @@ private:
     bool m_IsMoved = false;
 
 private:
-    [[nodiscard]] std::array<vk::Offset3D, 2> GetMipLevelArea(uint32_t level = 0) const;
     [[nodiscard]] vk::ImageSubresourceLayers GetMipLayer(
         uint32_t level, uint32_t layer = 0, uint32_t layerCount = 1
     ) const;
 
+    static vk::Format GetStorageFormat(vk::Format format);
     static vk::AccessFlags2 GetAccessFlags(vk::ImageLayout layout);
     static vk::PipelineStageFlags2 GetPipelineStageFlags(vk::ImageLayout layout);
 };
@@ -1,6 +1,10 @@
+#include <glm/gtc/packing.hpp>
 #include <vulkan/vulkan.hpp>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <numeric>
 
 #include "Core/Core.h"
 
@@ -119,7 +123,9 @@ void Renderer::Init(const Swapchain *swapchain)
         Utils::SetDebugName(s_BloomSampler, "Bloom Sampler");
     }
 
-    s_TextureUploader = std::make_unique<TextureUploader>(s_Textures, s_DescriptorSetMutex);
+    s_TextureUploader = std::make_unique<TextureUploader>(
+        s_Textures, s_DescriptorSetMutex, *s_ShaderLibrary, s_Shaders.TextureMipsCompute
+    );
     s_TextureOwnershipCommandBuffer = std::make_unique<CommandBuffer>(DeviceContext::GetGraphicsQueue());
 
     s_OutputSaver = std::make_unique<OutputSaver>();
@@ -255,7 +261,11 @@ void Renderer::UpdateSceneData(const std::shared_ptr<Scene> &scene, bool updated
         );
 
         const auto &vertices = s_SceneData->Handle->GetVertices();
-        s_SceneData->VertexBuffer = CreateDeviceBufferUnflushed(vertices, "Vertex Buffer");
+        {
+            const auto positions = GetVertexPositions(vertices);
+            s_SceneData->PositionBuffer =
+                CreateDeviceBufferUnflushed(std::span(positions), "Position Buffer");
+        }
 
         const auto &indices = s_SceneData->Handle->GetIndices();
         s_SceneData->IndexBuffer = CreateDeviceBufferUnflushed(indices, "Index Buffer");
@@ -273,48 +283,67 @@ void Renderer::UpdateSceneData(const std::shared_ptr<Scene> &scene, bool updated
         const auto &transforms = s_SceneData->Handle->GetTransforms();
         s_SceneData->TransformBuffer = CreateDeviceBufferUnflushed(transforms, "Transform Buffer");
 
+        s_BufferBuilder->ResetFlags().SetUsageFlags(
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
+        );
+
+        const auto &normalMatrices = s_SceneData->Handle->GetNormalMatrices();
+        s_SceneData->NormalMatrixBuffer =
+            CreateDeviceBufferUnflushed(normalMatrices, "Normal Matrix Buffer");
+
         s_BufferBuilder->ResetFlags().SetUsageFlags(
             vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst
         );
 
+        // Shading attributes are only read by the hit shaders, so they stay out of BLAS builds
+        if (Application::GetConfig().PackVertices)
+        {
+            const auto attributes = PackVertexAttributes(vertices);
+            s_SceneData->AttributeBuffer =
+                CreateDeviceBufferUnflushed(std::span(attributes), "Vertex Attribute Buffer");
+        }
+        else
+        {
+            const auto attributes = GetVertexAttributes(vertices);
+            s_SceneData->AttributeBuffer =
+                CreateDeviceBufferUnflushed(std::span(attributes), "Vertex Attribute Buffer");
+        }
+
         const auto &animVertices = s_SceneData->Handle->GetAnimatedVertices();
-        s_SceneData->AnimatedVertexBuffer =
-            CreateDeviceBufferUnflushed(animVertices, "Animated Vertex Buffer");
+        if (Application::GetConfig().PackVertices)
+        {
+            const auto packedAnimVertices = PackAnimatedVertices(animVertices);
+            s_SceneData->AnimatedVertexBuffer =
+                CreateDeviceBufferUnflushed(std::span(packedAnimVertices), "Animated Vertex Buffer");
+        }
+        else
+            s_SceneData->AnimatedVertexBuffer =
+                CreateDeviceBufferUnflushed(animVertices, "Animated Vertex Buffer");
 
         const auto &geometries = s_SceneData->Handle->GetGeometries();
 
-        uint32_t animatedGeometryCount = 0;
-        std::vector<uint32_t> animatedVertexMap;
-
-        const auto &instances = s_SceneData->Handle->GetModelInstances();
         const auto &models = s_SceneData->Handle->GetModels();
-        for (const auto &instance : instances)
-            for (const auto &mesh : models[instance.ModelIndex].Meshes)
-            {
-                const auto &geometry = geometries[mesh.GeometryIndex];
-                if (geometry.IsAnimated)
-                {
-                    for (int i = 0; i < geometry.VertexLength; i++)
-                    {
-                        const auto &animVertex = animVertices[geometry.VertexOffset + i];
-                        s_SceneData->OutBindPoseAnimatedVertices.emplace_back(
-                            animVertex.Position, animVertex.TexCoords, animVertex.Normal, animVertex.Tangent,
-                            animVertex.Bitangent
-                        );
-                        animatedVertexMap.push_back(geometry.VertexOffset + i);
-                    }
-
-                    animatedGeometryCount++;
-                }
-            }
+
+        // Skinned vertices have the same layout as the animated vertices, so every animated geometry is
+        // skinned once and all instances of its model share the skinned vertices and the model's BLAS
+        std::vector<Shaders::Vertex> outBindPoseVertices;
+        outBindPoseVertices.reserve(animVertices.size());
+        for (const auto &animVertex : animVertices)
+            outBindPoseVertices.emplace_back(
+                animVertex.Position, animVertex.TexCoords, animVertex.Normal, animVertex.Tangent,
+                animVertex.Bitangent
+            );
+
+        s_SceneData->OutBindPosePositions = GetVertexPositions(outBindPoseVertices);
+        if (Application::GetConfig().PackVertices)
+            s_SceneData->PackedOutBindPoseAttributes = PackVertexAttributes(outBindPoseVertices);
+        else
+            s_SceneData->OutBindPoseAttributes = GetVertexAttributes(outBindPoseVertices);
 
         s_BufferBuilder->ResetFlags().SetUsageFlags(
             vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
         );
 
-        s_SceneData->AnimatedVertexMapBuffer =
-            CreateDeviceBufferUnflushed(std::span(animatedVertexMap), "Animated Vertex Map Buffer");
-
         const auto &metallicRoughnessMaterials = s_SceneData->Handle->GetMetallicRoughnessMaterials();
         s_SceneData->MetallicRoughnessMaterialBuffer =
             CreateDeviceBufferUnflushed(metallicRoughnessMaterials, "MetallicRoughness Material Buffer");
@@ -332,8 +361,8 @@ void Renderer::UpdateSceneData(const std::shared_ptr<Scene> &scene, bool updated
 
         std::vector<uint32_t> geometryIndexMap;
         s_SceneData->Geometries.clear();
-        s_SceneData->Geometries.reserve(geometries.size() + animatedGeometryCount);
-        geometryIndexMap.resize(geometries.size() + animatedGeometryCount);
+        s_SceneData->Geometries.reserve(geometries.size());
+        geometryIndexMap.resize(geometries.size());
 
         for (int i = 0; i < geometries.size(); i++)
         {
@@ -341,37 +370,38 @@ void Renderer::UpdateSceneData(const std::shared_ptr<Scene> &scene, bool updated
             if (!geometry.IsAnimated)
             {
                 s_SceneData->Geometries.emplace_back(
-                    s_SceneData->VertexBuffer.GetDeviceAddress() +
-                        geometry.VertexOffset * sizeof(Shaders::Vertex),
-                    s_SceneData->IndexBuffer.GetDeviceAddress() + geometry.IndexOffset * sizeof(uint32_t)
+                    s_SceneData->PositionBuffer.GetDeviceAddress() +
+                        geometry.VertexOffset * sizeof(glm::vec3),
+                    s_SceneData->AttributeBuffer.GetDeviceAddress() +
+                        geometry.VertexOffset * GetVertexAttributesSize(),
+                    s_SceneData->IndexBuffer.GetDeviceAddress() + geometry.IndexOffset * sizeof(uint32_t),
+                    GetIndexType(geometry)
                 );
                 geometryIndexMap[i] = s_SceneData->Geometries.size() - 1;
             }
         }
 
-        // TODO: Support instancing animated meshes: map out animated meshes to source animated meshes
+        // Skinned vertex addresses are relative, the per frame output buffer is added in CreateGeometryBuffer
         s_SceneData->AnimatedGeometriesOffset = s_SceneData->Geometries.size();
-        uint32_t animatedVertexOffset = 0, animatedGeometryIndex = 0;
-        for (const auto &instance : instances)
+        for (int i = 0; i < geometries.size(); i++)
         {
-            for (const auto &mesh : models[instance.ModelIndex].Meshes)
+            const auto &geometry = geometries[i];
+            if (geometry.IsAnimated)
             {
-                if (geometries[mesh.GeometryIndex].IsAnimated)
-                {
-                    const auto &geometry = geometries[mesh.GeometryIndex];
-                    s_SceneData->Geometries.emplace_back(
-                        0 + animatedVertexOffset * sizeof(Shaders::Vertex),
-                        s_SceneData->AnimatedIndexBuffer.GetDeviceAddress() +
-                            geometry.IndexOffset * sizeof(uint32_t)
-                    );
-
-                    animatedVertexOffset += geometry.VertexLength;
-                    geometryIndexMap[mesh.GeometryIndex] = s_SceneData->Geometries.size() - 1;
-                    animatedGeometryIndex++;
-                }
+                s_SceneData->Geometries.emplace_back(
+                    0 + geometry.VertexOffset * sizeof(glm::vec3),
+                    0 + geometry.VertexOffset * GetVertexAttributesSize(),
+                    s_SceneData->AnimatedIndexBuffer.GetDeviceAddress() +
+                        geometry.IndexOffset * sizeof(uint32_t),
+                    GetIndexType(geometry)
+                );
+                geometryIndexMap[i] = s_SceneData->Geometries.size() - 1;
             }
         }
 
+        // Static BLASes are shared between all frames in flight
+        CreateStaticAccelerationStructures();
+
         for (int i = 0; i < s_RenderingResources.size(); i++)
             CreateSceneRenderingResources(s_RenderingResources[i], i);
 
@@ -535,6 +565,8 @@ void Renderer::CreatePipelines()
         s_ShaderLibrary->AddShader("uiComposition.comp", vk::ShaderStageFlagBits::eCompute);
     s_Shaders.TonemappingCompute =
         s_ShaderLibrary->AddShader("toneMapping.comp", vk::ShaderStageFlagBits::eCompute);
+    s_Shaders.TextureMipsCompute =
+        s_ShaderLibrary->AddShader("textureMips.comp", vk::ShaderStageFlagBits::eCompute);
     s_Shaders.DebugRaygen =
         s_ShaderLibrary->AddShader("Debug/debugRaygen.rgen", vk::ShaderStageFlagBits::eRaygenKHR);
     s_Shaders.DebugMiss =
@@ -611,7 +643,7 @@ void Renderer::CreatePipelines()
 
     {
         ComputePipelineBuilder builder(*s_ShaderLibrary, s_Shaders.SkinningCompute);
-        static SkinningPipelineConfig maxSkinningConfig = {};
+        static SkinningPipelineConfig maxSkinningConfig = { Shaders::SkinningFlagsAll };
         s_SkinningPipeline = builder.CreatePipelineUnique(maxSkinningConfig);
     }
 
@@ -673,6 +705,115 @@ void Renderer::UpdateShaderBindingTable()
     );
 }
 
+Shaders::uint Renderer::GetIndexType(const Geometry &geometry)
+{
+    return geometry.HasShortIndices ? Shaders::IndexTypeUint16 : Shaders::IndexTypeUint32;
+}
+
+vk::DeviceSize Renderer::GetVertexAttributesSize()
+{
+    return Application::GetConfig().PackVertices ? sizeof(Shaders::PackedVertexAttributes)
+                                                  : sizeof(Shaders::VertexAttributes);
+}
+
+std::vector<Shaders::vec3> Renderer::GetVertexPositions(std::span<const Shaders::Vertex> vertices)
+{
+    std::vector<Shaders::vec3> positions(vertices.size());
+    std::ranges::transform(vertices, positions.begin(), &Shaders::Vertex::Position);
+    return positions;
+}
+
+std::vector<Shaders::VertexAttributes> Renderer::GetVertexAttributes(
+    std::span<const Shaders::Vertex> vertices
+)
+{
+    std::vector<Shaders::VertexAttributes> attributes(vertices.size());
+    std::ranges::transform(vertices, attributes.begin(), [](const Shaders::Vertex &vertex) {
+        return Shaders::VertexAttributes {
+            .TexCoords = vertex.TexCoords,
+            .Normal = vertex.Normal,
+            .Tangent = vertex.Tangent,
+            .Bitangent = vertex.Bitangent,
+        };
+    });
+
+    return attributes;
+}
+
+template<typename V> Shaders::PackedVertexAttributes Renderer::PackVertexAttributes(const V &vertex)
+{
+    // Has to match encodeOctahedral in common.glsl
+    auto encodeOctahedral = [](glm::vec3 v) {
+        const glm::vec2 p = glm::vec2(v) / std::max(glm::abs(v.x) + glm::abs(v.y) + glm::abs(v.z), 1e-20f);
+        const glm::vec2 signs = glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+        return glm::packSnorm2x16(v.z >= 0.0f ? p : (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signs);
+    };
+
+    const bool isBitangentFlipped =
+        glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f;
+
+    return Shaders::PackedVertexAttributes {
+        .TexCoords = glm::packHalf2x16(vertex.TexCoords),
+        .Normal = encodeOctahedral(vertex.Normal),
+        .Tangent = (encodeOctahedral(vertex.Tangent) & ~1u) | static_cast<uint32_t>(isBitangentFlipped),
+    };
+}
+
+std::vector<Shaders::PackedVertexAttributes> Renderer::PackVertexAttributes(
+    std::span<const Shaders::Vertex> vertices
+)
+{
+    std::vector<Shaders::PackedVertexAttributes> attributes(vertices.size());
+    std::ranges::transform(vertices, attributes.begin(), [](const Shaders::Vertex &vertex) {
+        return PackVertexAttributes(vertex);
+    });
+
+    return attributes;
+}
+
+std::vector<Shaders::PackedAnimatedVertex> Renderer::PackAnimatedVertices(
+    std::span<const Shaders::AnimatedVertex> vertices
+)
+{
+    static_assert(Shaders::MaxBones <= std::numeric_limits<uint16_t>::max() + 1);
+    static_assert(Shaders::MaxBonesPerVertex % 2 == 0);
+
+    std::vector<Shaders::PackedAnimatedVertex> packedVertices(vertices.size());
+    std::ranges::transform(vertices, packedVertices.begin(), [](const Shaders::AnimatedVertex &vertex) {
+        const Shaders::PackedVertexAttributes attributes = PackVertexAttributes(vertex);
+
+        Shaders::PackedAnimatedVertex packedVertex = {
+            .Position = vertex.Position,
+            .TexCoords = attributes.TexCoords,
+            .Normal = attributes.Normal,
+            .Tangent = attributes.Tangent,
+        };
+
+        // Rounding errors go to the largest weight, so the quantized weights still sum to one
+        std::array<uint32_t, Shaders::MaxBonesPerVertex> weights = {};
+        std::ranges::transform(vertex.BoneWeights, weights.begin(), [](float weight) {
+            return static_cast<uint32_t>(std::round(std::clamp(weight, 0.0f, 1.0f) * 65535.0f));
+        });
+
+        const int64_t weightSum = std::accumulate(weights.begin(), weights.end(), int64_t(0));
+        if (weightSum > 0)
+        {
+            uint32_t &maxWeight = *std::ranges::max_element(weights);
+            maxWeight = std::clamp<int64_t>(maxWeight + 65535 - weightSum, 0, 65535);
+        }
+
+        for (int i = 0; i < Shaders::MaxBonesPerVertex / 2; i++)
+        {
+            packedVertex.BoneIndices[i] = vertex.BoneIndices[2 * i] | vertex.BoneIndices[2 * i + 1] << 16;
+            packedVertex.BoneWeights[i] = weights[2 * i] | weights[2 * i + 1] << 16;
+        }
+
+        return packedVertex;
+    });
+
+    return packedVertices;
+}
+
 void Renderer::UpdateScenePipelineConfig()
 {
     auto updateMissFlags = [](Shaders::SpecializationConstant &flags) {
@@ -696,9 +837,10 @@ void Renderer::UpdateScenePipelineConfig()
     updateMissFlags(s_PathTracingPipelineConfig[Shaders::MissFlagsConstantId]);
     updateMissFlags(s_DebugRayTracingPipelineConfig[Shaders::DebugMissFlagsConstantId]);
 
-    s_PathTracingPipelineConfig[Shaders::HitFlagsConstantId] &= ~Shaders::HitFlagsDxNormalTextures;
+    s_PathTracingPipelineConfig[Shaders::HitFlagsConstantId] &=
+        ~(Shaders::HitFlagsDxNormalTextures | Shaders::HitFlagsPackedVertices);
     s_DebugRayTracingPipelineConfig[Shaders::DebugHitGroupFlagsConstantId] &=
-        ~Shaders::HitGroupFlagsDxNormalTextures;
+        ~(Shaders::HitGroupFlagsDxNormalTextures | Shaders::HitGroupFlagsPackedVertices);
 
     if (s_SceneData->Handle->HasDxNormalTextures())
     {
@@ -706,6 +848,13 @@ void Renderer::UpdateScenePipelineConfig()
         s_DebugRayTracingPipelineConfig[Shaders::DebugHitGroupFlagsConstantId] |=
             Shaders::HitGroupFlagsDxNormalTextures;
     }
+
+    if (Application::GetConfig().PackVertices)
+    {
+        s_PathTracingPipelineConfig[Shaders::HitFlagsConstantId] |= Shaders::HitFlagsPackedVertices;
+        s_DebugRayTracingPipelineConfig[Shaders::DebugHitGroupFlagsConstantId] |=
+            Shaders::HitGroupFlagsPackedVertices;
+    }
 }
 
 void Renderer::UpdatePipelineSpecializations()
@@ -741,11 +890,17 @@ void Renderer::UpdatePipelineSpecializations()
         s_Swapchain->IsHdr() ? Shaders::ToneMappingModeHDR : Shaders::ToneMappingModeSDR,
     };
 
+    SkinningPipelineConfig skinningConfig = {
+        Application::GetConfig().PackVertices
+            ? Shaders::SkinningFlagsPackedVertices | Shaders::SkinningFlagsPackedInput
+            : Shaders::SkinningFlagsNone,
+    };
+
     s_PostProcessPipeline->Update(PostProcessPipelineConfig());
     s_CompositionPipeline->Update(CompositionPipelineConfig());
     s_BloomDownsamplePipeline->Update(BloomDownsamplePipelineConfig());
     s_BloomUpsamplePipeline->Update(BloomUpsamplePipelineConfig());
-    s_SkinningPipeline->Update(SkinningPipelineConfig());
+    s_SkinningPipeline->Update(skinningConfig);
     s_ToneMappingPipeline->Update(toneMappingConfig);
     s_UIToneMappingPipeline->Update(uiToneMappingConfig);
     s_UICompositionPipeline->Update(uiCompositionConfig);
@@ -862,8 +1017,10 @@ void Renderer::RecordSkinningCommands(const RenderingResources &resources)
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, s_SkinningPipeline->GetHandle());
 
         Shaders::SkinningPushConstants pushConstants = {
+            static_cast<Shaders::uint>(s_SceneData->OutBindPosePositions.size()),
             s_SceneData->AnimatedVertexBuffer.GetDeviceAddress(),
-            resources.OutAnimatedVertexBuffer.GetDeviceAddress(),
+            resources.OutAnimatedPositionBuffer.GetDeviceAddress(),
+            resources.OutAnimatedAttributeBuffer.GetDeviceAddress(),
         };
 
         commandBuffer.pushConstants(
@@ -877,15 +1034,28 @@ void Renderer::RecordSkinningCommands(const RenderingResources &resources)
         );
 
         const uint32_t groupCount = std::ceil(
-            s_SceneData->OutBindPoseAnimatedVertices.size() /
+            s_SceneData->OutBindPosePositions.size() /
             static_cast<float>(Shaders::SkinningShaderGroupSizeX)
         );
         commandBuffer.dispatch(groupCount, 1, 1);
 
-        resources.OutAnimatedVertexBuffer.AddBarrier(
-            commandBuffer, vk::PipelineStageFlagBits2::eComputeShader,
-            vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
-        );
+        // Positions are consumed by the BLAS refit, attributes only by the hit shaders
+        const std::array barriers = {
+            resources.OutAnimatedPositionBuffer.GetBarrier(
+                vk::PipelineStageFlagBits2::eComputeShader,
+                vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR
+            ),
+            resources.OutAnimatedAttributeBuffer
+                .GetBarrier(
+                    vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::PipelineStageFlagBits2::eRayTracingShaderKHR
+                )
+                .setDstAccessMask(vk::AccessFlagBits2::eShaderStorageRead),
+        };
+
+        vk::DependencyInfo info;
+        info.setBufferMemoryBarriers(barriers);
+        commandBuffer.pipelineBarrier2(info);
     }
 }
 
@@ -925,6 +1095,54 @@ void Renderer::RecordPathTracingCommands(const RenderingResources &resources)
     }
 }
 
+void Renderer::RecordTextureFeedbackCommands(const RenderingResources &resources)
+{
+    vk::CommandBuffer commandBuffer = resources.CommandBuffer;
+    const Buffer &feedback = resources.TextureFeedbackBuffer;
+    const Buffer &readback = resources.TextureFeedbackReadbackBuffer;
+
+    auto addBarrier = [commandBuffer](
+                          const Buffer &buffer, vk::PipelineStageFlags2 srcStage, vk::AccessFlags2 srcAccess,
+                          vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess
+                      ) {
+        vk::BufferMemoryBarrier2 barrier(
+            srcStage, srcAccess, dstStage, dstAccess, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
+            buffer.GetHandle(), 0, buffer.GetSize()
+        );
+        vk::DependencyInfo info;
+        info.setBufferMemoryBarriers(barrier);
+        commandBuffer.pipelineBarrier2(info);
+    };
+
+    Utils::DebugLabel label(commandBuffer, "Texture feedback readback", { 0.9f, 0.75f, 0.29f, 1.0f });
+
+    addBarrier(
+        feedback, vk::PipelineStageFlagBits2::eRayTracingShaderKHR,
+        vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+        vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferRead
+    );
+    commandBuffer.copyBuffer(
+        feedback.GetHandle(), readback.GetHandle(), { vk::BufferCopy(0, 0, feedback.GetSize()) }
+    );
+
+    // The next frame that uses these resources starts from cleared feedback
+    static_assert(Shaders::TextureFeedbackNone == 0);
+    addBarrier(
+        feedback, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferRead,
+        vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite
+    );
+    commandBuffer.fillBuffer(feedback.GetHandle(), 0, vk::WholeSize, Shaders::TextureFeedbackNone);
+    addBarrier(
+        feedback, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eRayTracingShaderKHR,
+        vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+    );
+    addBarrier(
+        readback, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead
+    );
+}
+
 void Renderer::RecordPostProcessCommands(const RenderingResources &resources)
 {
     vk::CommandBuffer commandBuffer = resources.CommandBuffer;
@@ -1255,20 +1473,52 @@ void Renderer::CreateSceneRenderingResources(RenderingResources &res, uint32_t f
         std::format("Light Uniform Buffer {}", frameIndex)
     );
 
+    s_BufferBuilder->ResetFlags().SetUsageFlags(
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+        vk::BufferUsageFlagBits::eTransferDst
+    );
+    const std::vector<Shaders::uint> feedback(
+        Shaders::SceneTextureOffset + s_SceneData->Handle->GetTextures().size(), Shaders::TextureFeedbackNone
+    );
+    res.TextureFeedbackBuffer =
+        CreateDeviceBuffer(std::span(feedback), std::format("Texture Feedback Buffer {}", frameIndex));
+
+    s_BufferBuilder->ResetFlags().SetUsageFlags(vk::BufferUsageFlagBits::eTransferDst);
+    res.TextureFeedbackReadbackBuffer = s_BufferBuilder->CreateHostBuffer(
+        std::span(feedback), std::format("Texture Feedback Readback Buffer {}", frameIndex)
+    );
+
+    res.BoneTransformsVersion = -1;
     if (s_SceneData->Handle->HasSkeletalAnimations())
     {
         res.BoneTransformUniformBuffer = s_BufferBuilder->CreateHostBuffer(
             s_SceneData->Handle->GetBoneTransforms(), std::format("Bone Transform Buffer {}", frameIndex)
         );
+        res.BoneNormalMatrixUniformBuffer = s_BufferBuilder->CreateHostBuffer(
+            s_SceneData->Handle->GetBoneNormalMatrices(),
+            std::format("Bone Normal Matrix Buffer {}", frameIndex)
+        );
 
         s_BufferBuilder->ResetFlags().SetUsageFlags(
             vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
             vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst
         );
 
-        res.OutAnimatedVertexBuffer = CreateDeviceBuffer(
-            std::span(s_SceneData->OutBindPoseAnimatedVertices),
-            std::format("Out Animated Vertex Buffer {}", frameIndex)
+        res.OutAnimatedPositionBuffer = CreateDeviceBuffer(
+            std::span(s_SceneData->OutBindPosePositions),
+            std::format("Out Animated Position Buffer {}", frameIndex)
+        );
+
+        s_BufferBuilder->ResetFlags().SetUsageFlags(
+            vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst
+        );
+
+        const BufferContent bindPoseAttributes =
+            Application::GetConfig().PackVertices
+                ? BufferContent(std::span(s_SceneData->PackedOutBindPoseAttributes))
+                : BufferContent(std::span(s_SceneData->OutBindPoseAttributes));
+        res.OutAnimatedAttributeBuffer = CreateDeviceBuffer(
+            bindPoseAttributes, std::format("Out Animated Attribute Buffer {}", frameIndex)
         );
     }
 
@@ -1365,13 +1615,18 @@ void Renderer::CreateImageResources(RenderingResources &res, uint32_t frameIndex
 
 void Renderer::CreateGeometryBuffer(RenderingResources &resources)
 {
-    auto modifyGeometries = [](vk::DeviceAddress address, int sign) {
+    auto modifyGeometries = [&resources](int sign) {
+        const vk::DeviceAddress positions = resources.OutAnimatedPositionBuffer.GetDeviceAddress();
+        const vk::DeviceAddress attributes = resources.OutAnimatedAttributeBuffer.GetDeviceAddress();
         for (int i = s_SceneData->AnimatedGeometriesOffset; i < s_SceneData->Geometries.size(); i++)
-            s_SceneData->Geometries[i].Vertices += sign * address;
+        {
+            s_SceneData->Geometries[i].Positions += sign * positions;
+            s_SceneData->Geometries[i].Attributes += sign * attributes;
+        }
     };
 
     if (s_SceneData->Handle->HasSkeletalAnimations())
-        modifyGeometries(resources.OutAnimatedVertexBuffer.GetDeviceAddress(), 1);
+        modifyGeometries(1);
 
     s_BufferBuilder->ResetFlags().SetUsageFlags(
         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
@@ -1379,19 +1634,36 @@ void Renderer::CreateGeometryBuffer(RenderingResources &resources)
     resources.GeometryBuffer = CreateDeviceBuffer(std::span(s_SceneData->Geometries), "Geometry Buffer");
 
     if (s_SceneData->Handle->HasSkeletalAnimations())
-        modifyGeometries(resources.OutAnimatedVertexBuffer.GetDeviceAddress(), -1);
+        modifyGeometries(-1);
 }
 
-void Renderer::CreateAccelerationStructure(RenderingResources &resources)
+GeometryBufferAddresses Renderer::GetGeometryBufferAddresses(const RenderingResources *resources)
 {
     auto getAddress = [](const Buffer &buffer) {
         return buffer.GetHandle() == nullptr ? 0 : buffer.GetDeviceAddress();
     };
 
+    return GeometryBufferAddresses {
+        .Positions = getAddress(s_SceneData->PositionBuffer),
+        .Indices = getAddress(s_SceneData->IndexBuffer),
+        .AnimatedPositions = resources == nullptr ? 0 : getAddress(resources->OutAnimatedPositionBuffer),
+        .AnimatedIndices = getAddress(s_SceneData->AnimatedIndexBuffer),
+        .Transforms = getAddress(s_SceneData->TransformBuffer),
+    };
+}
+
+void Renderer::CreateStaticAccelerationStructures()
+{
+    Timer timer("Static BLAS Build");
+    s_SceneData->StaticBlases =
+        std::make_unique<BlasSet>(GetGeometryBufferAddresses(nullptr), *s_SceneData->Handle, false);
+}
+
+void Renderer::CreateAccelerationStructure(RenderingResources &resources)
+{
     resources.SceneAccelerationStructure = std::make_unique<AccelerationStructure>(
-        getAddress(s_SceneData->VertexBuffer), getAddress(s_SceneData->IndexBuffer),
-        getAddress(resources.OutAnimatedVertexBuffer), getAddress(s_SceneData->AnimatedIndexBuffer),
-        getAddress(s_SceneData->TransformBuffer), s_SceneData->Handle, s_ActiveShaderConfig->HitGroupCount
+        GetGeometryBufferAddresses(&resources), *s_SceneData->StaticBlases, s_SceneData->Handle,
+        s_ActiveShaderConfig->HitGroupCount
     );
 }
 
@@ -1548,12 +1820,14 @@ void Renderer::RecreateDescriptorSet()
                     11, frameIndex, s_SceneData->Skybox, s_TextureSampler,
                     vk::ImageLayout::eShaderReadOnlyOptimal
                 );
+            set->UpdateBuffer(12, frameIndex, s_SceneData->NormalMatrixBuffer);
         };
 
         updateRaytracingDescriptorSet(
             s_PathTracingPipeline->GetDescriptorSet(),
             s_PathTracingPipelineConfig[Shaders::MissFlagsConstantId]
         );
+        s_PathTracingPipeline->GetDescriptorSet()->UpdateBuffer(13, frameIndex, res.TextureFeedbackBuffer);
         updateRaytracingDescriptorSet(
             s_DebugRayTracingPipeline->GetDescriptorSet(),
             s_DebugRayTracingPipelineConfig[Shaders::DebugMissFlagsConstantId]
@@ -1562,7 +1836,7 @@ void Renderer::RecreateDescriptorSet()
         if (s_SceneData->Handle->HasSkeletalAnimations())
         {
             skinningDescriptorSet->UpdateBuffer(0, frameIndex, res.BoneTransformUniformBuffer);
-            skinningDescriptorSet->UpdateBuffer(1, frameIndex, s_SceneData->AnimatedVertexMapBuffer);
+            skinningDescriptorSet->UpdateBuffer(1, frameIndex, res.BoneNormalMatrixUniformBuffer);
         }
 
         postProcessDescriptorSet->UpdateImage(
@@ -1675,6 +1949,7 @@ void Renderer::Render()
             s_TextureOwnershipBufferHasCommands = false;
             ResetAccumulationImage();
         }
+        s_TextureUploader->ReleaseRetiredTextures(s_RenderingResources.size());
         s_ActiveRayTracingPipeline->GetDescriptorSet()->FlushUpdate(
             s_Swapchain->GetCurrentFrameInFlightIndex()
         );
@@ -1683,6 +1958,10 @@ void Renderer::Render()
     const Swapchain::SynchronizationObjects &sync = s_Swapchain->GetCurrentSyncObjects();
     RenderingResources &res = s_RenderingResources[s_Swapchain->GetCurrentFrameInFlightIndex()];
 
+    // The frame that used these resources has finished, so its copy of the texture feedback can be read
+    if (s_ActiveRayTracingPipeline == s_PathTracingPipeline.get())
+        s_TextureUploader->UpdateResidency(res.TextureFeedbackReadbackBuffer);
+
     Camera &camera = s_SceneData->Handle->GetActiveCamera();
     camera.OnResize(res.AccumulationImage.GetExtent().width, res.AccumulationImage.GetExtent().height);
     Shaders::RaygenUniformData rgenData = { camera.GetInvViewMatrix(),
@@ -1725,8 +2004,15 @@ void Renderer::Render()
             s_SceneData->Handle->GetPointLights(), RenderingResources::s_LightArrayOffset
         );
 
-    if (s_SceneData->Handle->HasSkeletalAnimations())
+    // Skinned vertices of this frame only have to follow bone transform changes
+    const bool isSkinningNeeded = s_SceneData->Handle->HasSkeletalAnimations() &&
+                                  res.BoneTransformsVersion != s_SceneData->Handle->GetBoneTransformsVersion();
+    if (isSkinningNeeded)
+    {
         res.BoneTransformUniformBuffer.Upload(s_SceneData->Handle->GetBoneTransforms());
+        res.BoneNormalMatrixUniformBuffer.Upload(s_SceneData->Handle->GetBoneNormalMatrices());
+        res.BoneTransformsVersion = s_SceneData->Handle->GetBoneTransformsVersion();
+    }
 
     res.CommandBuffer.reset();
     res.CommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
@@ -1747,13 +2033,15 @@ void Renderer::Render()
         );
     }
 
-    if (s_SceneData->Handle->HasSkeletalAnimations())
+    if (isSkinningNeeded)
         RecordSkinningCommands(res);
 
     if (s_SceneData->Handle->HasAnimations())
         res.SceneAccelerationStructure->RecordUpdateCommands(res.CommandBuffer);
 
     RecordPathTracingCommands(res);
+    if (s_ActiveRayTracingPipeline == s_PathTracingPipeline.get())
+        RecordTextureFeedbackCommands(res);
     RecordPostProcessCommands(res);
 
     if (saveOutput)
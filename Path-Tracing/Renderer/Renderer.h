@@ -28,7 +28,7 @@ namespace PathTracing
 
 using PathTracingPipelineConfig = PipelineConfig<2>;
 using DebugRaytracingPipelineConfig = PipelineConfig<4>;
-using SkinningPipelineConfig = PipelineConfig<0>;
+using SkinningPipelineConfig = PipelineConfig<1>;
 using PostProcessPipelineConfig = PipelineConfig<0>;
 using CompositionPipelineConfig = PipelineConfig<0>;
 using BloomDownsamplePipelineConfig = PipelineConfig<0>;
@@ -109,6 +109,7 @@ private:
         ShaderId BloomUpsampleCompute = ShaderLibrary::g_UnusedShaderId;
         ShaderId UICompositionCompute = ShaderLibrary::g_UnusedShaderId;
         ShaderId TonemappingCompute = ShaderLibrary::g_UnusedShaderId;
+        ShaderId TextureMipsCompute = ShaderLibrary::g_UnusedShaderId;
 
         ShaderId DebugRaygen = ShaderLibrary::g_UnusedShaderId;
         ShaderId DebugMiss = ShaderLibrary::g_UnusedShaderId;
@@ -149,6 +150,10 @@ private:
         Buffer RaygenUniformBuffer;
         Buffer PostProcessUniformBuffer;
 
+        // Feedback is written on the device and copied back at the end of every frame
+        Buffer TextureFeedbackBuffer;
+        Buffer TextureFeedbackReadbackBuffer;
+
         static inline constexpr vk::DeviceSize s_DirectionalLightOffset =
             Utils::AlignTo(sizeof(Shaders::uint), Shaders::DirectionalLightStructAlignment);
         static inline constexpr vk::DeviceSize s_LightArrayOffset = Utils::AlignTo(
@@ -158,7 +163,10 @@ private:
         Buffer LightUniformBuffer;
 
         Buffer BoneTransformUniformBuffer;
-        Buffer OutAnimatedVertexBuffer;
+        Buffer BoneNormalMatrixUniformBuffer;
+        Buffer OutAnimatedPositionBuffer;
+        Buffer OutAnimatedAttributeBuffer;
+        uint32_t BoneTransformsVersion = -1;
         Buffer GeometryBuffer;
 
         std::unique_ptr<AccelerationStructure> SceneAccelerationStructure = nullptr;
@@ -186,24 +194,28 @@ private:
     {
         std::shared_ptr<Scene> Handle = nullptr;
 
-        Buffer VertexBuffer;
+        Buffer PositionBuffer;
+        Buffer AttributeBuffer;
         Buffer IndexBuffer;
 
         Buffer AnimatedVertexBuffer;
-        Buffer AnimatedVertexMapBuffer;
         Buffer AnimatedIndexBuffer;
 
         Buffer TransformBuffer;
+        Buffer NormalMatrixBuffer;
         Buffer MetallicRoughnessMaterialBuffer;
         Buffer SpecularGlossinessMaterialBuffer;
         Buffer PhongMaterialBuffer;
 
         Image Skybox;
 
-        std::vector<Shaders::Vertex> OutBindPoseAnimatedVertices;
+        std::vector<Shaders::vec3> OutBindPosePositions;
+        std::vector<Shaders::VertexAttributes> OutBindPoseAttributes;
+        std::vector<Shaders::PackedVertexAttributes> PackedOutBindPoseAttributes;
         uint32_t AnimatedGeometriesOffset = 0;
         std::vector<Shaders::Geometry> Geometries;
 
+        std::unique_ptr<BlasSet> StaticBlases = nullptr;
         std::unique_ptr<ShaderBindingTable> SceneShaderBindingTable = nullptr;
     };
 
@@ -244,6 +256,20 @@ private:
     );
     static uint32_t AddTexture(std::span<const uint8_t> data, TextureType type, std::string &&name);
 
+    static Shaders::uint GetIndexType(const Geometry &geometry);
+    static vk::DeviceSize GetVertexAttributesSize();
+    static std::vector<Shaders::vec3> GetVertexPositions(std::span<const Shaders::Vertex> vertices);
+    static std::vector<Shaders::VertexAttributes> GetVertexAttributes(
+        std::span<const Shaders::Vertex> vertices
+    );
+    template<typename V> static Shaders::PackedVertexAttributes PackVertexAttributes(const V &vertex);
+    static std::vector<Shaders::PackedVertexAttributes> PackVertexAttributes(
+        std::span<const Shaders::Vertex> vertices
+    );
+    static std::vector<Shaders::PackedAnimatedVertex> PackAnimatedVertices(
+        std::span<const Shaders::AnimatedVertex> vertices
+    );
+
     static void UpdateScenePipelineConfig();
     static void UpdatePipelineSpecializations();
     static void CreatePipelines();
@@ -252,6 +278,7 @@ private:
 
     static void RecordSkinningCommands(const RenderingResources &resources);
     static void RecordPathTracingCommands(const RenderingResources &resources);
+    static void RecordTextureFeedbackCommands(const RenderingResources &resources);
     static void RecordPostProcessCommands(const RenderingResources &resources);
     static void RecordUICommands(const RenderingResources &resources);
     static void RecordSaveOutputCommands(const RenderingResources &resources);
@@ -260,6 +287,8 @@ private:
     static void CreateImageResourcesInternal(RenderingResources &res, uint32_t frameIndex, vk::Extent2D extent);
     static void CreateImageResources(RenderingResources &res, uint32_t frameIndex, vk::Extent2D extent);
     static void CreateGeometryBuffer(RenderingResources &resources);
+    static GeometryBufferAddresses GetGeometryBufferAddresses(const RenderingResources *resources);
+    static void CreateStaticAccelerationStructures();
     static void CreateAccelerationStructure(RenderingResources &resources);
 
     static void OnInFlightCountChange();
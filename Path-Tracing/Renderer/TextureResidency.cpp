@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+#include "Core/Core.h"
+
+#include "Image.h"
+#include "TextureResidency.h"
+
+namespace PathTracing
+{
+
+TextureResidency::TextureResidency(
+    std::span<const vk::Extent2D> extents, std::span<const vk::Format> formats,
+    std::span<const uint32_t> levels
+)
+    : m_Textures(extents.size())
+{
+    assert(extents.size() == formats.size() && extents.size() == levels.size());
+
+    // Scenes reuse a few texture sizes, so memory requirements are only queried once for each of them
+    std::map<std::tuple<uint32_t, uint32_t, vk::Format>, size_t> memoryCache;
+
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+    {
+        TextureState &state = m_Textures[i];
+        state.SizeBits = std::bit_width(std::max(extents[i].width, extents[i].height));
+
+        for (uint32_t level = 0; level < Image::GetMipLevels(extents[i]); level++)
+        {
+            const vk::Extent2D extent = Image::GetMipExtent(extents[i], level);
+            const auto key = std::make_tuple(extent.width, extent.height, formats[i]);
+            if (!memoryCache.contains(key))
+                memoryCache[key] = Image::GetTextureMemoryRequirement(extent, formats[i]);
+            state.Memory.push_back(memoryCache.at(key));
+        }
+
+        const uint32_t unusedBits = std::bit_width(UnusedExtent);
+        state.UnusedLevel = state.SizeBits > unusedBits ? state.SizeBits - unusedBits : 0;
+        state.Level = std::min<uint32_t>(levels[i], state.Memory.size() - 1);
+    }
+}
+
+uint32_t TextureResidency::GetLevel(uint32_t textureIndex) const
+{
+    return m_Textures[textureIndex].Level;
+}
+
+size_t TextureResidency::GetResidentMemory() const
+{
+    return std::accumulate(
+        m_Textures.begin(), m_Textures.end(), static_cast<size_t>(0),
+        [](size_t sum, const TextureState &state) { return sum + state.Memory[state.Level]; }
+    );
+}
+
+void TextureResidency::AddFeedback(std::span<const uint32_t> feedback)
+{
+    assert(feedback.size() == m_Textures.size());
+
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+        m_Textures[i].Feedback = std::max(m_Textures[i].Feedback, feedback[i]);
+}
+
+std::vector<uint32_t> TextureResidency::Update(size_t budget, uint32_t maxChanges)
+{
+    std::vector<uint32_t> targets(m_Textures.size());
+    size_t targetMemory = 0;
+
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+    {
+        TextureState &state = m_Textures[i];
+
+        // Requested sizes are kept for a few updates, so textures briefly out of view aren't evicted
+        if (state.Feedback != Shaders::TextureFeedbackNone)
+        {
+            state.Requested = state.Feedback;
+            state.UnusedUpdates = 0;
+        }
+        else if (++state.UnusedUpdates >= EvictionUpdateCount)
+            state.Requested = Shaders::TextureFeedbackNone;
+        state.Feedback = Shaders::TextureFeedbackNone;
+
+        targets[i] = GetRequestedLevel(state);
+        targetMemory += state.Memory[targets[i]];
+    }
+
+    // Over the budget the largest textures are scaled down first
+    std::priority_queue<std::pair<size_t, uint32_t>> largest;
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+        if (targets[i] + 1 < m_Textures[i].Memory.size())
+            largest.emplace(m_Textures[i].Memory[targets[i]], i);
+
+    while (targetMemory > budget && !largest.empty())
+    {
+        const auto [memory, i] = largest.top();
+        largest.pop();
+
+        targets[i]++;
+        targetMemory -= memory - m_Textures[i].Memory[targets[i]];
+        if (targets[i] + 1 < m_Textures[i].Memory.size())
+            largest.emplace(m_Textures[i].Memory[targets[i]], i);
+    }
+
+    std::vector<uint32_t> evictions, upgrades;
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+    {
+        if (targets[i] > m_Textures[i].Level)
+            evictions.push_back(i);
+        else if (targets[i] < m_Textures[i].Level)
+            upgrades.push_back(i);
+    }
+
+    auto getFreedMemory = [this, &targets](uint32_t i) {
+        return m_Textures[i].Memory[m_Textures[i].Level] - m_Textures[i].Memory[targets[i]];
+    };
+    auto getMissingLevels = [this, &targets](uint32_t i) { return m_Textures[i].Level - targets[i]; };
+    std::ranges::sort(evictions, std::greater(), getFreedMemory);
+    std::ranges::sort(upgrades, std::greater(), getMissingLevels);
+
+    std::vector<uint32_t> changed;
+    size_t residentMemory = GetResidentMemory();
+
+    for (uint32_t i : evictions)
+    {
+        if (changed.size() == maxChanges)
+            break;
+
+        residentMemory -= getFreedMemory(i);
+        m_Textures[i].Level = targets[i];
+        changed.push_back(i);
+    }
+
+    for (uint32_t i : upgrades)
+    {
+        if (changed.size() == maxChanges)
+            break;
+
+        const TextureState &state = m_Textures[i];
+        const size_t addedMemory = state.Memory[targets[i]] - state.Memory[state.Level];
+        if (residentMemory + addedMemory > budget)
+            continue;
+
+        residentMemory += addedMemory;
+        m_Textures[i].Level = targets[i];
+        changed.push_back(i);
+    }
+
+    return changed;
+}
+
+uint32_t TextureResidency::GetRequestedLevel(const TextureState &state)
+{
+    const uint32_t maxLevel = state.Memory.size() - 1;
+    if (state.Requested == Shaders::TextureFeedbackNone)
+        return std::min(state.UnusedLevel, maxLevel);
+
+    // The requested size is 2^(Requested - 1), the largest level that isn't magnified at it is chosen
+    const uint32_t level = state.SizeBits > state.Requested ? state.SizeBits - state.Requested : 0;
+    return std::min(level, maxLevel);
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <span>
+#include <vector>
+
+#include "Shaders/ShaderRendererTypes.incl"
+
+namespace PathTracing
+{
+
+// Decides how many of the top mips of every scene texture are resident under the texture memory budget
+// A texture at level n is uploaded without its first n mips, the levels follow the hit shader feedback
+class TextureResidency
+{
+public:
+    TextureResidency() = default;
+    TextureResidency(
+        std::span<const vk::Extent2D> extents, std::span<const vk::Format> formats,
+        std::span<const uint32_t> levels
+    );
+
+    [[nodiscard]] uint32_t GetLevel(uint32_t textureIndex) const;
+    [[nodiscard]] size_t GetResidentMemory() const;
+
+    // Feedback is indexed by scene texture, the max is kept until the next update
+    void AddFeedback(std::span<const uint32_t> feedback);
+
+    // Returns the textures that have to be uploaded at their new level
+    // Evictions come first, so the upgrades that follow them fit into the budget
+    std::vector<uint32_t> Update(size_t budget, uint32_t maxChanges);
+
+private:
+    struct TextureState
+    {
+        std::vector<size_t> Memory;  // Memory requirement of every level
+        uint32_t SizeBits = 0;
+        uint32_t UnusedLevel = 0;
+        uint32_t Level = 0;
+        uint32_t Feedback = Shaders::TextureFeedbackNone;  // Max since the last update
+        uint32_t Requested = Shaders::TextureFeedbackNone;
+        uint32_t UnusedUpdates = 0;
+    };
+
+    std::vector<TextureState> m_Textures;
+
+private:
+    static inline constexpr uint32_t UnusedExtent = 128u;  // Textures that aren't sampled are evicted to it
+    static inline constexpr uint32_t EvictionUpdateCount = 4u;
+
+private:
+    [[nodiscard]] static uint32_t GetRequestedLevel(const TextureState &state);
+};
+
+}
@@ -1,12 +1,18 @@
 #include <vulkan/vulkan_format_traits.hpp>
 
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
 #include "Core/Core.h"
 
 #include "Application.h"
 #include "TextureImporter.h"
 
+#include "DeviceContext.h"
 #include "Renderer.h"
 #include "TextureUploader.h"
+#include "Utils.h"
 
 namespace PathTracing
 {
@@ -38,7 +44,10 @@ size_t GetTextureBudget()
 
 }
 
-TextureUploader::TextureUploader(std::vector<Image> &textures, std::mutex &descriptorSetMutex)
+TextureUploader::TextureUploader(
+    std::vector<Image> &textures, std::mutex &descriptorSetMutex, ShaderLibrary &shaderLibrary,
+    ShaderId mipsShaderId
+)
     : m_Textures(textures), m_DescriptorSetMutex(descriptorSetMutex),
       m_LoaderThreadCount(GetLoaderThreadCount()),
       m_StagingBufferCount(GetStagingStagingBufferPerThreadCount() * m_LoaderThreadCount),
@@ -70,16 +79,28 @@ TextureUploader::TextureUploader(std::vector<Image> &textures, std::mutex &descr
                          )
                          .EnableMips();
 
-    for (vk::Format format : ScalingFormats)
+    static_assert(std::bit_width(MaxTextureDataSize.width) <= Shaders::MaxTextureMipLevels);
+    static_assert(std::bit_width(MaxTextureDataSize.height) <= Shaders::MaxTextureMipLevels);
+
     {
-        const auto blitFlags = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
-        if ((DeviceContext::GetPhysical().getFormatProperties(format).optimalTilingFeatures & blitFlags) !=
-            blitFlags)
-            continue;
+        ComputePipelineBuilder builder(shaderLibrary, mipsShaderId);
+        builder.AddHintSize(0, Shaders::MaxTextureMipsBatchSize);
+        builder.AddHintSize(1, Shaders::MaxTextureMipsBatchSize);
+        builder.AddHintSize(2, Shaders::MaxTextureMipsBatchSize * Shaders::MaxTextureMipLevels);
+        builder.AddHintSize(3, Shaders::MaxTextureMipsBatchSize * Shaders::MaxTextureMipLevels);
+        static TextureMipsPipelineConfig maxTextureMipsConfig = {};
+        m_MipsPipeline = builder.CreatePipelineUnique(maxTextureMipsConfig);
+        m_MipsPipeline->Update(TextureMipsPipelineConfig());
+        m_MipsPipeline->CreateDescriptorSet(1);
+    }
 
-        m_ScalingImages[format] = m_ImageBuilder.SetFormat(format).CreateImage(
-            MaxTextureDataSize, std::format("Scaling Image {}", vk::to_string(format))
+    {
+        vk::SamplerCreateInfo createInfo(
+            vk::SamplerCreateFlags(), vk::Filter::eNearest, vk::Filter::eNearest
         );
+        createInfo.setMaxLod(vk::LodClampNone);
+        m_MipsSampler = DeviceContext::GetLogical().createSampler(createInfo);
+        Utils::SetDebugName(m_MipsSampler, "Texture Mips Sampler");
     }
 
     logger::info("Max Texture Data Size: {}x{}", MaxTextureDataSize.width, MaxTextureDataSize.height);
@@ -88,6 +109,8 @@ TextureUploader::TextureUploader(std::vector<Image> &textures, std::mutex &descr
 TextureUploader::~TextureUploader()
 {
     Cancel();
+
+    DeviceContext::GetLogical().destroySampler(m_MipsSampler);
 }
 
 void TextureUploader::UploadTexturesBlocking(const Scene &scene)
@@ -97,7 +120,9 @@ void TextureUploader::UploadTexturesBlocking(const Scene &scene)
         return;
 
     DetermineMaxTextureSizes(textures.size(), scene.GetForceFullTextureSize());
+    CreateResidency(textures);
 
+    m_UploadedTextures.reserve(1);
     for (uint32_t i = 0; i < textures.size(); i++)
     {
         const Buffer &buffer = m_FreeBuffers.front();
@@ -105,12 +130,17 @@ void TextureUploader::UploadTexturesBlocking(const Scene &scene)
 
         UploadToBuffer(textureInfo, buffer);
 
+        const vk::CommandBuffer commandBuffer = Renderer::s_MainCommandBuffer->Buffer;
         Renderer::s_MainCommandBuffer->Begin();
-        UploadTexture(
-            Renderer::s_MainCommandBuffer->Buffer, Renderer::s_MainCommandBuffer->Buffer, textureInfo, i,
-            buffer
-        );
+        UploadTexture(commandBuffer, commandBuffer, textureInfo, m_Residency.GetLevel(i), buffer);
+        RecordMipsCommands(commandBuffer);
+        for (const MipsTarget &target : m_MipsTargets)
+            ReleaseTexture(commandBuffer, *target.Texture, vk::ImageLayout::eGeneral);
         Renderer::s_MainCommandBuffer->SubmitBlocking();
+        ReleaseMipsResources();
+
+        m_Textures[Shaders::GetSceneTextureIndex(i)] = std::move(m_UploadedTextures.back());
+        m_UploadedTextures.clear();
 
         Renderer::UpdateTexture(Shaders::GetSceneTextureIndex(i));
         logger::debug("Uploaded Texture: {}", textureInfo.Name);
@@ -126,9 +156,56 @@ void TextureUploader::UploadTextures(const std::shared_ptr<const Scene> &scene)
         return;
 
     DetermineMaxTextureSizes(textures.size(), scene->GetForceFullTextureSize());
+    CreateResidency(textures);
+    m_IsStreaming = Application::GetConfig().TextureStreaming && !scene->GetForceFullTextureSize();
+    m_Scene = scene;
+    m_TexturePriorities.assign(textures.size(), Shaders::TextureFeedbackNone);
+
+    std::vector<uint32_t> textureIndices(textures.size());
+    std::iota(textureIndices.begin(), textureIndices.end(), 0);
+
     Application::AddBackgroundTask(BackgroundTaskType::TextureUpload, textures.size());
-    StartLoaderThreads(scene);
-    StartSubmitThread(scene);
+    StartUpload(textureIndices, true);
+}
+
+void TextureUploader::UpdateResidency(const Buffer &feedbackBuffer)
+{
+    if (!m_IsStreaming && !m_IsUploading)
+        return;
+
+    m_Feedback.resize(feedbackBuffer.GetSize() / sizeof(uint32_t));
+    feedbackBuffer.Readback(std::as_writable_bytes(std::span(m_Feedback)));
+
+    const auto sceneFeedback = std::span(m_Feedback).subspan(Shaders::SceneTextureOffset);
+    UpdatePriorities(sceneFeedback);
+    if (!m_IsStreaming)
+        return;
+    m_Residency.AddFeedback(sceneFeedback);
+
+    Stats::AddStat(
+        "Texture Memory", "Texture Memory: {} MiB", m_Residency.GetResidentMemory() / (1024 * 1024)
+    );
+
+    // Replacing textures restarts the accumulation, so textures don't change while rendering the output
+    if (++m_FeedbackFrameCount < ResidencyUpdateFrameCount || m_IsUploading || Application::IsRendering())
+        return;
+    m_FeedbackFrameCount = 0;
+
+    std::vector<uint32_t> textureIndices = m_Residency.Update(GetTextureBudget(), MaxStreamedTextureCount);
+    if (textureIndices.empty())
+        return;
+
+    logger::debug("Streaming {} texture(s)", textureIndices.size());
+    StartUpload(textureIndices, false);
+}
+
+void TextureUploader::ReleaseRetiredTextures(uint32_t framesInFlight)
+{
+    // Descriptor sets of all frames are updated after one round of frames and they finish in the next one
+    m_FrameIndex++;
+    std::erase_if(m_RetiredTextures, [this, framesInFlight](const RetiredTexture &texture) {
+        return m_FrameIndex - texture.Frame > 2 * framesInFlight;
+    });
 }
 
 void TextureUploader::Cancel()
@@ -145,8 +222,14 @@ void TextureUploader::Cancel()
     m_SubmitThread.request_stop();
     m_SubmitThread.join();
 
-    m_TextureIndex = 0;
-    m_RejectedCount = 0;
+    m_PendingTextures.clear();
+    m_TexturePriorities.clear();
+    m_PendingTextureCount = 0;
+    m_UploadedTextures.clear();
+    m_RetiredTextures.clear();
+    m_Scene.reset();
+    m_IsStreaming = false;
+    m_FeedbackFrameCount = 0;
     m_FreeBuffersSemaphore.release(m_DataBuffers.size());
     m_FreeBuffers.insert(
         m_FreeBuffers.end(), std::make_move_iterator(m_DataBuffers.begin()),
@@ -165,20 +248,54 @@ Image TextureUploader::UploadFromRawContentBlocking(
     std::string &&name
 )
 {
+    const vk::Format imageFormat = GetImageFormat(type, format);
+    const bool generatesMips = Image::GetMipLevels(extent) > 1;
+    assert(!generatesMips || IsStorageFormat(imageFormat));
+
+    const vk::ImageUsageFlags usageFlags = vk::ImageUsageFlagBits::eSampled |
+                                           vk::ImageUsageFlagBits::eTransferDst |
+                                           vk::ImageUsageFlagBits::eTransferSrc;
     Image image = ImageBuilder()
-                      .SetFormat(GetImageFormat(type, format))
+                      .SetFormat(imageFormat)
                       .SetUsageFlags(
-                          vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst |
-                          vk::ImageUsageFlagBits::eTransferSrc
+                          generatesMips ? usageFlags | vk::ImageUsageFlagBits::eStorage : usageFlags
                       )
                       .EnableMips()
                       .CreateImage(extent, name);
 
     std::array<BufferContent, 1> contents = { content };
     Renderer::s_StagingBuffer->UploadToImage(contents, image, vk::ImageLayout::eTransferDstOptimal);
+
+    const vk::CommandBuffer commandBuffer = Renderer::s_MainCommandBuffer->Buffer;
     Renderer::s_MainCommandBuffer->Begin();
-    image.GenerateFullMips(Renderer::s_MainCommandBuffer->Buffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+    if (generatesMips)
+    {
+        Image::Transition(
+            commandBuffer, image.GetHandle(), vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
+            vk::PipelineStageFlagBits2::eTransfer, vk::PipelineStageFlagBits2::eComputeShader,
+            vk::AccessFlagBits2::eTransferWrite,
+            vk::AccessFlagBits2::eShaderSampledRead | vk::AccessFlagBits2::eShaderStorageWrite, 0,
+            image.GetMipLevels()
+        );
+
+        m_MipsTargets.push_back(
+            { .Texture = &image, .FirstLevel = 1, .Flags = GetMipsFlags(type, imageFormat) }
+        );
+        RecordMipsCommands(commandBuffer);
+
+        Image::Transition(
+            commandBuffer, image.GetHandle(), vk::ImageLayout::eGeneral,
+            vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits2::eComputeShader,
+            vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eShaderStorageWrite,
+            vk::AccessFlagBits2::eShaderSampledRead, 0, image.GetMipLevels()
+        );
+    }
+    else
+        image.Transition(
+            commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal
+        );
     Renderer::s_MainCommandBuffer->SubmitBlocking();
+    ReleaseMipsResources();
 
     return image;
 }
@@ -269,17 +386,78 @@ Image TextureUploader::UploadSkyboxBlocking(const SkyboxCube &skybox)
     return image;
 }
 
+void TextureUploader::CreateResidency(std::span<const TextureInfo> textures)
+{
+    std::vector<vk::Extent2D> extents;
+    std::vector<vk::Format> formats;
+    std::vector<uint32_t> levels;
+    extents.reserve(textures.size());
+    formats.reserve(textures.size());
+    levels.reserve(textures.size());
+
+    // Textures start at the largest level that fits the size every texture can have under the budget
+    for (const TextureInfo &texture : textures)
+    {
+        const vk::Extent2D extent(texture.Width, texture.Height);
+        const vk::Format format = GetResidentFormat(texture);
+        const vk::Extent2D maxExtent = m_MaxTextureSize.at(format);
+
+        uint32_t level = 0;
+        while (!Utils::LteExtent(Image::GetMipExtent(extent, level), maxExtent))
+            level++;
+
+        extents.push_back(extent);
+        formats.push_back(format);
+        levels.push_back(level);
+    }
+
+    m_Residency = TextureResidency(extents, formats, levels);
+}
+
+void TextureUploader::StartUpload(std::span<const uint32_t> textureIndices, bool isInitial)
+{
+    // Loader threads of the previous upload can still be leaving their loop, so they could take new textures
+    for (auto &thread : m_LoaderThreads)
+        if (thread.joinable())
+            thread.join();
+
+    {
+        std::lock_guard lock(m_PendingTexturesMutex);
+        for (uint32_t textureIndex : textureIndices)
+            m_PendingTextures.insert({ m_TexturePriorities[textureIndex], textureIndex });
+    }
+    m_PendingTextureCount = textureIndices.size();
+    m_IsUploading = true;
+
+    StartLoaderThreads(m_Scene);
+    StartSubmitThread(m_Scene, isInitial);
+}
+
+void TextureUploader::UpdatePriorities(std::span<const uint32_t> feedback)
+{
+    assert(feedback.size() == m_TexturePriorities.size());
+    std::lock_guard lock(m_PendingTexturesMutex);
+
+    // Only the textures whose feedback changed are moved in the set
+    for (uint32_t i = 0; i < feedback.size(); i++)
+    {
+        if (feedback[i] == m_TexturePriorities[i])
+            continue;
+
+        if (m_PendingTextures.erase({ m_TexturePriorities[i], i }) > 0)
+            m_PendingTextures.insert({ feedback[i], i });
+        m_TexturePriorities[i] = feedback[i];
+    }
+}
+
 void TextureUploader::StartLoaderThreads(const std::shared_ptr<const Scene> &scene)
 {
     for (auto &thread : m_LoaderThreads)
     {
         thread = std::jthread([scene, this](std::stop_token stopToken) {
             auto textures = scene->GetTextures();
-            while (!stopToken.stop_requested() && m_TextureIndex < textures.size())
+            while (!stopToken.stop_requested())
             {
-                const uint32_t textureIndex = m_TextureIndex++;
-                const TextureInfo &textureInfo = textures[textureIndex];
-
                 m_FreeBuffersSemaphore.acquire();
                 if (stopToken.stop_requested())
                 {
@@ -287,6 +465,21 @@ void TextureUploader::StartLoaderThreads(const std::shared_ptr<const Scene> &sce
                     break;
                 }
 
+                // The texture is chosen as late as possible, so it follows the latest priorities
+                uint32_t textureIndex = 0;
+                {
+                    std::lock_guard lock(m_PendingTexturesMutex);
+                    if (m_PendingTextures.empty())
+                    {
+                        m_FreeBuffersSemaphore.release();
+                        break;
+                    }
+
+                    textureIndex = m_PendingTextures.begin()->Index;
+                    m_PendingTextures.erase(m_PendingTextures.begin());
+                }
+                const TextureInfo &textureInfo = textures[textureIndex];
+
                 Buffer buffer;
                 {
                     std::lock_guard lock(m_FreeBuffersMutex);
@@ -309,9 +502,9 @@ void TextureUploader::StartLoaderThreads(const std::shared_ptr<const Scene> &sce
     }
 }
 
-void TextureUploader::StartSubmitThread(const std::shared_ptr<const Scene> &scene)
+void TextureUploader::StartSubmitThread(const std::shared_ptr<const Scene> &scene, bool isInitial)
 {
-    m_SubmitThread = std::jthread([scene, this](std::stop_token stopToken) {
+    m_SubmitThread = std::jthread([scene, isInitial, this](std::stop_token stopToken) {
         auto textures = scene->GetTextures();
         uint32_t uploadedCount = 0;
 
@@ -320,7 +513,7 @@ void TextureUploader::StartSubmitThread(const std::shared_ptr<const Scene> &scen
         buffers.reserve(m_StagingBufferCount);
         textureIndices.reserve(m_StagingBufferCount);
 
-        while (!stopToken.stop_requested() && uploadedCount < textures.size() - m_RejectedCount)
+        while (!stopToken.stop_requested() && uploadedCount < m_PendingTextureCount)
         {
             m_DataBuffersSemaphore.acquire();
             if (stopToken.stop_requested())
@@ -335,10 +528,10 @@ void TextureUploader::StartSubmitThread(const std::shared_ptr<const Scene> &scen
                 textureIndices.swap(m_TextureIndices);
             }
 
-            if (m_UseTransferQueue)
-                UploadBuffersWithTransfer(textures, textureIndices, buffers);
-            else
-                UploadBuffers(textures, textureIndices, buffers);
+            if (buffers.empty())
+                continue;
+
+            UploadBuffers(textures, textureIndices, buffers);
 
             {
                 std::lock_guard lock(m_FreeBuffersMutex);
@@ -352,40 +545,47 @@ void TextureUploader::StartSubmitThread(const std::shared_ptr<const Scene> &scen
 
             {
                 std::lock_guard lock(m_DescriptorSetMutex);
-                for (uint32_t textureIndex : textureIndices)
+                for (uint32_t i = 0; i < textureIndices.size(); i++)
                 {
-                    const uint32_t sceneTextureIndex = Shaders::GetSceneTextureIndex(textureIndex);
-                    if (m_Textures[sceneTextureIndex].GetHandle() == nullptr)  // Upload failed
-                        continue;
-                    Renderer::UpdateTexture(sceneTextureIndex);
-                    logger::debug("Uploaded Texture: {}", textures[textureIndex].Name);
+                    const uint32_t index = Shaders::GetSceneTextureIndex(textureIndices[i]);
+                    ReplaceTexture(index, std::move(m_UploadedTextures[i]));
+                    Renderer::UpdateTexture(index);
+                    logger::debug("Uploaded Texture: {}", textures[textureIndices[i]].Name);
                 }
+                m_UploadedTextures.clear();
             }
 
-            Application::IncrementBackgroundTaskDone(
-                BackgroundTaskType::TextureUpload, textureIndices.size()
-            );
+            if (isInitial)
+                Application::IncrementBackgroundTaskDone(
+                    BackgroundTaskType::TextureUpload, textureIndices.size()
+                );
             uploadedCount += textureIndices.size();
             buffers.clear();
             textureIndices.clear();
         }
 
-        uint32_t rejectedCount = m_RejectedCount;
-        if (uploadedCount == textures.size() - rejectedCount)
-            logger::info("Done uploading scene textures");
-        else
+        if (uploadedCount < m_PendingTextureCount)
             logger::trace("Texture upload submit thread cancelled");
-        m_FreeBuffersSemaphore.release(rejectedCount);
+        else if (isInitial)
+            logger::info("Done uploading scene textures");
 
-        if (rejectedCount > 0)
-            logger::warn("{} texture(s) weren't uploaded", rejectedCount);
+        m_IsUploading = false;
     });
 }
 
+void TextureUploader::ReplaceTexture(uint32_t index, Image &&image)
+{
+    // The replaced texture can still be used by the frames in flight
+    if (m_Textures[index].GetHandle() != nullptr)
+        m_RetiredTextures.push_back({ std::move(m_Textures[index]), m_FrameIndex });
+    m_Textures[index] = std::move(image);
+}
+
 void TextureUploader::UploadToBuffer(
     const TextureInfo &textureInfo, const Buffer &buffer, vk::DeviceSize offset
 )
 {
+    static_assert(TextureImporter::MaxCachedTextureSize <= StagingBufferSize);
     TextureData data = TextureImporter::LoadTextureData(textureInfo);
 
     const vk::Extent2D extent(textureInfo.Width, textureInfo.Height);
@@ -400,117 +600,82 @@ void TextureUploader::UploadToBuffer(
 
 void TextureUploader::UploadTexture(
     vk::CommandBuffer mipBuffer, vk::CommandBuffer transferBuffer, const TextureInfo &texture,
-    uint32_t textureIndex, const Buffer &buffer
+    uint32_t level, const Buffer &buffer
 )
 {
-    const vk::Format format = GetImageFormat(texture.Type, texture.Format);
-    m_ImageBuilder.SetFormat(format);
+    const vk::Extent2D originalExtent(texture.Width, texture.Height);
+    const vk::Format sourceFormat = GetImageFormat(texture.Type, texture.Format);
+
+    vk::Format format = sourceFormat;
+    const UploadExtents extents = GetUploadExtents(texture, level);
+    bool hasSource = extents.Extent != extents.SourceExtent;
+    const bool generatesMips =
+        hasSource || texture.Levels - extents.SkippedMips < Image::GetMipLevels(extents.Extent);
+
+    // Block compressed formats can't be written by the mip pipeline
+    if (generatesMips && !IsStorageFormat(format))
+    {
+        logger::debug("Texture {} is decoded, since its mips have to be generated", texture.Name);
+        format = GetImageFormat(texture.Type, TextureFormat::RGBAU8);
+        hasSource = true;
+    }
 
-    const vk::Extent2D maxExtent = m_MaxTextureSize.at(format);
-    const uint32_t scale = std::max(
-        std::ceil(static_cast<float>(texture.Width) / maxExtent.width),
-        std::ceil(static_cast<float>(texture.Height) / maxExtent.height)
+    vk::DeviceSize offset = 0;
+    for (uint32_t mip = 0; mip < extents.SkippedMips; mip++)
+        offset += Image::GetSize(Image::GetMipExtent(originalExtent, mip), sourceFormat);
+
+    const vk::ImageUsageFlags usageFlags = vk::ImageUsageFlagBits::eTransferSrc |
+                                           vk::ImageUsageFlagBits::eTransferDst |
+                                           vk::ImageUsageFlagBits::eSampled;
+    m_ImageBuilder.SetFormat(format).SetUsageFlags(
+        generatesMips ? usageFlags | vk::ImageUsageFlagBits::eStorage : usageFlags
     );
-    const uint32_t width = std::max(texture.Width / scale, 1u);
-    const uint32_t height = std::max(texture.Height / scale, 1u);
 
-    const vk::Extent2D originalExtent(texture.Width, texture.Height);
-    const vk::Extent2D extent(width, height);
+    // Mips targets point into the uploaded textures, so they can't be reallocated
+    assert(m_UploadedTextures.size() < m_UploadedTextures.capacity());
+    Image &image = m_UploadedTextures.emplace_back(m_ImageBuilder.CreateImage(extents.Extent, texture.Name));
 
-    Image image = m_ImageBuilder.CreateImage(extent, texture.Name);
-    if (Utils::LteExtent(originalExtent, maxExtent))
+    if (!generatesMips)
     {
-        if (texture.Levels != image.GetMipLevels() && !m_ScalingImages.contains(format) && texture.Levels == 1)
-        {
-            logger::warn(
-                "Texture {} has only one mip map and mips can't be generated for it since it's format "
-                "doesn't support it", texture.Name
-            );
-            image = ImageBuilder()
-                        .SetUsageFlags(
-                            vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst |
-                            vk::ImageUsageFlagBits::eSampled
-                        )
-                        .SetFormat(format)
-                        .CreateImage(extent, texture.Name);
-            image.UploadFromBuffer(transferBuffer, buffer, 0, originalExtent, 0, texture.Levels);
-        }
-        else
-        {
-            image.UploadFromBuffer(transferBuffer, buffer, 0, originalExtent, 0, texture.Levels);
+        image.UploadFromBuffer(transferBuffer, buffer, offset, image.GetExtent(), 0, image.GetMipLevels());
+        ReleaseTexture(mipBuffer, image, vk::ImageLayout::eTransferDstOptimal);
+        return;
+    }
 
-            if (texture.Levels != image.GetMipLevels())
-            {
-                if (!m_ScalingImages.contains(format))
-                {
-                    logger::error(
-                        "Could not upload texture {} because it requires generating mip maps and "
-                        "it's format doesn't support the blit operation",
-                        texture.Name
-                    );
-                    m_RejectedCount++;
-                    Application::IncrementBackgroundTaskDone(BackgroundTaskType::TextureUpload);
-                    return;
-                }
+    MipsTarget target = { .Texture = &image, .Flags = GetMipsFlags(texture.Type, format) };
+    const Image *uploaded = &image;
 
-                image.GenerateFullMips(mipBuffer, vk::ImageLayout::eTransferDstOptimal);
-            }
-        }
+    if (hasSource)
+    {
+        target.Source = ImageBuilder()
+                            .SetFormat(sourceFormat)
+                            .SetUsageFlags(
+                                vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+                            )
+                            .CreateImage(extents.SourceExtent, std::format("Mips Source: {}", texture.Name));
+        target.Source.UploadFromBuffer(transferBuffer, buffer, offset, extents.SourceExtent, 0, 1);
+        target.FirstLevel = 0;
+        uploaded = &target.Source;
+
+        image.Transition(mipBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
     }
     else
     {
-        if (texture.Levels == 1)
-        {
-            if (!m_ScalingImages.contains(format))
-            {
-                logger::error(
-                    "Could not upload texture {} it requires scaling since "
-                    "it's size ({}x{}) is greater than the max texture size ({}x{}) "
-                    "it's format ({}) doesn't support the blit operation",
-                    texture.Name, originalExtent.width, originalExtent.height, maxExtent.width,
-                    maxExtent.height, vk::to_string(format)
-                );
-                m_RejectedCount++;
-                Application::IncrementBackgroundTaskDone(BackgroundTaskType::TextureUpload);
-                return;
-            }
-
-            const Image &temporary = m_ScalingImages.at(format);
-            const uint32_t fromMip = temporary.GetMip(originalExtent), toMip = temporary.GetMip(extent);
-            temporary.UploadFromBuffer(transferBuffer, buffer, 0, originalExtent, fromMip, 1);
-            temporary.TransitionWithQueueChange(
-                transferBuffer, mipBuffer, vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits2::eAllCommands,
-                vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eNone, vk::AccessFlagBits2::eNone,
-                DeviceContext::GetTransferQueue().FamilyIndex, DeviceContext::GetMipQueue().FamilyIndex
-            );
-            temporary.GenerateMips(mipBuffer, vk::ImageLayout::eTransferSrcOptimal, fromMip, toMip);
-
-            temporary.CopyMipTo(mipBuffer, image, toMip);
-            image.GenerateFullMips(mipBuffer, vk::ImageLayout::eTransferDstOptimal);
-        }
-        else
-        {
-            assert(texture.Levels >= image.GetMipLevels());
-            vk::DeviceSize offset = 0;
-            for (uint32_t mip = 0; mip < texture.Levels - image.GetMipLevels(); mip++)
-                offset += Image::GetSize(Image::GetMipExtent(originalExtent, mip), image.GetFormat());
-
-            image.UploadFromBuffer(
-                transferBuffer, buffer, offset, image.GetExtent(), 0, image.GetMipLevels()
-            );
-        }
+        // Levels that are generated have to be in the same layout for the ownership transfer
+        target.FirstLevel = texture.Levels - extents.SkippedMips;
+        image.Transition(transferBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+        image.UploadFromBuffer(transferBuffer, buffer, offset, image.GetExtent(), 0, target.FirstLevel);
     }
 
-    // Release barrier
-    image.TransitionWithQueueChange(
-        mipBuffer, nullptr, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
-        vk::PipelineStageFlagBits2::eAllCommands, vk::PipelineStageFlagBits2::eAllCommands,
-        vk::AccessFlagBits2::eNone, vk::AccessFlagBits2::eNone, DeviceContext::GetMipQueue().FamilyIndex,
-        DeviceContext::GetGraphicsQueue().FamilyIndex
+    uploaded->TransitionWithQueueChange(
+        transferBuffer, mipBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
+        vk::PipelineStageFlagBits2::eTransfer, vk::PipelineStageFlagBits2::eComputeShader,
+        vk::AccessFlagBits2::eTransferWrite, vk::AccessFlagBits2::eShaderSampledRead,
+        DeviceContext::GetTransferQueue().FamilyIndex, DeviceContext::GetMipQueue().FamilyIndex
     );
 
-    m_Textures[Shaders::GetSceneTextureIndex(textureIndex)] = std::move(image);
+    m_MipsSourceSize += target.Source.GetHandle() != nullptr ? target.Source.GetMipSize(0) : 0;
+    m_MipsTargets.push_back(std::move(target));
 }
 
 void TextureUploader::UploadBuffers(
@@ -518,36 +683,172 @@ void TextureUploader::UploadBuffers(
     std::span<const Buffer> buffers
 )
 {
-    m_MipCommandBuffer.Begin();
+    const vk::CommandBuffer transferBuffer =
+        m_UseTransferQueue ? m_TransferCommandBuffer.Buffer : m_MipCommandBuffer.Buffer;
+
+    m_UploadedTextures.reserve(buffers.size());
+
+    BeginBatch();
     for (int i = 0; i < buffers.size(); i++)
+    {
+        // Sources are kept until the batch finishes, so batches are split to limit the memory they use
+        if (m_MipsTargets.size() == Shaders::MaxTextureMipsBatchSize || m_MipsSourceSize >= MaxMipsSourceSize)
+        {
+            SubmitBatch();
+            BeginBatch();
+        }
+
         UploadTexture(
-            m_MipCommandBuffer.Buffer, m_MipCommandBuffer.Buffer, textures[textureIndices[i]],
-            textureIndices[i], buffers[i]
+            m_MipCommandBuffer.Buffer, transferBuffer, textures[textureIndices[i]],
+            m_Residency.GetLevel(textureIndices[i]), buffers[i]
         );
+    }
+    SubmitBatch();
+}
+
+void TextureUploader::BeginBatch()
+{
+    if (!m_UseTransferQueue)
+    {
+        m_MipCommandBuffer.Begin();
+        return;
+    }
+
+    m_TransferCommandBuffer.Begin();
+    vk::Semaphore semaphore = m_TransferCommandBuffer.Signal();
+    m_MipCommandBuffer.Begin(semaphore, vk::PipelineStageFlagBits2::eAllCommands);
+}
+
+void TextureUploader::SubmitBatch()
+{
+    RecordMipsCommands(m_MipCommandBuffer.Buffer);
+    for (const MipsTarget &target : m_MipsTargets)
+        ReleaseTexture(m_MipCommandBuffer.Buffer, *target.Texture, vk::ImageLayout::eGeneral);
+
+    if (m_UseTransferQueue)
+        m_TransferCommandBuffer.Submit();
     m_MipCommandBuffer.SubmitBlocking();
+
+    ReleaseMipsResources();
 }
 
-void TextureUploader::UploadBuffersWithTransfer(
-    std::span<const TextureInfo> textures, std::span<const uint32_t> textureIndices,
-    std::span<const Buffer> buffers
-)
+void TextureUploader::RecordMipsCommands(vk::CommandBuffer commandBuffer)
 {
-    for (int i = 0; i < buffers.size(); i++)
+    if (m_MipsTargets.empty())
+        return;
+
+    assert(m_MipsTargets.size() <= Shaders::MaxTextureMipsBatchSize);
+    DescriptorSet *descriptorSet = m_MipsPipeline->GetDescriptorSet();
+
+    uint32_t levelCount = 0;
+    for (uint32_t slot = 0; slot < m_MipsTargets.size(); slot++)
     {
-        m_TransferCommandBuffer.Begin();
-        vk::Semaphore semaphore = m_TransferCommandBuffer.Signal();
-        m_MipCommandBuffer.Begin(semaphore, vk::PipelineStageFlagBits2::eTransfer);
+        const MipsTarget &target = m_MipsTargets[slot];
+        const Image &texture = *target.Texture;
 
-        UploadTexture(
-            m_MipCommandBuffer.Buffer, m_TransferCommandBuffer.Buffer, textures[textureIndices[i]],
-            textureIndices[i], buffers[i]
+        descriptorSet->UpdateImage(0, 0, texture, m_MipsSampler, vk::ImageLayout::eGeneral, slot);
+        if (target.Source.GetHandle() != nullptr)
+            descriptorSet->UpdateImage(1, 0, target.Source, m_MipsSampler, vk::ImageLayout::eGeneral, slot);
+
+        const uint32_t viewCount = texture.GetMipLevels() - target.FirstLevel;
+        for (uint32_t level = target.FirstLevel; level < texture.GetMipLevels(); level++)
+            m_MipsViews.push_back(texture.CreateStorageView(level));
+
+        const uint32_t binding = (target.Flags & Shaders::TextureMipsFlagsFloat) ? 3 : 2;
+        descriptorSet->UpdateImageArrayFromViews(
+            binding, 0, std::span(m_MipsViews).last(viewCount), vk::Sampler(), vk::ImageLayout::eGeneral,
+            slot * Shaders::MaxTextureMipLevels + target.FirstLevel
         );
 
-        m_TransferCommandBuffer.Submit();
-        m_MipCommandBuffer.SubmitBlocking();
+        levelCount = std::max(levelCount, texture.GetMipLevels());
+    }
+    descriptorSet->FlushUpdate(0);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_MipsPipeline->GetHandle());
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, m_MipsPipeline->GetLayout(), 0, { descriptorSet->GetSet(0) }, {}
+    );
+
+    // Every level is a single dispatch for the whole batch
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        Shaders::TextureMipsPushConstants pushConstants = {};
+        pushConstants.Level = level;
+
+        vk::Extent2D extent(0, 0);
+        for (uint32_t slot = 0; slot < m_MipsTargets.size(); slot++)
+        {
+            const MipsTarget &target = m_MipsTargets[slot];
+            if (level < target.FirstLevel || level >= target.Texture->GetMipLevels())
+                continue;
+
+            pushConstants.TextureFlags[slot] = target.Flags | Shaders::TextureMipsFlagsActive;
+            extent.width = std::max(extent.width, target.Texture->GetMipExtent(level).width);
+            extent.height = std::max(extent.height, target.Texture->GetMipExtent(level).height);
+        }
+
+        if (extent.width == 0)
+            continue;
+
+        commandBuffer.pushConstants(
+            m_MipsPipeline->GetLayout(), vk::ShaderStageFlagBits::eCompute, 0u, sizeof(pushConstants),
+            &pushConstants
+        );
+
+        const uint32_t groupSizeX =
+            std::ceil(static_cast<float>(extent.width) / Shaders::TextureMipsShaderGroupSizeX);
+        const uint32_t groupSizeY =
+            std::ceil(static_cast<float>(extent.height) / Shaders::TextureMipsShaderGroupSizeY);
+        commandBuffer.dispatch(groupSizeX, groupSizeY, m_MipsTargets.size());
+
+        for (uint32_t slot = 0; slot < m_MipsTargets.size(); slot++)
+        {
+            if (pushConstants.TextureFlags[slot] == Shaders::TextureMipsFlagsNone)
+                continue;
+
+            Image::Transition(
+                commandBuffer, m_MipsTargets[slot].Texture->GetHandle(), vk::ImageLayout::eGeneral,
+                vk::ImageLayout::eGeneral, vk::PipelineStageFlagBits2::eComputeShader,
+                vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+                vk::AccessFlagBits2::eShaderSampledRead, level
+            );
+        }
     }
 }
 
+void TextureUploader::ReleaseMipsResources()
+{
+    for (vk::ImageView view : m_MipsViews)
+        DeviceContext::GetLogical().destroyImageView(view);
+    m_MipsViews.clear();
+    m_MipsTargets.clear();
+    m_MipsSourceSize = 0;
+}
+
+void TextureUploader::ReleaseTexture(
+    vk::CommandBuffer mipBuffer, const Image &image, vk::ImageLayout layout
+) const
+{
+    image.TransitionWithQueueChange(
+        mipBuffer, nullptr, layout, vk::ImageLayout::eShaderReadOnlyOptimal,
+        vk::PipelineStageFlagBits2::eAllCommands, vk::PipelineStageFlagBits2::eAllCommands,
+        vk::AccessFlagBits2::eNone, vk::AccessFlagBits2::eNone, DeviceContext::GetMipQueue().FamilyIndex,
+        DeviceContext::GetGraphicsQueue().FamilyIndex
+    );
+}
+
+TextureUploader::UploadExtents TextureUploader::GetUploadExtents(const TextureInfo &texture, uint32_t level)
+{
+    const vk::Extent2D originalExtent(texture.Width, texture.Height);
+
+    // Textures are scaled by skipping the mips they have, the rest is scaled by the mip pipeline
+    const uint32_t skippedMips = std::min(level, texture.Levels - 1);
+    const vk::Extent2D sourceExtent = Image::GetMipExtent(originalExtent, skippedMips);
+    const vk::Extent2D extent = Image::GetMipExtent(originalExtent, level);
+
+    return { skippedMips, sourceExtent, extent };
+}
+
 void TextureUploader::DetermineMaxTextureSizes(size_t textureCount, bool forceFullSize)
 {
     const size_t textureBudget = GetTextureBudget();
@@ -568,6 +869,34 @@ void TextureUploader::DetermineMaxTextureSizes(size_t textureCount, bool forceFu
     }
 }
 
+vk::Format TextureUploader::GetResidentFormat(const TextureInfo &texture)
+{
+    const vk::Format format = GetImageFormat(texture.Type, texture.Format);
+    const vk::Extent2D extent(texture.Width, texture.Height);
+
+    // Block compressed textures without all of their mips are decoded, so the mips can be generated
+    if (texture.Levels < Image::GetMipLevels(extent) && !IsStorageFormat(format))
+        return GetImageFormat(texture.Type, TextureFormat::RGBAU8);
+    return format;
+}
+
+uint32_t TextureUploader::GetMipsFlags(TextureType type, vk::Format format)
+{
+    uint32_t flags = Shaders::TextureMipsFlagsNone;
+    if (format == vk::Format::eR32G32B32A32Sfloat)
+        flags |= Shaders::TextureMipsFlagsFloat;
+    if (format == vk::Format::eR8G8B8A8Srgb)
+        flags |= Shaders::TextureMipsFlagsSrgb;
+    if (type == TextureType::Color)
+        flags |= Shaders::TextureMipsFlagsAlphaWeighted;
+    return flags;
+}
+
+bool TextureUploader::IsStorageFormat(vk::Format format)
+{
+    return std::ranges::find(StorageFormats, format) != StorageFormats.end();
+}
+
 vk::Format TextureUploader::GetImageFormat(TextureType type, TextureFormat format)
 {
     // We assume that color textures are in srgb space
@@ -586,7 +915,7 @@ vk::Format TextureUploader::GetImageFormat(TextureType type, TextureFormat forma
     case TextureFormat::BC1:
         return isColorTexture(type) ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
     case TextureFormat::BC3:
-        return vk::Format::eBc3SrgbBlock;
+        return isColorTexture(type) ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
     case TextureFormat::BC5:
         return vk::Format::eBc5UnormBlock;
     default:
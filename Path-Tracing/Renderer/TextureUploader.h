@@ -3,9 +3,11 @@
 #include <vulkan/vulkan.hpp>
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <semaphore>
+#include <set>
 #include <thread>
 
 #include "Scene.h"
@@ -13,14 +15,25 @@
 #include "Buffer.h"
 #include "CommandBuffer.h"
 #include "Image.h"
+#include "Pipeline.h"
+#include "ShaderLibrary.h"
+#include "TextureResidency.h"
 
 namespace PathTracing
 {
 
+using TextureMipsPipelineConfig = PipelineConfig<0>;
+
+// Mips that textures don't have are generated on the mip queue with a compute pipeline
+// The pipeline also scales down textures without mips and decodes block compressed textures that need mips
+// After the scene textures are uploaded, textures are uploaded again at the levels chosen by the residency
 class TextureUploader
 {
 public:
-    TextureUploader(std::vector<Image> &textures, std::mutex &descriptorSetMutex);
+    TextureUploader(
+        std::vector<Image> &textures, std::mutex &descriptorSetMutex, ShaderLibrary &shaderLibrary,
+        ShaderId mipsShaderId
+    );
     ~TextureUploader();
 
     TextureUploader(const TextureUploader &) = delete;
@@ -30,6 +43,13 @@ public:
     void UploadTextures(const std::shared_ptr<const Scene> &scene);
     void Cancel();
 
+    // Reads the feedback a finished frame copied back, textures are streamed every few calls
+    // Pending textures are reordered by the feedback, so the textures in view are loaded first
+    void UpdateResidency(const Buffer &feedbackBuffer);
+
+    // Lock the descriptor set mutex before calling, it has to be called once per frame
+    void ReleaseRetiredTextures(uint32_t framesInFlight);
+
     // These use the Renderer's command buffer and staging buffer
     Image UploadFromRawContentBlocking(
         std::span<const std::byte> data, TextureType type, TextureFormat format, vk::Extent2D extent,
@@ -51,15 +71,67 @@ private:
 
     const bool m_UseTransferQueue;
 
-    std::unordered_map<vk::Format, Image> m_ScalingImages;
     std::unordered_map<vk::Format, vk::Extent2D> m_MaxTextureSize;
 
+    std::shared_ptr<const Scene> m_Scene = nullptr;
+    TextureResidency m_Residency;
+    bool m_IsStreaming = false;
+    uint32_t m_FeedbackFrameCount = 0;
+    std::vector<uint32_t> m_Feedback;
+
+    // Replaced textures are destroyed when no frame in flight can use them
+    struct RetiredTexture
+    {
+        Image Texture;
+        uint64_t Frame;
+    };
+
+    std::vector<RetiredTexture> m_RetiredTextures;
+    uint64_t m_FrameIndex = 0;
+
+    // The pipeline isn't updated on shader reload, since the submit thread may be recording with it
+    std::unique_ptr<ComputePipeline> m_MipsPipeline;
+    vk::Sampler m_MipsSampler;
+
+    struct MipsTarget
+    {
+        const Image *Texture;
+        Image Source;  // Level 0 is filtered from the source when it's present
+        uint32_t FirstLevel;
+        uint32_t Flags;
+    };
+
+    // Cleared when the command buffer that generates the mips finishes
+    std::vector<MipsTarget> m_MipsTargets;
+    std::vector<vk::ImageView> m_MipsViews;
+    vk::DeviceSize m_MipsSourceSize = 0;
+
     std::jthread m_SubmitThread;
     ImageBuilder m_ImageBuilder;
 
     std::vector<std::jthread> m_LoaderThreads;
-    std::atomic<uint32_t> m_TextureIndex = 0;
-    std::atomic<uint32_t> m_RejectedCount = 0;
+
+    struct PendingTexture
+    {
+        uint32_t Priority;
+        uint32_t Index;
+
+        // Higher priorities come first, textures of the same priority are loaded in the scene order
+        bool operator<(const PendingTexture &other) const
+        {
+            return Priority != other.Priority ? Priority > other.Priority : Index < other.Index;
+        }
+    };
+
+    // Loader threads take the first pending texture once they have a free buffer
+    std::mutex m_PendingTexturesMutex;
+    std::set<PendingTexture> m_PendingTextures;
+    std::vector<uint32_t> m_TexturePriorities;  // Last feedback of every scene texture
+    uint32_t m_PendingTextureCount = 0;
+    std::atomic<bool> m_IsUploading = false;
+
+    // Textures of the current batch, they replace the scene textures when the batch finishes
+    std::vector<Image> m_UploadedTextures;
 
     std::counting_semaphore<> m_FreeBuffersSemaphore;  // How many Free Buffers there are
     std::mutex m_FreeBuffersMutex;
@@ -75,36 +147,61 @@ private:
     static inline constexpr size_t StagingBufferSize =
         4ull * MaxTextureDataSize.width * MaxTextureDataSize.height;
 
-    static inline constexpr std::array<vk::Format, 2> ScalingFormats = { vk::Format::eR8G8B8A8Unorm,
-                                                                         vk::Format::eR8G8B8A8Srgb };
-    static inline constexpr std::array<vk::Format, 7> SupportedFormats = {
+    static inline constexpr vk::DeviceSize MaxMipsSourceSize = 2 * StagingBufferSize;
+
+    static inline constexpr uint32_t ResidencyUpdateFrameCount = 30;
+    static inline constexpr uint32_t MaxStreamedTextureCount = 32;
+
+    static inline constexpr std::array<vk::Format, 3> StorageFormats = { vk::Format::eR8G8B8A8Unorm,
+                                                                         vk::Format::eR8G8B8A8Srgb,
+                                                                         vk::Format::eR32G32B32A32Sfloat };
+    static inline constexpr std::array<vk::Format, 8> SupportedFormats = {
         vk::Format::eR8G8B8A8Unorm,     vk::Format::eR8G8B8A8Srgb,     vk::Format::eR32G32B32A32Sfloat,
-        vk::Format::eBc1RgbaUnormBlock, vk::Format::eBc1RgbaSrgbBlock, vk::Format::eBc3SrgbBlock,
-        vk::Format::eBc5UnormBlock
+        vk::Format::eBc1RgbaUnormBlock, vk::Format::eBc1RgbaSrgbBlock, vk::Format::eBc3UnormBlock,
+        vk::Format::eBc3SrgbBlock,      vk::Format::eBc5UnormBlock
     };
 
 private:
     void DetermineMaxTextureSizes(size_t textureCount, bool forceFullSize);
 
+    void CreateResidency(std::span<const TextureInfo> textures);
+    void StartUpload(std::span<const uint32_t> textureIndices, bool isInitial);
+    void UpdatePriorities(std::span<const uint32_t> feedback);
     void StartLoaderThreads(const std::shared_ptr<const Scene> &scene);
-    void StartSubmitThread(const std::shared_ptr<const Scene> &scene);
+    void StartSubmitThread(const std::shared_ptr<const Scene> &scene, bool isInitial);
+    void ReplaceTexture(uint32_t index, Image &&image);
 
     void UploadToBuffer(const TextureInfo &textureInfo, const Buffer &buffer, vk::DeviceSize offset = 0);
     void UploadTexture(
         vk::CommandBuffer mipBuffer, vk::CommandBuffer transferBuffer, const TextureInfo &texture,
-        uint32_t textureIndex, const Buffer &buffer
+        uint32_t level, const Buffer &buffer
     );
 
     void UploadBuffers(
         std::span<const TextureInfo> textures, std::span<const uint32_t> textureIndices,
         std::span<const Buffer> buffers
     );
-    void UploadBuffersWithTransfer(
-        std::span<const TextureInfo> textures, std::span<const uint32_t> textureIndices,
-        std::span<const Buffer> buffers
-    );
+    void BeginBatch();
+    void SubmitBatch();
+
+    // Leaves the targets in the general layout
+    void RecordMipsCommands(vk::CommandBuffer commandBuffer);
+    void ReleaseMipsResources();
+    void ReleaseTexture(vk::CommandBuffer mipBuffer, const Image &image, vk::ImageLayout layout) const;
+
+    struct UploadExtents
+    {
+        uint32_t SkippedMips;
+        vk::Extent2D SourceExtent;
+        vk::Extent2D Extent;
+    };
+
+    [[nodiscard]] static UploadExtents GetUploadExtents(const TextureInfo &texture, uint32_t level);
 
     vk::Format GetImageFormat(TextureType type, TextureFormat format);
+    vk::Format GetResidentFormat(const TextureInfo &texture);
+    static uint32_t GetMipsFlags(TextureType type, vk::Format format);
+    static bool IsStorageFormat(vk::Format format);
 };
 
 }
@@ -1,7 +1,11 @@
 #include <glm/ext/matrix_relational.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <ranges>
+#include <utility>
 
+#include "Core/Cache.h"
 #include "Core/Core.h"
 
 #include "Scene.h"
@@ -14,7 +18,7 @@ Scene::Scene(
     std::vector<uint32_t> &&indices, std::vector<uint32_t> &&animatedIndices,
     std::vector<glm::mat3x4> &&transforms, std::vector<Geometry> &&geometries,
     std::vector<Shaders::MetallicRoughnessMaterial> &&metallicRoughnessMaterials,
-    std::vector<TextureInfo> &&textures,
+    std::vector<TextureInfo> &&textures, std::vector<std::shared_ptr<const void>> &&textureBuffers,
     std::vector<Shaders::SpecularGlossinessMaterial> &&specularGlossinessMaterials,
     std::vector<Shaders::PhongMaterial> &&phongMaterials, std::vector<Model> &&models,
     std::vector<ModelInstance> &&modelInstances, std::vector<Bone> &&bones, SceneGraph &&sceneGraph,
@@ -27,26 +31,61 @@ Scene::Scene(
       m_Indices(std::move(indices)), m_AnimatedIndices(std::move(animatedIndices)),
       m_Transforms(std::move(transforms)), m_Geometries(std::move(geometries)),
       m_MetallicRoughnessMaterials(std::move(metallicRoughnessMaterials)), m_Textures(std::move(textures)),
+      m_TextureBuffers(std::move(textureBuffers)),
       m_SpecularGlossinessMaterials(std::move(specularGlossinessMaterials)),
       m_PhongMaterials(std::move(phongMaterials)), m_Models(std::move(models)),
       m_ModelInstances(std::move(modelInstances)), m_Bones(std::move(bones)),
-      m_BoneTransforms(m_Bones.size()), m_Graph(std::move(sceneGraph)), m_LightInfos(std::move(lightInfos)),
+      m_BoneTransforms(m_Bones.size()), m_BoneNormalMatrices(m_Bones.size()), m_Graph(std::move(sceneGraph)),
+      m_LightInfos(std::move(lightInfos)),
       m_PointLights(std::move(pointLights)), m_DirectionalLight(std::move(directionalLight)),
       m_DirectionalLightInfo(std::move(directionalLightInfo)), m_Skybox(std::move(skybox)),
       m_ActiveCameraId(g_InputCameraId), m_HasAnimatedInstances(hasAnimatedInstances),
       m_HasDxNormalTextures(hasDxNormalTextures), m_ForceFullTextureSize(forceFullTextureSize), m_Name(name)
 {
-    auto nodes = m_Graph.GetSceneNodes();
+    auto transforms = m_Graph.GetTransforms();
+
+    m_NormalMatrices.resize(m_Transforms.size());
+    std::ranges::transform(m_Transforms, m_NormalMatrices.begin(), GetNormalMatrix);
 
     m_SceneCameras.reserve(cameraInfos.size());
     for (const auto &info : cameraInfos)
         m_SceneCameras.emplace_back(
             info.VerticalFOV, info.NearClip, info.FarClip, info.Position, info.Direction, info.UpDirection,
-            nodes[info.SceneNodeIndex].CurrentTransform
+            transforms[info.SceneNodeIndex]
         );
 
     m_HasSkeletalAnimations =
         std::any_of(m_Geometries.begin(), m_Geometries.end(), [](const auto &g) { return g.IsAnimated; });
+
+    // Find bones that influence each model, so only models with moving bones are marked as changed
+    m_ModelVersions.resize(m_Models.size());
+    if (m_HasSkeletalAnimations)
+    {
+        m_ModelBones.resize(m_Models.size());
+        for (int i = 0; i < m_Models.size(); i++)
+        {
+            std::vector<uint32_t> &bones = m_ModelBones[i];
+            for (const Mesh &mesh : m_Models[i].Meshes)
+            {
+                const Geometry &geometry = m_Geometries[mesh.GeometryIndex];
+                if (!geometry.IsAnimated)
+                    continue;
+
+                for (int j = 0; j < geometry.VertexLength; j++)
+                {
+                    const auto &vertex = m_AnimatedVertices[geometry.VertexOffset + j];
+                    for (int k = 0; k < Shaders::MaxBonesPerVertex; k++)
+                        if (vertex.BoneWeights[k] > 0.0f)
+                            bones.push_back(vertex.BoneIndices[k]);
+                }
+            }
+
+            std::ranges::sort(bones);
+            bones.erase(std::unique(bones.begin(), bones.end()), bones.end());
+        }
+    }
+
+    UpdateNodeDependents(true);
 }
 
 bool Scene::Update(float timeStep)
@@ -57,29 +96,78 @@ bool Scene::Update(float timeStep)
     updated |= GetActiveCamera().OnUpdate(timeStep);
 
     Stats::AddStat("Animations", "Animations: {}", m_IsAnimationPaused ? "Paused" : "Playing");
-    if (m_IsAnimationPaused)
+
+    bool isGraphChanged = false;
+    if (m_AnimationSeekTime.has_value())
+        isGraphChanged = m_Graph.Seek(std::exchange(m_AnimationSeekTime, std::nullopt).value());
+    else if (!m_IsAnimationPaused)
+        isGraphChanged = m_Graph.Update(timeStep);
+
+    if (!isGraphChanged)
         return updated;
 
     updated |= m_HasAnimatedInstances;
+    UpdateNodeDependents(false);
 
-    m_Graph.Update(timeStep);
+    return updated;
+}
 
-    auto nodes = m_Graph.GetSceneNodes();
+void Scene::UpdateNodeDependents(bool updateAll)
+{
+    auto transforms = m_Graph.GetTransforms();
+    auto isChanged = [this, updateAll](uint32_t nodeIndex) {
+        return updateAll || m_Graph.IsNodeChanged(nodeIndex);
+    };
 
+    bool haveInstancesChanged = false;
     for (auto &instance : m_ModelInstances)
-        instance.Transform = nodes[instance.SceneNodeIndex].CurrentTransform;
+    {
+        if (!isChanged(instance.SceneNodeIndex))
+            continue;
+
+        instance.Transform = transforms[instance.SceneNodeIndex];
+        haveInstancesChanged = true;
+    }
+
+    if (haveInstancesChanged)
+        m_InstanceTransformsVersion++;
 
+    std::vector<bool> hasBoneChanged(m_Bones.size(), false);
+    bool haveBonesChanged = false;
     for (int i = 0; i < m_Bones.size(); i++)
-        m_BoneTransforms[i] = m_Bones[i].Offset * nodes[m_Bones[i].SceneNodeIndex].CurrentTransform;
+    {
+        if (!isChanged(m_Bones[i].SceneNodeIndex))
+            continue;
+
+        m_BoneTransforms[i] = m_Bones[i].Offset * glm::mat4(transforms[m_Bones[i].SceneNodeIndex]);
+        m_BoneNormalMatrices[i] = GetNormalMatrix(m_BoneTransforms[i]);
+        hasBoneChanged[i] = true;
+        haveBonesChanged = true;
+    }
+
+    if (haveBonesChanged)
+    {
+        m_BoneTransformsVersion++;
+        for (int i = 0; i < m_ModelBones.size(); i++)
+            if (std::ranges::any_of(m_ModelBones[i], [&hasBoneChanged](uint32_t bone) {
+                    return hasBoneChanged[bone];
+                }))
+                m_ModelVersions[i] = m_BoneTransformsVersion;
+    }
 
     for (int i = 0; i < m_LightInfos.size(); i++)
-        m_PointLights[i].Position = glm::vec4(m_LightInfos[i].Position, 1.0f) *
-                                    nodes[m_LightInfos[i].SceneNodeIndex].CurrentTransform;
+        if (isChanged(m_LightInfos[i].SceneNodeIndex))
+            m_PointLights[i].Position =
+                glm::vec4(m_LightInfos[i].Position, 1.0f) * transforms[m_LightInfos[i].SceneNodeIndex];
 
-    m_DirectionalLight.Direction = glm::vec4(m_DirectionalLightInfo.Direction, 0.0f) *
-                                   nodes[m_DirectionalLightInfo.SceneNodeIndex].CurrentTransform;
+    if (isChanged(m_DirectionalLightInfo.SceneNodeIndex))
+        m_DirectionalLight.Direction = glm::vec4(m_DirectionalLightInfo.Direction, 0.0f) *
+                                       transforms[m_DirectionalLightInfo.SceneNodeIndex];
+}
 
-    return updated;
+glm::mat3x4 Scene::GetNormalMatrix(const glm::mat3x4 &transform)
+{
+    return glm::mat3x4(glm::transpose(glm::inverse(glm::mat4(transform))));
 }
 
 const std::string &Scene::GetName() const
@@ -99,14 +187,104 @@ void SceneBuilder::AddAnimation(Animation &&animation)
     m_Animations.push_back(std::move(animation));
 }
 
-uint32_t SceneBuilder::AddGeometry(Geometry &&geometry)
+uint32_t SceneBuilder::AddGeometry(Geometry &&geometry, bool *isDuplicate)
 {
+    if (isDuplicate != nullptr)
+        *isDuplicate = false;
+
+    // Animated geometries reference their own bones, so only static ones are merged
+    const size_t hash = geometry.IsAnimated ? 0 : GetGeometryHash(geometry);
+    if (!geometry.IsAnimated)
+    {
+        auto [begin, end] = m_GeometryIndices.equal_range(hash);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (!IsSameGeometry(m_Geometries[it->second], geometry))
+                continue;
+
+            logger::trace(
+                "Merged Geometry with {} vertices into Geometry {}", geometry.VertexLength, it->second
+            );
+            if (isDuplicate != nullptr)
+                *isDuplicate = true;
+            return it->second;
+        }
+    }
+
     logger::trace(
         "Added Geometry to Scene with {} vertices and {} indices", geometry.VertexLength, geometry.IndexLength
     );
 
     m_Geometries.push_back(geometry);
-    return m_Geometries.size() - 1;
+    const uint32_t geometryIndex = m_Geometries.size() - 1;
+
+    if (!geometry.IsAnimated)
+        m_GeometryIndices.emplace(hash, geometryIndex);
+
+    return geometryIndex;
+}
+
+size_t SceneBuilder::GetGeometryHash(const Geometry &geometry) const
+{
+    const auto vertices = std::span(m_Vertices).subspan(geometry.VertexOffset, geometry.VertexLength);
+    const auto indices = std::span(m_Indices).subspan(geometry.IndexOffset, geometry.IndexLength);
+
+    return FNVHash<std::array<size_t, 2>>()({
+        FNVHash<std::span<const std::byte>>()(std::as_bytes(vertices)),
+        FNVHash<std::span<const uint32_t>>()(indices),
+    });
+}
+
+bool SceneBuilder::IsSameGeometry(const Geometry &geometry1, const Geometry &geometry2) const
+{
+    if (geometry1.VertexLength != geometry2.VertexLength || geometry1.IndexLength != geometry2.IndexLength ||
+        geometry1.IsOpaque != geometry2.IsOpaque || geometry1.IsAnimated != geometry2.IsAnimated)
+        return false;
+
+    const bool isSameVertices =
+        std::memcmp(
+            m_Vertices.data() + geometry1.VertexOffset, m_Vertices.data() + geometry2.VertexOffset,
+            geometry1.VertexLength * sizeof(Shaders::Vertex)
+        ) == 0;
+
+    return isSameVertices && std::ranges::equal(
+                                 std::span(m_Indices).subspan(geometry1.IndexOffset, geometry1.IndexLength),
+                                 std::span(m_Indices).subspan(geometry2.IndexOffset, geometry2.IndexLength)
+                             );
+}
+
+std::vector<uint32_t> SceneBuilder::PackIndices(
+    std::span<const uint32_t> indices, std::span<Geometry> geometries, bool isAnimated
+)
+{
+    std::vector<uint32_t> packedIndices;
+    packedIndices.reserve(indices.size());
+
+    for (Geometry &geometry : geometries)
+    {
+        if (geometry.IsAnimated != isAnimated)
+            continue;
+
+        const auto geometryIndices = indices.subspan(geometry.IndexOffset, geometry.IndexLength);
+        geometry.IndexOffset = packedIndices.size();
+        geometry.HasShortIndices = geometry.VertexLength <= MaxShortIndexVertexCount;
+
+        if (!geometry.HasShortIndices)
+        {
+            packedIndices.insert(packedIndices.end(), geometryIndices.begin(), geometryIndices.end());
+            continue;
+        }
+
+        // The first index of a pair goes into the low half, like a little endian uint16_t array
+        for (int i = 0; i < geometryIndices.size(); i += 2)
+        {
+            const uint32_t second = i + 1 < geometryIndices.size() ? geometryIndices[i + 1] : 0;
+            packedIndices.push_back(geometryIndices[i] | second << 16);
+        }
+    }
+
+    packedIndices.shrink_to_fit();
+    return packedIndices;
 }
 
 uint32_t SceneBuilder::AddModel(std::span<const MeshInfo> meshInfos)
@@ -139,6 +317,11 @@ uint32_t SceneBuilder::AddTexture(TextureInfo &&texture)
     return textureIndex;
 }
 
+void SceneBuilder::AddTextureBuffer(std::shared_ptr<const void> &&buffer)
+{
+    m_TextureBuffers.push_back(std::move(buffer));
+}
+
 Shaders::MaterialId SceneBuilder::AddMaterial(std::string name, Shaders::MetallicRoughnessMaterial material)
 {
     if (m_MetallicRoughnessMaterialIds.contains(name))
@@ -287,10 +470,13 @@ std::shared_ptr<Scene> SceneBuilder::CreateSceneShared(const std::string &name)
         hasAnimatedInstances |= isAnimated[sceneNodeIndex];
     }
 
+    std::vector<uint32_t> indices = PackIndices(m_Indices, m_Geometries, false);
+    std::vector<uint32_t> animatedIndices = PackIndices(m_AnimatedIndices, m_Geometries, true);
+
     auto scene = std::make_shared<Scene>(
-        std::move(m_Vertices), std::move(m_AnimatedVertices), std::move(m_Indices),
-        std::move(m_AnimatedIndices), std::move(m_Transforms), std::move(m_Geometries),
-        std::move(m_MetallicRoughnessMaterials), std::move(m_Textures),
+        std::move(m_Vertices), std::move(m_AnimatedVertices), std::move(indices), std::move(animatedIndices),
+        std::move(m_Transforms), std::move(m_Geometries),
+        std::move(m_MetallicRoughnessMaterials), std::move(m_Textures), std::move(m_TextureBuffers),
         std::move(m_SpecularGlossinessMaterials), std::move(m_PhongMaterials), std::move(m_Models),
         std::move(modelInstances), std::move(m_Bones),
         SceneGraph(std::move(m_SceneNodes), std::move(m_IsRelativeTransform), std::move(m_Animations)),
@@ -306,6 +492,7 @@ std::shared_ptr<Scene> SceneBuilder::CreateSceneShared(const std::string &name)
     m_AnimatedIndices.clear();
     m_Transforms = { glm::mat3x4(1.0f) };
     m_Geometries.clear();
+    m_GeometryIndices.clear();
     m_MetallicRoughnessMaterials.clear();
     m_MetallicRoughnessMaterialIds.clear();
     m_SpecularGlossinessMaterials.clear();
@@ -314,11 +501,12 @@ std::shared_ptr<Scene> SceneBuilder::CreateSceneShared(const std::string &name)
     m_PhongMaterialIds.clear();
     m_Textures.clear();
     m_TextureIndices.clear();
+    m_TextureBuffers.clear();
     m_Models.clear();
     m_ModelInstanceInfos.clear();
     m_Bones.clear();
     m_SceneNodes.clear();
-    m_SceneNodes.push_back(SceneNode { RootNodeIndex, glm::mat4(1.0f), glm::mat4(1.0f) });
+    m_SceneNodes.push_back(SceneNode { RootNodeIndex, glm::mat4(1.0f) });
     m_IsRelativeTransform.clear();
     m_IsRelativeTransform.push_back(true);
     m_Animations.clear();
@@ -379,6 +567,11 @@ std::span<const glm::mat3x4> Scene::GetTransforms() const
     return m_Transforms;
 }
 
+std::span<const glm::mat3x4> Scene::GetNormalMatrices() const
+{
+    return m_NormalMatrices;
+}
+
 std::span<const Geometry> Scene::GetGeometries() const
 {
     return m_Geometries;
@@ -419,6 +612,26 @@ std::span<const glm::mat3x4> Scene::GetBoneTransforms() const
     return m_BoneTransforms;
 }
 
+std::span<const glm::mat3x4> Scene::GetBoneNormalMatrices() const
+{
+    return m_BoneNormalMatrices;
+}
+
+uint32_t Scene::GetInstanceTransformsVersion() const
+{
+    return m_InstanceTransformsVersion;
+}
+
+uint32_t Scene::GetBoneTransformsVersion() const
+{
+    return m_BoneTransformsVersion;
+}
+
+std::span<const uint32_t> Scene::GetModelVersions() const
+{
+    return m_ModelVersions;
+}
+
 bool Scene::HasDxNormalTextures() const
 {
     return m_HasDxNormalTextures;
@@ -444,6 +657,11 @@ bool Scene::IsAnimationPaused() const
     return m_IsAnimationPaused;
 }
 
+float Scene::GetAnimationTime() const
+{
+    return m_AnimationSeekTime.value_or(m_Graph.GetTime());
+}
+
 std::span<const Shaders::PointLight> Scene::GetPointLights() const
 {
     return m_PointLights;
@@ -496,6 +714,11 @@ void Scene::ToggleAnimationPause()
     m_IsAnimationPaused = !m_IsAnimationPaused;
 }
 
+void Scene::SeekAnimations(float time)
+{
+    m_AnimationSeekTime = time;
+}
+
 uint32_t Scene::GetDefaultTextureIndex(TextureType type)
 {
     switch (type)
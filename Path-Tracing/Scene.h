@@ -4,6 +4,8 @@
 
 #include <array>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <unordered_map>
@@ -68,6 +70,8 @@ struct Geometry
     uint32_t IndexLength;
     bool IsOpaque;
     bool IsAnimated;
+    // Set when the scene is created, short indices are packed two per word and IndexOffset counts words
+    bool HasShortIndices = false;
 };
 
 enum class MaterialType : uint8_t
@@ -165,7 +169,7 @@ public:
         std::vector<uint32_t> &&indices, std::vector<uint32_t> &&animatedIndices,
         std::vector<glm::mat3x4> &&transforms, std::vector<Geometry> &&geometries,
         std::vector<Shaders::MetallicRoughnessMaterial> &&metallicRoughnessMaterials,
-        std::vector<TextureInfo> &&textures,
+        std::vector<TextureInfo> &&textures, std::vector<std::shared_ptr<const void>> &&textureBuffers,
         std::vector<Shaders::SpecularGlossinessMaterial> &&specularGlossinessMaterials,
         std::vector<Shaders::PhongMaterial> &&phongMaterials, std::vector<Model> &&models,
         std::vector<ModelInstance> &&modelInstances, std::vector<Bone> &&bones, SceneGraph &&sceneGraph,
@@ -184,6 +188,7 @@ public:
     [[nodiscard]] std::span<const uint32_t> GetIndices() const;
     [[nodiscard]] std::span<const uint32_t> GetAnimatedIndices() const;
     [[nodiscard]] std::span<const glm::mat3x4> GetTransforms() const;
+    [[nodiscard]] std::span<const glm::mat3x4> GetNormalMatrices() const;
     [[nodiscard]] std::span<const Geometry> GetGeometries() const;
     [[nodiscard]] std::span<const Shaders::MetallicRoughnessMaterial> GetMetallicRoughnessMaterials() const;
     [[nodiscard]] std::span<const Shaders::SpecularGlossinessMaterial> GetSpecularGlossinessMaterials() const;
@@ -194,10 +199,17 @@ public:
     [[nodiscard]] std::span<const ModelInstance> GetModelInstances() const;
 
     [[nodiscard]] std::span<const glm::mat3x4> GetBoneTransforms() const;
+    [[nodiscard]] std::span<const glm::mat3x4> GetBoneNormalMatrices() const;
+
+    // Versions are incremented on every change, consumers compare them with the last version they saw
+    [[nodiscard]] uint32_t GetInstanceTransformsVersion() const;
+    [[nodiscard]] uint32_t GetBoneTransformsVersion() const;
+    [[nodiscard]] std::span<const uint32_t> GetModelVersions() const;
 
     [[nodiscard]] bool HasAnimations() const;
     [[nodiscard]] bool HasSkeletalAnimations() const;
     [[nodiscard]] bool IsAnimationPaused() const;
+    [[nodiscard]] float GetAnimationTime() const;
     [[nodiscard]] bool HasDxNormalTextures() const;
     [[nodiscard]] bool GetForceFullTextureSize() const;
 
@@ -212,6 +224,8 @@ public:
     void SetActiveCamera(CameraId id);
 
     void ToggleAnimationPause();
+    // Animations jump to the time in seconds on the next update, even when they are paused
+    void SeekAnimations(float time);
 
     inline static const CameraId g_InputCameraId = -1;
 
@@ -224,6 +238,7 @@ private:
     std::vector<Shaders::Vertex> m_Vertices;
     std::vector<uint32_t> m_Indices;
     std::vector<glm::mat3x4> m_Transforms;
+    std::vector<glm::mat3x4> m_NormalMatrices;
 
     std::vector<Shaders::AnimatedVertex> m_AnimatedVertices;
     std::vector<uint32_t> m_AnimatedIndices;
@@ -235,6 +250,7 @@ private:
     std::vector<Shaders::PhongMaterial> m_PhongMaterials;
 
     std::vector<TextureInfo> m_Textures;
+    std::vector<std::shared_ptr<const void>> m_TextureBuffers;  // Own the data of MemoryTextureSources
 
     const bool m_HasDxNormalTextures = false;
     const bool m_ForceFullTextureSize = false;
@@ -244,6 +260,12 @@ private:
 
     std::vector<Bone> m_Bones;
     std::vector<glm::mat3x4> m_BoneTransforms;
+    std::vector<glm::mat3x4> m_BoneNormalMatrices;
+    std::vector<std::vector<uint32_t>> m_ModelBones;
+
+    uint32_t m_InstanceTransformsVersion = 0;
+    uint32_t m_BoneTransformsVersion = 0;
+    std::vector<uint32_t> m_ModelVersions;
 
     SceneGraph m_Graph;
     bool m_HasSkeletalAnimations = false;
@@ -263,6 +285,13 @@ private:
     bool m_HasCameraChanged = true;
 
     bool m_IsAnimationPaused = false;
+    std::optional<float> m_AnimationSeekTime;
+
+private:
+    void UpdateNodeDependents(bool updateAll);
+
+    // Inverse transpose of the transform, so shaders transform normals without inverting matrices
+    [[nodiscard]] static glm::mat3x4 GetNormalMatrix(const glm::mat3x4 &transform);
 };
 
 class SceneBuilder
@@ -272,11 +301,15 @@ public:
     uint32_t AddSceneNode(SceneNode &&node);
     void AddAnimation(Animation &&animation);
 
-    uint32_t AddGeometry(Geometry &&geometry);
+    /* Static geometries with the same content as an already added one are merged into it */
+    /* In that case isDuplicate is set and the caller can reuse the vertex and index ranges */
+    uint32_t AddGeometry(Geometry &&geometry, bool *isDuplicate = nullptr);
     uint32_t AddModel(std::span<const MeshInfo> meshInfos);
     uint32_t AddModelInstance(uint32_t modelIndex, uint32_t sceneNodeIndex);
 
     uint32_t AddTexture(TextureInfo &&texture);
+    /* Keeps the memory referenced by MemoryTextureSources alive for as long as the Scene exists */
+    void AddTextureBuffer(std::shared_ptr<const void> &&buffer);
     Shaders::MaterialId AddMaterial(std::string name, Shaders::MetallicRoughnessMaterial material);
     Shaders::MaterialId AddMaterial(std::string name, Shaders::SpecularGlossinessMaterial material);
     Shaders::MaterialId AddMaterial(std::string name, Shaders::PhongMaterial material);
@@ -305,6 +338,7 @@ public:
 public:
     static inline constexpr uint32_t IdentityTransformIndex = 0;
     static inline constexpr uint32_t RootNodeIndex = 0;
+    static inline constexpr uint32_t MaxShortIndexVertexCount = 1u << 16;
 
 private:
     std::vector<Shaders::Vertex> m_Vertices;
@@ -315,6 +349,7 @@ private:
     std::vector<uint32_t> m_AnimatedIndices;
 
     std::vector<Geometry> m_Geometries;
+    std::unordered_multimap<size_t, uint32_t> m_GeometryIndices;
 
     std::vector<Shaders::MetallicRoughnessMaterial> m_MetallicRoughnessMaterials;
     std::unordered_map<std::string, uint32_t> m_MetallicRoughnessMaterialIds;
@@ -327,13 +362,14 @@ private:
 
     std::vector<TextureInfo> m_Textures;
     std::unordered_map<std::string, uint32_t> m_TextureIndices;
+    std::vector<std::shared_ptr<const void>> m_TextureBuffers;
     bool m_HasDxNormalTextures = false;
     bool m_ForceFullTextureSize = false;
 
     std::vector<Model> m_Models;
     std::vector<std::pair<uint32_t, uint32_t>> m_ModelInstanceInfos;
 
-    std::vector<SceneNode> m_SceneNodes = { SceneNode { RootNodeIndex, glm::mat4(1.0f), glm::mat4(1.0f) } };
+    std::vector<SceneNode> m_SceneNodes = { SceneNode { RootNodeIndex, glm::mat4(1.0f) } };
     std::vector<bool> m_IsRelativeTransform = { true };
     std::vector<Animation> m_Animations;
 
@@ -357,7 +393,16 @@ private:
 private:
     uint32_t m_MeshOffset = 0;
 
+    friend class SceneCache;
+
     Model CreateModel(std::span<const MeshInfo> meshInfos);
+
+    [[nodiscard]] size_t GetGeometryHash(const Geometry &geometry) const;
+    [[nodiscard]] bool IsSameGeometry(const Geometry &geometry1, const Geometry &geometry2) const;
+
+    static std::vector<uint32_t> PackIndices(
+        std::span<const uint32_t> indices, std::span<Geometry> geometries, bool isAnimated
+    );
 };
 
 }
@@ -0,0 +1,571 @@
+#include <algorithm>
+#include <fstream>
+
+#include "Core/Cache.h"
+#include "Core/Core.h"
+
+#include "Application.h"
+#include "SceneCache.h"
+
+namespace PathTracing
+{
+
+namespace
+{
+
+constexpr uint32_t Magic = 0x43535450;  // "PTSC"
+constexpr uint32_t Version = 5;
+
+struct Dependency
+{
+    std::string Path;
+    uint64_t Size;
+    int64_t ModificationTime;
+    size_t Hash;
+};
+
+std::string GetAbsolutePath(const std::filesystem::path &path)
+{
+    return std::filesystem::absolute(path).lexically_normal().generic_string();
+}
+
+bool IsUpToDate(const Dependency &dependency)
+{
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(dependency.Path, error) ||
+        std::filesystem::file_size(dependency.Path, error) != dependency.Size)
+        return false;
+
+    const int64_t modificationTime = GetModificationTime(dependency.Path, error);
+    if (error)
+        return false;
+    if (modificationTime == dependency.ModificationTime)
+        return true;
+
+    // Files touched without changing the content (e.g. by a checkout) don't invalidate the cache
+    return HashFile(dependency.Path) == dependency.Hash;
+}
+
+}
+
+// Every section is a length followed by tightly packed data, so it can be read with a single call
+class SceneCache::Writer
+{
+public:
+    explicit Writer(std::ofstream &file) : m_File(file)
+    {
+    }
+
+    template<typename T> void WriteValue(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        m_File.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T> void WriteArray(std::span<const T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteValue<uint64_t>(values.size());
+        m_File.write(reinterpret_cast<const char *>(values.data()), values.size_bytes());
+    }
+
+    void WriteString(const std::string &value)
+    {
+        WriteArray(std::span(value.data(), value.size()));
+    }
+
+    void WriteMap(const std::unordered_map<std::string, uint32_t> &map)
+    {
+        WriteValue<uint64_t>(map.size());
+        for (const auto &[key, value] : map)
+        {
+            WriteString(key);
+            WriteValue(value);
+        }
+    }
+
+private:
+    std::ofstream &m_File;
+};
+
+class SceneCache::Reader
+{
+public:
+    explicit Reader(std::ifstream &file) : m_File(file)
+    {
+        m_File.seekg(0, std::ios::end);
+        m_Size = m_File.tellg();
+        m_File.seekg(0);
+    }
+
+    [[nodiscard]] bool IsValid() const
+    {
+        return m_File.good();
+    }
+
+    template<typename T> [[nodiscard]] T ReadValue()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value = {};
+        m_File.read(reinterpret_cast<char *>(&value), sizeof(T));
+        return value;
+    }
+
+    template<typename T> void ReadArray(std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const uint64_t count = ReadLength(sizeof(T));
+        values.resize(count);
+        m_File.read(reinterpret_cast<char *>(values.data()), count * sizeof(T));
+    }
+
+    [[nodiscard]] std::string ReadString()
+    {
+        std::string value(ReadLength(sizeof(char)), '\0');
+        m_File.read(value.data(), value.size());
+        return value;
+    }
+
+    void ReadMap(std::unordered_map<std::string, uint32_t> &map)
+    {
+        const uint64_t count = ReadLength(sizeof(uint64_t) + sizeof(uint32_t));
+        for (uint64_t i = 0; i < count && IsValid(); i++)
+        {
+            std::string key = ReadString();
+            map[std::move(key)] = ReadValue<uint32_t>();
+        }
+    }
+
+    // Lengths are checked against the rest of the file, so a corrupted one can't cause a huge allocation
+    [[nodiscard]] uint64_t ReadLength(size_t elementSize)
+    {
+        const uint64_t length = ReadValue<uint64_t>();
+        const uint64_t remaining = IsValid() ? m_Size - static_cast<uint64_t>(m_File.tellg()) : 0;
+        if (length > remaining / elementSize)
+        {
+            m_File.setstate(std::ios::failbit);
+            return 0;
+        }
+
+        return length;
+    }
+
+private:
+    std::ifstream &m_File;
+    uint64_t m_Size = 0;
+};
+
+bool SceneCache::Load(
+    SceneBuilder &sceneBuilder, std::span<const std::filesystem::path> paths, TextureMapping mapping
+)
+{
+    if (!Application::GetConfig().CacheScenes)
+        return false;
+
+    const std::filesystem::path cachePath = GetCachePath(paths, mapping);
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    Timer timer("Scene Cache Load");
+    Reader reader(file);
+
+    if (reader.ReadValue<uint32_t>() != Magic || reader.ReadValue<uint32_t>() != Version)
+    {
+        logger::debug("Scene cache file {} has an unsupported format", cachePath.string());
+        return false;
+    }
+
+    // Guard against collisions of the file name hash
+    if (reader.ReadLength(sizeof(uint64_t)) != paths.size())
+        return false;
+    for (const auto &path : paths)
+        if (reader.ReadString() != GetAbsolutePath(path))
+            return false;
+
+    const uint64_t dependencyCount = reader.ReadLength(sizeof(uint64_t));
+    for (uint64_t i = 0; i < dependencyCount; i++)
+    {
+        Dependency dependency = { .Path = reader.ReadString() };
+        dependency.Size = reader.ReadValue<uint64_t>();
+        dependency.ModificationTime = reader.ReadValue<int64_t>();
+        dependency.Hash = reader.ReadValue<size_t>();
+
+        if (!reader.IsValid() || !IsUpToDate(dependency))
+        {
+            logger::info("Scene cache is out of date, {} changed", dependency.Path);
+            return false;
+        }
+    }
+
+    // A corrupted file must leave the builder untouched
+    SceneBuilder cachedSceneBuilder;
+    ReadScene(reader, cachedSceneBuilder);
+
+    if (!reader.IsValid())
+    {
+        logger::warn("Scene cache file {} is corrupted", cachePath.string());
+        return false;
+    }
+
+    sceneBuilder = std::move(cachedSceneBuilder);
+
+    Application::ResetBackgroundTask(BackgroundTaskType::SceneImport);
+    logger::info("Loaded Scene from cache {}", cachePath.string());
+
+    return true;
+}
+
+void SceneCache::Save(
+    const SceneBuilder &sceneBuilder, std::span<const std::filesystem::path> paths, TextureMapping mapping,
+    std::span<const std::filesystem::path> dependencies
+)
+{
+    if (!Application::GetConfig().CacheScenes)
+        return;
+
+    // Textures embedded in the scene files live in memory and can't be referenced by the cache
+    std::vector<std::filesystem::path> allDependencies(dependencies.begin(), dependencies.end());
+    for (const TextureInfo &texture : sceneBuilder.m_Textures)
+    {
+        if (!std::holds_alternative<FileTextureSource>(texture.Source))
+        {
+            logger::debug("Scene with embedded textures is not cached");
+            return;
+        }
+
+        allDependencies.push_back(std::get<FileTextureSource>(texture.Source));
+    }
+
+    // Failing to write the cache only costs the next load its speed, so errors skip the cache
+    const std::filesystem::path &sceneCachePath = Application::GetConfig().SceneCachePath;
+    std::error_code error;
+    if (!std::filesystem::is_directory(sceneCachePath, error))
+    {
+        std::filesystem::remove(sceneCachePath, error);
+        std::filesystem::create_directory(sceneCachePath, error);
+        if (error)
+        {
+            logger::warn(
+                "Could not create scene cache directory {}: {}", sceneCachePath.string(), error.message()
+            );
+            return;
+        }
+    }
+
+    Timer timer("Scene Cache Save");
+
+    std::vector<std::string> dependencyPaths = {};
+    for (const auto &path : allDependencies)
+        if (std::filesystem::is_regular_file(path, error))
+            dependencyPaths.push_back(GetAbsolutePath(path));
+
+    std::ranges::sort(dependencyPaths);
+    const auto [first, last] = std::ranges::unique(dependencyPaths);
+    dependencyPaths.erase(first, last);
+
+    std::vector<Dependency> dependencyInfos = {};
+    dependencyInfos.reserve(dependencyPaths.size());
+    for (auto &path : dependencyPaths)
+    {
+        Dependency dependency = { .Path = std::move(path) };
+        dependency.Size = std::filesystem::file_size(dependency.Path, error);
+        if (!error)
+            dependency.ModificationTime = GetModificationTime(dependency.Path, error);
+
+        if (error)
+        {
+            logger::warn("Scene is not cached, could not read {}: {}", dependency.Path, error.message());
+            return;
+        }
+
+        dependency.Hash = HashFile(dependency.Path);
+        dependencyInfos.push_back(std::move(dependency));
+    }
+
+    // The file is renamed into place once written, so an interrupted write never leaves a partial file
+    const std::filesystem::path cachePath = GetCachePath(paths, mapping);
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open())
+        {
+            logger::warn("Could not write scene cache file {}", cachePath.string());
+            return;
+        }
+
+        Writer writer(file);
+        writer.WriteValue(Magic);
+        writer.WriteValue(Version);
+
+        writer.WriteValue<uint64_t>(paths.size());
+        for (const auto &path : paths)
+            writer.WriteString(GetAbsolutePath(path));
+
+        writer.WriteValue<uint64_t>(dependencyInfos.size());
+        for (const Dependency &dependency : dependencyInfos)
+        {
+            writer.WriteString(dependency.Path);
+            writer.WriteValue<uint64_t>(dependency.Size);
+            writer.WriteValue<int64_t>(dependency.ModificationTime);
+            writer.WriteValue<size_t>(dependency.Hash);
+        }
+
+        WriteScene(writer, sceneBuilder);
+        file.close();
+
+        if (!file.good())
+        {
+            logger::warn("Could not write scene cache file {}", cachePath.string());
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        logger::warn("Could not write scene cache file {}: {}", cachePath.string(), error.message());
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    logger::info("Saved Scene to cache {}", cachePath.string());
+}
+
+std::filesystem::path SceneCache::GetCachePath(
+    std::span<const std::filesystem::path> paths, TextureMapping mapping
+)
+{
+    const auto &config = Application::GetConfig();
+
+    // The vertex layouts are part of the key, so changing them invalidates the old files
+    // So are the texture options, since they decide the loaders and formats of the texture infos
+    std::vector<size_t> hashes = {
+        mapping.index(),
+        sizeof(Shaders::Vertex),
+        sizeof(Shaders::AnimatedVertex),
+        config.CacheTextures,
+        config.CompressTextures,
+    };
+#ifdef CONFIG_OPTIMIZE_SCENE
+    hashes.push_back(1);
+#endif
+
+    std::visit(
+        [&hashes](const auto &textureMapping) {
+            if constexpr (!std::is_same_v<std::decay_t<decltype(textureMapping)>, std::monostate>)
+            {
+                const auto bytes = std::as_bytes(std::span(&textureMapping, 1));
+                hashes.push_back(FNVHash<decltype(bytes)>()(bytes));
+            }
+        },
+        mapping
+    );
+
+    for (const auto &path : paths)
+        hashes.push_back(FNVHash<std::string>()(GetAbsolutePath(path)));
+
+    return config.SceneCachePath / std::format(
+                                       "{:016x}.{}", FNVHash<std::vector<size_t>>()(hashes),
+                                       config.SceneCacheExtension.string()
+                                   );
+}
+
+void SceneCache::WriteScene(Writer &writer, const SceneBuilder &sceneBuilder)
+{
+    writer.WriteArray<Shaders::Vertex>(sceneBuilder.m_Vertices);
+    writer.WriteArray<uint32_t>(sceneBuilder.m_Indices);
+    writer.WriteArray<glm::mat3x4>(sceneBuilder.m_Transforms);
+    writer.WriteArray<Shaders::AnimatedVertex>(sceneBuilder.m_AnimatedVertices);
+    writer.WriteArray<uint32_t>(sceneBuilder.m_AnimatedIndices);
+
+    writer.WriteArray<Geometry>(sceneBuilder.m_Geometries);
+    writer.WriteValue<uint64_t>(sceneBuilder.m_GeometryIndices.size());
+    for (const auto [hash, geometryIndex] : sceneBuilder.m_GeometryIndices)
+    {
+        writer.WriteValue(hash);
+        writer.WriteValue(geometryIndex);
+    }
+
+    writer.WriteArray<Shaders::MetallicRoughnessMaterial>(sceneBuilder.m_MetallicRoughnessMaterials);
+    writer.WriteMap(sceneBuilder.m_MetallicRoughnessMaterialIds);
+    writer.WriteArray<Shaders::SpecularGlossinessMaterial>(sceneBuilder.m_SpecularGlossinessMaterials);
+    writer.WriteMap(sceneBuilder.m_SpecularGlossinessMaterialIds);
+    writer.WriteArray<Shaders::PhongMaterial>(sceneBuilder.m_PhongMaterials);
+    writer.WriteMap(sceneBuilder.m_PhongMaterialIds);
+
+    writer.WriteValue<uint64_t>(sceneBuilder.m_Textures.size());
+    for (const TextureInfo &texture : sceneBuilder.m_Textures)
+    {
+        writer.WriteValue(texture.Type);
+        writer.WriteValue(texture.Format);
+        writer.WriteValue(texture.Loader);
+        writer.WriteValue(texture.Levels);
+        writer.WriteValue(texture.Width);
+        writer.WriteValue(texture.Height);
+        writer.WriteString(texture.Name);
+        writer.WriteString(std::get<FileTextureSource>(texture.Source).string());
+    }
+    writer.WriteMap(sceneBuilder.m_TextureIndices);
+
+    writer.WriteValue<uint64_t>(sceneBuilder.m_Models.size());
+    for (const Model &model : sceneBuilder.m_Models)
+    {
+        writer.WriteArray<Mesh>(model.Meshes);
+        writer.WriteValue(model.MeshOffset);
+    }
+    writer.WriteValue(sceneBuilder.m_MeshOffset);
+
+    writer.WriteValue<uint64_t>(sceneBuilder.m_ModelInstanceInfos.size());
+    for (const auto [modelIndex, sceneNodeIndex] : sceneBuilder.m_ModelInstanceInfos)
+    {
+        writer.WriteValue(modelIndex);
+        writer.WriteValue(sceneNodeIndex);
+    }
+
+    writer.WriteValue<uint64_t>(sceneBuilder.m_SceneNodes.size());
+    for (const SceneNode &node : sceneBuilder.m_SceneNodes)
+    {
+        writer.WriteValue(node.Parent);
+        writer.WriteValue(node.Transform);
+    }
+    const std::vector<uint8_t> isRelativeTransform(
+        sceneBuilder.m_IsRelativeTransform.begin(), sceneBuilder.m_IsRelativeTransform.end()
+    );
+    writer.WriteArray<uint8_t>(isRelativeTransform);
+
+    writer.WriteValue<uint64_t>(sceneBuilder.m_Animations.size());
+    for (const Animation &animation : sceneBuilder.m_Animations)
+    {
+        writer.WriteValue(animation.TickPerSecond);
+        writer.WriteValue(animation.Duration);
+        writer.WriteValue<uint64_t>(animation.Nodes.size());
+        for (const AnimationNode &node : animation.Nodes)
+        {
+            writer.WriteValue(node.SceneNodeIndex);
+            writer.WriteArray<float>(node.Positions.Ticks);
+            writer.WriteArray<glm::vec3>(node.Positions.Values);
+            writer.WriteArray<float>(node.Rotations.Ticks);
+            writer.WriteArray<glm::quat>(node.Rotations.Values);
+            writer.WriteArray<float>(node.Scales.Ticks);
+            writer.WriteArray<glm::vec3>(node.Scales.Values);
+        }
+    }
+
+    writer.WriteArray<Bone>(sceneBuilder.m_Bones);
+
+    writer.WriteArray<LightInfo>(sceneBuilder.m_LightInfos);
+    writer.WriteArray<Shaders::PointLight>(sceneBuilder.m_PointLights);
+    writer.WriteValue(sceneBuilder.m_DirectionalLightInfo);
+    writer.WriteValue(sceneBuilder.m_DirectionalLight);
+
+    writer.WriteArray<CameraInfo>(sceneBuilder.m_CameraInfos);
+}
+
+void SceneCache::ReadScene(Reader &reader, SceneBuilder &sceneBuilder)
+{
+    reader.ReadArray(sceneBuilder.m_Vertices);
+    reader.ReadArray(sceneBuilder.m_Indices);
+    reader.ReadArray(sceneBuilder.m_Transforms);
+    reader.ReadArray(sceneBuilder.m_AnimatedVertices);
+    reader.ReadArray(sceneBuilder.m_AnimatedIndices);
+
+    reader.ReadArray(sceneBuilder.m_Geometries);
+    const uint64_t geometryIndexCount = reader.ReadLength(sizeof(size_t) + sizeof(uint32_t));
+    for (uint64_t i = 0; i < geometryIndexCount; i++)
+    {
+        const size_t hash = reader.ReadValue<size_t>();
+        sceneBuilder.m_GeometryIndices.emplace(hash, reader.ReadValue<uint32_t>());
+    }
+
+    reader.ReadArray(sceneBuilder.m_MetallicRoughnessMaterials);
+    reader.ReadMap(sceneBuilder.m_MetallicRoughnessMaterialIds);
+    reader.ReadArray(sceneBuilder.m_SpecularGlossinessMaterials);
+    reader.ReadMap(sceneBuilder.m_SpecularGlossinessMaterialIds);
+    reader.ReadArray(sceneBuilder.m_PhongMaterials);
+    reader.ReadMap(sceneBuilder.m_PhongMaterialIds);
+
+    const uint64_t textureCount = reader.ReadLength(sizeof(TextureInfo::LoaderType));
+    for (uint64_t i = 0; i < textureCount && reader.IsValid(); i++)
+    {
+        TextureInfo &texture = sceneBuilder.m_Textures.emplace_back();
+        texture.Type = reader.ReadValue<TextureType>();
+        texture.Format = reader.ReadValue<TextureFormat>();
+        texture.Loader = reader.ReadValue<TextureInfo::LoaderType>();
+        texture.Levels = reader.ReadValue<uint32_t>();
+        texture.Width = reader.ReadValue<uint32_t>();
+        texture.Height = reader.ReadValue<uint32_t>();
+        texture.Name = reader.ReadString();
+        texture.Source = FileTextureSource(reader.ReadString());
+    }
+    reader.ReadMap(sceneBuilder.m_TextureIndices);
+
+    const uint64_t modelCount = reader.ReadLength(sizeof(uint64_t));
+    for (uint64_t i = 0; i < modelCount && reader.IsValid(); i++)
+    {
+        Model &model = sceneBuilder.m_Models.emplace_back();
+        reader.ReadArray(model.Meshes);
+        model.MeshOffset = reader.ReadValue<uint32_t>();
+    }
+    sceneBuilder.m_MeshOffset = reader.ReadValue<uint32_t>();
+
+    const uint64_t modelInstanceCount = reader.ReadLength(2 * sizeof(uint32_t));
+    for (uint64_t i = 0; i < modelInstanceCount; i++)
+    {
+        const uint32_t modelIndex = reader.ReadValue<uint32_t>();
+        sceneBuilder.m_ModelInstanceInfos.emplace_back(modelIndex, reader.ReadValue<uint32_t>());
+    }
+
+    // Scene nodes have a const parent, so they can't be read in place
+    const uint64_t sceneNodeCount = reader.ReadLength(sizeof(uint32_t) + sizeof(glm::mat4));
+    sceneBuilder.m_SceneNodes.clear();
+    for (uint64_t i = 0; i < sceneNodeCount; i++)
+    {
+        const uint32_t parent = reader.ReadValue<uint32_t>();
+        const glm::mat4 transform = reader.ReadValue<glm::mat4>();
+        sceneBuilder.m_SceneNodes.push_back(SceneNode { parent, transform });
+    }
+
+    std::vector<uint8_t> isRelativeTransform = {};
+    reader.ReadArray(isRelativeTransform);
+    sceneBuilder.m_IsRelativeTransform.assign(isRelativeTransform.begin(), isRelativeTransform.end());
+
+    const uint64_t animationCount = reader.ReadLength(2 * sizeof(float) + sizeof(uint64_t));
+    for (uint64_t i = 0; i < animationCount && reader.IsValid(); i++)
+    {
+        const float tickPerSecond = reader.ReadValue<float>();
+        const float duration = reader.ReadValue<float>();
+
+        std::vector<AnimationNode> nodes(reader.ReadLength(sizeof(uint32_t) + 6 * sizeof(uint64_t)));
+        for (AnimationNode &node : nodes)
+        {
+            node.SceneNodeIndex = reader.ReadValue<uint32_t>();
+            reader.ReadArray(node.Positions.Ticks);
+            reader.ReadArray(node.Positions.Values);
+            reader.ReadArray(node.Rotations.Ticks);
+            reader.ReadArray(node.Rotations.Values);
+            reader.ReadArray(node.Scales.Ticks);
+            reader.ReadArray(node.Scales.Values);
+        }
+
+        sceneBuilder.m_Animations.push_back(Animation {
+            .Nodes = std::move(nodes),
+            .TickPerSecond = tickPerSecond,
+            .Duration = duration,
+        });
+    }
+
+    reader.ReadArray(sceneBuilder.m_Bones);
+
+    reader.ReadArray(sceneBuilder.m_LightInfos);
+    reader.ReadArray(sceneBuilder.m_PointLights);
+    sceneBuilder.m_DirectionalLightInfo = reader.ReadValue<DirectionalLightInfo>();
+    sceneBuilder.m_DirectionalLight = reader.ReadValue<Shaders::DirectionalLight>();
+
+    reader.ReadArray(sceneBuilder.m_CameraInfos);
+}
+
+}
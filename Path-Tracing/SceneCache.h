@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+
+#include "Scene.h"
+#include "SceneImporter.h"
+
+namespace PathTracing
+{
+
+// Binary snapshot of the SceneBuilder after importing scene files, so reloading skips Assimp
+// The snapshot is invalidated when any file read during the import changes
+class SceneCache
+{
+public:
+    static bool Load(
+        SceneBuilder &sceneBuilder, std::span<const std::filesystem::path> paths, TextureMapping mapping
+    );
+
+    static void Save(
+        const SceneBuilder &sceneBuilder, std::span<const std::filesystem::path> paths,
+        TextureMapping mapping, std::span<const std::filesystem::path> dependencies
+    );
+
+private:
+    class Writer;
+    class Reader;
+
+private:
+    static std::filesystem::path GetCachePath(
+        std::span<const std::filesystem::path> paths, TextureMapping mapping
+    );
+
+    static void WriteScene(Writer &writer, const SceneBuilder &sceneBuilder);
+    static void ReadScene(Reader &reader, SceneBuilder &sceneBuilder);
+};
+
+}
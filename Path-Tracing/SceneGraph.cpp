@@ -1,99 +1,240 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
 #include "Core/Config.h"
+#include "Core/Threads.h"
 
 #include "SceneGraph.h"
 
 namespace PathTracing
 {
 
-void Animation::Update(float timeStep, std::span<SceneNode> nodes)
+void Animation::Update(float timeStep, std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty)
 {
-    CurrentTick += timeStep * TickPerSecond;
-    if (CurrentTick >= Duration)
-    {
-        for (AnimationNode &node : Nodes)
-        {
-            node.Positions.Index = 0;
-            node.Rotations.Index = 0;
-            node.Scales.Index = 0;
-        }
-    }
+    CurrentTick = std::fmod(CurrentTick + timeStep * TickPerSecond, Duration);
+    Sample(transforms, isDirty);
+}
+
+void Animation::Seek(float time, std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty)
+{
+    CurrentTick = std::fmod(time * TickPerSecond, Duration);
+    if (CurrentTick < 0.0f)
+        CurrentTick += Duration;
 
-    while (CurrentTick >= Duration)
-        CurrentTick -= Duration;
+    Sample(transforms, isDirty);
+}
 
+void Animation::Sample(std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty)
+{
     for (AnimationNode &node : Nodes)
     {
-        glm::vec3 position = node.Positions.Update(CurrentTick);
-        glm::quat rotation = node.Rotations.Update(CurrentTick);
-        glm::vec3 scale = node.Scales.Update(CurrentTick);
+        glm::vec3 position = node.Positions.Sample(CurrentTick);
+        glm::quat rotation = node.Rotations.Sample(CurrentTick);
+        glm::vec3 scale = node.Scales.Sample(CurrentTick);
 
-        nodes[node.SceneNodeIndex].Transform =
+        const glm::mat3x4 transform =
             glm::transpose(glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4(rotation), scale)
             );
+
+        if (transforms[node.SceneNodeIndex] == transform)
+            continue;
+
+        transforms[node.SceneNodeIndex] = transform;
+        isDirty[node.SceneNodeIndex] = true;
     }
 }
 
-void SceneGraph::UpdateTransforms()
+bool SceneGraph::UpdateNode(uint32_t nodeIndex)
 {
-#ifdef CONFIG_ASSERTS
-    std::vector<bool> isUpdated(m_SceneNodes.size());
-    isUpdated[0] = true;
-#endif
+    const uint32_t parent = m_Parents[nodeIndex];
+    const bool isRelative = m_IsRelativeTransform[nodeIndex] && nodeIndex != parent;
+    const bool hasParentChanged = isRelative && m_ChangedUpdateIndices[parent] == m_UpdateIndex;
+
+    if (!m_IsDirty[nodeIndex] && !hasParentChanged)
+        return false;
+    m_IsDirty[nodeIndex] = false;
 
-    m_SceneNodes[0].CurrentTransform = m_SceneNodes[0].Transform;
+    // Transforms are affine, so the implicit last column is (0, 0, 0, 1)
+    const glm::mat3x4 transform =
+        isRelative ? glm::mat3x4(glm::mat4(m_LocalTransforms[nodeIndex]) * glm::mat4(m_Transforms[parent]))
+                   : m_LocalTransforms[nodeIndex];
 
-    for (int i = 1; i < m_SceneNodes.size(); i++)
+    if (m_Transforms[nodeIndex] == transform)
+        return false;
+
+    m_Transforms[nodeIndex] = transform;
+    m_ChangedUpdateIndices[nodeIndex] = m_UpdateIndex;
+    return true;
+}
+
+bool SceneGraph::UpdateRange(uint32_t begin, uint32_t end)
+{
+    bool isAnyChanged = false;
+    for (uint32_t i = begin; i < end; i++)
+        isAnyChanged |= UpdateNode(i);
+
+    return isAnyChanged;
+}
+
+bool SceneGraph::UpdateLevels()
+{
+    std::atomic<bool> isAnyChanged = false;
+
+    for (int level = 0; level + 1 < m_LevelOffsets.size(); level++)
     {
-        SceneNode &node = m_SceneNodes[i];
-        SceneNode &parent = m_SceneNodes[node.Parent];
-        assert(isUpdated[node.Parent] == true);  // Nodes are not in pre-order sequence
-        assert(isUpdated[i] == false);  // Two animations have the same SceneNode or it's a DAG not a tree
-
-        if (m_IsRelativeTransform[i])
-            node.CurrentTransform = node.Transform * parent.CurrentTransform;
-        else
-            node.CurrentTransform = node.Transform;
-#ifdef CONFIG_ASSERTS
-        isUpdated[i] = true;
-#endif
+        const uint32_t levelOffset = m_LevelOffsets[level];
+        const uint32_t levelSize = m_LevelOffsets[level + 1] - levelOffset;
+
+        auto updateChunk = [this, levelOffset, levelSize, &isAnyChanged](uint32_t chunk) {
+            const uint32_t begin = chunk * ParallelUpdateChunkSize;
+            const uint32_t end = std::min(begin + ParallelUpdateChunkSize, levelSize);
+
+            bool isChanged = false;
+            for (uint32_t i = begin; i < end; i++)
+                isChanged |= UpdateNode(m_LevelNodes[levelOffset + i]);
+
+            if (isChanged)
+                isAnyChanged = true;
+        };
+
+        const uint32_t chunkCount = (levelSize + ParallelUpdateChunkSize - 1) / ParallelUpdateChunkSize;
+        if (levelSize < ParallelUpdateMinNodeCount)
+        {
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+                updateChunk(chunk);
+            continue;
+        }
+
+        // Workers are kept between updates, starting threads for every level would cost more than the level
+        if (m_UpdatePool == nullptr)
+        {
+            const uint32_t threadCount =
+                std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1u, MaxUpdateThreadCount);
+            m_UpdatePool = std::make_unique<WorkerPool>(threadCount - 1);
+        }
+
+        // Nodes only read transforms of their parents, which were all updated with the previous level
+        m_UpdatePool->DispatchBlocking(chunkCount, updateChunk);
     }
+
+    return isAnyChanged;
 }
 
 SceneGraph::SceneGraph(
     std::vector<SceneNode> &&sceneNodes, std::vector<bool> &&isRelativeTransform,
     std::vector<Animation> &&animations
 )
-    : m_SceneNodes(std::move(sceneNodes)), m_IsRelativeTransform(std::move(isRelativeTransform)),
+    : m_Parents(sceneNodes.size()), m_SubtreeEnds(sceneNodes.size()),
+      m_IsRelativeTransform(isRelativeTransform.begin(), isRelativeTransform.end()),
+      m_LocalTransforms(sceneNodes.size()), m_Transforms(sceneNodes.size(), glm::mat3x4(1.0f)),
+      m_IsDirty(sceneNodes.size(), true), m_ChangedUpdateIndices(sceneNodes.size(), 0),
       m_Animations(std::move(animations))
 {
+    const uint32_t nodeCount = sceneNodes.size();
+
+    std::vector<uint32_t> depths(nodeCount, 0);
+    std::vector<uint32_t> subtreeSizes(nodeCount, 1);
+    uint32_t maxDepth = 0;
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        const SceneNode &node = sceneNodes[i];
+        assert(i == 0 || node.Parent < i);  // Nodes are not in pre-order sequence
+
+        m_Parents[i] = node.Parent;
+        m_LocalTransforms[i] = node.Transform;
+        depths[i] = i == 0 ? 0 : depths[node.Parent] + 1;
+        maxDepth = std::max(maxDepth, depths[i]);
+    }
+
+    for (uint32_t i = nodeCount - 1; i > 0; i--)
+        subtreeSizes[m_Parents[i]] += subtreeSizes[i];
+
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        m_SubtreeEnds[i] = i + subtreeSizes[i];
+        assert(m_SubtreeEnds[i] <= m_SubtreeEnds[m_Parents[i]]);  // Subtree is not a contiguous range
+    }
+
+    m_LevelOffsets.resize(maxDepth + 2, 0);
+    for (uint32_t depth : depths)
+        m_LevelOffsets[depth + 1]++;
+    std::partial_sum(m_LevelOffsets.begin(), m_LevelOffsets.end(), m_LevelOffsets.begin());
+
+    std::vector<uint32_t> levelCursors(m_LevelOffsets.begin(), m_LevelOffsets.end() - 1);
+    m_LevelNodes.resize(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; i++)
+        m_LevelNodes[levelCursors[depths[i]]++] = i;
+
+    std::vector<uint32_t> animatedNodes;
+    for (const Animation &animation : m_Animations)
+        for (const AnimationNode &node : animation.Nodes)
+            animatedNodes.push_back(node.SceneNodeIndex);
+
+    std::ranges::sort(animatedNodes);
+    animatedNodes.erase(std::unique(animatedNodes.begin(), animatedNodes.end()), animatedNodes.end());
+
+    for (uint32_t nodeIndex : animatedNodes)
+    {
+        if (!m_AnimatedRanges.empty() && nodeIndex < m_AnimatedRanges.back().second)
+            continue;
+
+        m_AnimatedRanges.emplace_back(nodeIndex, m_SubtreeEnds[nodeIndex]);
+        m_AnimatedNodeCount += m_SubtreeEnds[nodeIndex] - nodeIndex;
+    }
+
+    UpdateLevels();
 }
 
-SceneGraph::SceneGraph(SceneGraph &&sceneGraph) noexcept
-    : m_SceneNodes(std::move(sceneGraph.m_SceneNodes)),
-      m_IsRelativeTransform(std::move(sceneGraph.m_IsRelativeTransform)),
-      m_Animations(std::move(sceneGraph.m_Animations))
+SceneGraph::SceneGraph(SceneGraph &&sceneGraph) noexcept = default;
+
+SceneGraph &SceneGraph::operator=(SceneGraph &&sceneGraph) noexcept = default;
+
+SceneGraph::~SceneGraph() = default;
+
+bool SceneGraph::Update(float timeStep)
 {
+    m_Time += timeStep;
+    for (Animation &animation : m_Animations)
+        animation.Update(timeStep, m_LocalTransforms, m_IsDirty);
+
+    return UpdateTransforms();
 }
 
-SceneGraph &SceneGraph::operator=(SceneGraph &&sceneGraph) noexcept
+bool SceneGraph::Seek(float time)
 {
-    m_SceneNodes = std::move(sceneGraph.m_SceneNodes);
-    m_IsRelativeTransform = std::move(sceneGraph.m_IsRelativeTransform);
-    m_Animations = std::move(sceneGraph.m_Animations);
-    return *this;
+    m_Time = time;
+    for (Animation &animation : m_Animations)
+        animation.Seek(time, m_LocalTransforms, m_IsDirty);
+
+    return UpdateTransforms();
 }
 
-void SceneGraph::Update(float timeStep)
+bool SceneGraph::UpdateTransforms()
 {
-    for (Animation &animation : m_Animations)
-        animation.Update(timeStep, m_SceneNodes);
+    m_UpdateIndex++;
 
-    UpdateTransforms();
+    // Only animated subtrees can change, large ones are updated in parallel with the rest of the graph
+    if (m_AnimatedNodeCount >= ParallelUpdateMinNodeCount)
+        return UpdateLevels();
+
+    bool isAnyChanged = false;
+    for (const auto [begin, end] : m_AnimatedRanges)
+        isAnyChanged |= UpdateRange(begin, end);
+
+    return isAnyChanged;
+}
+
+std::span<const glm::mat3x4> SceneGraph::GetTransforms() const
+{
+    return m_Transforms;
 }
 
-std::span<const SceneNode> SceneGraph::GetSceneNodes() const
+bool SceneGraph::IsNodeChanged(uint32_t nodeIndex) const
 {
-    return m_SceneNodes;
+    return m_ChangedUpdateIndices[nodeIndex] == m_UpdateIndex;
 }
 
 bool SceneGraph::HasAnimations() const
@@ -101,4 +242,9 @@ bool SceneGraph::HasAnimations() const
     return !m_Animations.empty();
 }
 
+float SceneGraph::GetTime() const
+{
+    return m_Time;
+}
+
 }
\ No newline at end of file
@@ -4,7 +4,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <algorithm>
+#include <memory>
 #include <span>
+#include <utility>
+#include <vector>
 
 namespace PathTracing
 {
@@ -13,24 +17,25 @@ struct SceneNode
 {
     const uint32_t Parent;
     glm::mat4 Transform;
-    glm::mat4 CurrentTransform;
 };
 
 struct AnimationNode
 {
+    // Key ticks are stored apart from the values, so the key lookup only scans the ticks
     template<typename T> struct Sequence
     {
-        struct Key
-        {
-            T Value;
-            float Tick;
-        };
+        std::vector<float> Ticks;
+        std::vector<T> Values;
 
-        std::vector<Key> Keys;
+        // Key found by the last lookup, playing forward stays on it or moves to the next one
         uint32_t Index = 0;
 
-        T Update(float currentTick);
-        T Interpolate(float ratio);
+        void Reserve(size_t keyCount);
+        void AddKey(const T &value, float tick);
+
+        T Sample(float tick);
+        uint32_t FindKey(float tick);
+        T Interpolate(uint32_t index, float ratio) const;
     };
 
     uint32_t SceneNodeIndex;
@@ -40,31 +45,61 @@ struct AnimationNode
     Sequence<glm::vec3> Scales;
 };
 
-template<typename T> inline T AnimationNode::Sequence<T>::Update(float currentTick)
+template<typename T> inline void AnimationNode::Sequence<T>::Reserve(size_t keyCount)
 {
-    if (currentTick < Keys[0].Tick)
-        return Keys[0].Value;
+    Ticks.reserve(keyCount);
+    Values.reserve(keyCount);
+}
 
-    while (Index + 1 < Keys.size() && currentTick > Keys[Index + 1].Tick)
-        Index++;
+template<typename T> inline void AnimationNode::Sequence<T>::AddKey(const T &value, float tick)
+{
+    assert(Ticks.empty() || Ticks.back() <= tick);  // Keys are not sorted by tick
+    Ticks.push_back(tick);
+    Values.push_back(value);
+}
 
-    if (Index + 1 == Keys.size())
-        return Keys.back().Value;
+template<typename T> inline T AnimationNode::Sequence<T>::Sample(float tick)
+{
+    if (tick <= Ticks.front())
+        return Values.front();
 
-    const float total = Keys[Index + 1].Tick - Keys[Index].Tick;
-    const float current = currentTick - Keys[Index].Tick;
+    const uint32_t index = FindKey(tick);
+    if (index + 1 == Ticks.size())
+        return Values.back();
 
-    return Interpolate(current / total);
+    const float total = Ticks[index + 1] - Ticks[index];
+    const float current = tick - Ticks[index];
+
+    return Interpolate(index, current / total);
 }
 
-template<typename T> inline T AnimationNode::Sequence<T>::Interpolate(float ratio)
+// Returns the last key at or before the tick, in O(1) for forward playback and O(log n) for seeking
+template<typename T> inline uint32_t AnimationNode::Sequence<T>::FindKey(float tick)
 {
-    return glm::mix(Keys[Index].Value, Keys[Index + 1].Value, ratio);
+    auto isKeyOf = [this, tick](uint32_t index) {
+        return Ticks[index] <= tick && (index + 1 == Ticks.size() || tick < Ticks[index + 1]);
+    };
+
+    if (Index < Ticks.size() && isKeyOf(Index))
+        return Index;
+
+    if (Index + 1 < Ticks.size() && isKeyOf(Index + 1))
+        return ++Index;
+
+    const auto it = std::upper_bound(Ticks.begin(), Ticks.end(), tick);
+    Index = static_cast<uint32_t>(std::max<ptrdiff_t>(std::distance(Ticks.begin(), it) - 1, 0));
+    return Index;
+}
+
+template<typename T> inline T AnimationNode::Sequence<T>::Interpolate(uint32_t index, float ratio) const
+{
+    return glm::mix(Values[index], Values[index + 1], ratio);
 }
 
-template<> inline glm::quat AnimationNode::Sequence<glm::quat>::Interpolate(float ratio)
+template<>
+inline glm::quat AnimationNode::Sequence<glm::quat>::Interpolate(uint32_t index, float ratio) const
 {
-    return glm::slerp(Keys[Index].Value, Keys[Index + 1].Value, ratio);
+    return glm::slerp(Values[index], Values[index + 1], ratio);
 }
 
 struct Animation
@@ -74,9 +109,16 @@ struct Animation
     const float Duration;
     float CurrentTick = 0;
 
-    void Update(float timeStep, std::span<SceneNode> nodes);
+    // Writes local transforms of the animated nodes and marks the ones that changed as dirty
+    void Update(float timeStep, std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty);
+    void Seek(float time, std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty);
+
+private:
+    void Sample(std::span<glm::mat3x4> transforms, std::span<uint8_t> isDirty);
 };
 
+class WorkerPool;
+
 class SceneGraph
 {
 public:
@@ -90,19 +132,54 @@ public:
 
     SceneGraph(SceneGraph &&sceneGraph) noexcept;
     SceneGraph &operator=(SceneGraph &&sceneGraph) noexcept;
+    ~SceneGraph();
 
-    void Update(float timeStep);
+    // Returns true if any node transform changed
+    bool Update(float timeStep);
+    // Jumps to a time in seconds, the cost doesn't depend on the distance from the current time
+    bool Seek(float time);
 
-    [[nodiscard]] std::span<const SceneNode> GetSceneNodes() const;
+    // World transforms of the nodes, their addresses are stable for the lifetime of the graph
+    [[nodiscard]] std::span<const glm::mat3x4> GetTransforms() const;
+    [[nodiscard]] bool IsNodeChanged(uint32_t nodeIndex) const;
     [[nodiscard]] bool HasAnimations() const;
+    [[nodiscard]] float GetTime() const;
 
 private:
-    std::vector<SceneNode> m_SceneNodes;
-    std::vector<bool> m_IsRelativeTransform;
+    static inline constexpr uint32_t ParallelUpdateMinNodeCount = 1u << 14;
+    static inline constexpr uint32_t ParallelUpdateChunkSize = 1u << 10;
+    static inline constexpr uint8_t MaxUpdateThreadCount = 8;
+
+    // Nodes are in pre-order sequence, so the subtree of every node is a contiguous range
+    std::vector<uint32_t> m_Parents;
+    std::vector<uint32_t> m_SubtreeEnds;
+    std::vector<uint8_t> m_IsRelativeTransform;
+    std::vector<glm::mat3x4> m_LocalTransforms;
+    std::vector<glm::mat3x4> m_Transforms;
+
+    // Nodes with a local transform that wasn't propagated yet
+    std::vector<uint8_t> m_IsDirty;
+    // Index of the last update that changed the transform of each node
+    std::vector<uint32_t> m_ChangedUpdateIndices;
+    uint32_t m_UpdateIndex = 0;
+
+    // Subtrees of animated nodes that are not nested in another animated subtree
+    std::vector<std::pair<uint32_t, uint32_t>> m_AnimatedRanges;
+    uint32_t m_AnimatedNodeCount = 0;
+
+    // Node indices sorted by depth, so nodes of one level can be updated in parallel
+    std::vector<uint32_t> m_LevelNodes;
+    std::vector<uint32_t> m_LevelOffsets;
+    std::unique_ptr<WorkerPool> m_UpdatePool;  // Created by the first parallel update
+
     std::vector<Animation> m_Animations;
+    float m_Time = 0.0f;
 
 private:
-    void UpdateTransforms();
+    bool UpdateTransforms();
+    bool UpdateNode(uint32_t nodeIndex);
+    bool UpdateRange(uint32_t begin, uint32_t end);
+    bool UpdateLevels();
 };
 
 }
\ No newline at end of file
@@ -1,13 +1,18 @@
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/ProgressHandler.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <glm/ext/matrix_relational.hpp>
 
+#include <algorithm>
+#include <numeric>
 #include <stack>
+#include <thread>
 
 #include "Core/Config.h"
 #include "Core/Core.h"
+#include "Core/Threads.h"
 
 #include "Application.h"
 #include "SceneImporter.h"
@@ -66,9 +71,44 @@ std::span<const aiTextureType> GetTextureTypes(TextureType type)
     }
 }
 
+struct TextureContext
+{
+    std::filesystem::path ScenePath;
+    const aiScene *Scene;
+    std::vector<MemoryTextureSource> EmbeddedTextures;
+};
+
+std::vector<MemoryTextureSource> LoadEmbeddedTextures(SceneBuilder &sceneBuilder, const aiScene *scene)
+{
+    std::vector<MemoryTextureSource> embeddedTextures(scene->mNumTextures);
+
+    for (int i = 0; i < scene->mNumTextures; i++)
+    {
+        aiTexture *texture = scene->mTextures[i];
+
+        // Only compressed images (png, jpg, dds...) are stored with a height of 0
+        if (texture->mHeight != 0)
+        {
+            logger::warn("Uncompressed embedded texture {} is not supported", texture->mFilename.C_Str());
+            continue;
+        }
+
+        // Take the compressed bytes over from the importer instead of copying them,
+        // the texture loaders decode them straight from memory like they do for files
+        aiTexel *data = std::exchange(texture->pcData, nullptr);
+        sceneBuilder.AddTextureBuffer(std::shared_ptr<const void>(data, [](const void *data) {
+            delete[] static_cast<const aiTexel *>(data);
+        }));
+
+        embeddedTextures[i] = MemoryTextureSource(reinterpret_cast<const uint8_t *>(data), texture->mWidth);
+    }
+
+    return embeddedTextures;
+}
+
 uint32_t AddTexture(
-    SceneBuilder &sceneBuilder, const std::filesystem::path &base, const aiMaterial *material,
-    TextureType type, bool *isTransparent = nullptr
+    SceneBuilder &sceneBuilder, const TextureContext &context, const aiMaterial *material, TextureType type,
+    bool *isTransparent = nullptr
 )
 {
     for (aiTextureType textureType : GetTextureTypes(type))
@@ -83,13 +123,25 @@ uint32_t AddTexture(
         aiReturn ret = material->GetTexture(textureType, 0, &path);
         assert(ret == aiReturn_SUCCESS);
         logger::trace("Adding texture {} at {}", aiTextureTypeToString(textureType), path.C_Str());
-        
-        std::filesystem::path texturePath = base / std::filesystem::path(path.C_Str());
+
+        TextureSourceVariant source = context.ScenePath.parent_path() / std::filesystem::path(path.C_Str());
+        std::string name = path.C_Str();
+
+        auto [embeddedTexture, embeddedIndex] = context.Scene->GetEmbeddedTextureAndIndex(path.C_Str());
+        if (embeddedTexture != nullptr)
+        {
+            if (context.EmbeddedTextures[embeddedIndex].empty())
+                return Scene::GetDefaultTextureIndex(type);
+
+            // Embedded texture names like *0 are only unique within a single file
+            source = context.EmbeddedTextures[embeddedIndex];
+            name = std::format("{}:{}", context.ScenePath.string(), name);
+        }
 
         try
         {
             TextureInfo info =
-                TextureImporter::GetTextureInfo(texturePath, type, path.C_Str(), isTransparent);
+                TextureImporter::GetTextureInfo(std::move(source), type, std::move(name), isTransparent);
             return sceneBuilder.AddTexture(std::move(info));
         }
         catch (const error &error)
@@ -109,14 +161,14 @@ struct EmissiveInfo
 };
 
 EmissiveInfo LoadEmissive(
-    const std::filesystem::path &path, SceneBuilder &sceneBuilder, const aiMaterial *material
+    const TextureContext &context, SceneBuilder &sceneBuilder, const aiMaterial *material
 )
 {
     float intensity = 1.0f;
     material->Get(AI_MATKEY_EMISSIVE_INTENSITY, intensity);
 
     const uint32_t defaultTextureIdx = Scene::GetDefaultTextureIndex(TextureType::Emisive);
-    const uint32_t textureIdx = AddTexture(sceneBuilder, path.parent_path(), material, TextureType::Emisive);
+    const uint32_t textureIdx = AddTexture(sceneBuilder, context, material, TextureType::Emisive);
     
     if (textureIdx != defaultTextureIdx)
         return EmissiveInfo {
@@ -149,7 +201,7 @@ struct TransmissionInfo
 };
 
 TransmissionInfo LoadTransmission(
-    const std::filesystem::path &path, SceneBuilder &sceneBuilder, const aiMaterial *material
+    const TextureContext &context, SceneBuilder &sceneBuilder, const aiMaterial *material
 )
 {
     float ior = 1.5f, transmission = 0.0f, attenuationDistance = 1e32f;
@@ -173,7 +225,7 @@ struct MaterialInfo
 };
 
 MaterialInfo LoadMetallicRoughnessMaterial(
-    const std::filesystem::path &path, SceneBuilder &sceneBuilder, const aiMaterial *material,
+    const TextureContext &context, SceneBuilder &sceneBuilder, const aiMaterial *material,
     const std::string &materialName, MetallicRoughnessTextureMapping mapping
 )
 {
@@ -184,8 +236,8 @@ MaterialInfo LoadMetallicRoughnessMaterial(
     material->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness);
     material->Get(AI_MATKEY_METALLIC_FACTOR, metalness);
 
-    EmissiveInfo emissive = LoadEmissive(path, sceneBuilder, material);
-    TransmissionInfo transmission = LoadTransmission(path, sceneBuilder, material);
+    EmissiveInfo emissive = LoadEmissive(context, sceneBuilder, material);
+    TransmissionInfo transmission = LoadTransmission(context, sceneBuilder, material);
 
     bool hasTransparency;
     Shaders::MetallicRoughnessMaterial outMaterial = {
@@ -200,12 +252,12 @@ MaterialInfo LoadMetallicRoughnessMaterial(
         .AttenuationDistance = transmission.AttenuationDistance,
         .EmissiveIdx = emissive.TextureIdx,
         .ColorIdx = AddTexture(
-            sceneBuilder, path.parent_path(), material, mapping.ColorTexture, &hasTransparency
+            sceneBuilder, context, material, mapping.ColorTexture, &hasTransparency
         ),
-        .NormalIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.NormalTexture),
+        .NormalIdx = AddTexture(sceneBuilder, context, material, mapping.NormalTexture),
         .RoughnessIdx =
-            AddTexture(sceneBuilder, path.parent_path(), material, mapping.RoughnessTexture),
-        .MetallicIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.MetallicTexture),
+            AddTexture(sceneBuilder, context, material, mapping.RoughnessTexture),
+        .MetallicIdx = AddTexture(sceneBuilder, context, material, mapping.MetallicTexture),
     };
 
     return MaterialInfo {
@@ -216,7 +268,7 @@ MaterialInfo LoadMetallicRoughnessMaterial(
 }
 
 MaterialInfo LoadSpecularGlossinessMaterial(
-    const std::filesystem::path &path, SceneBuilder &sceneBuilder, const aiMaterial *material,
+    const TextureContext &context, SceneBuilder &sceneBuilder, const aiMaterial *material,
     const std::string &materialName, SpecularGlossinessTextureMapping mapping
 )
 {
@@ -228,8 +280,8 @@ MaterialInfo LoadSpecularGlossinessMaterial(
     material->Get(AI_MATKEY_SPECULAR_FACTOR, specular);
     material->Get(AI_MATKEY_GLOSSINESS_FACTOR, glossiness);
 
-    EmissiveInfo emissive = LoadEmissive(path, sceneBuilder, material);
-    TransmissionInfo transmission = LoadTransmission(path, sceneBuilder, material);
+    EmissiveInfo emissive = LoadEmissive(context, sceneBuilder, material);
+    TransmissionInfo transmission = LoadTransmission(context, sceneBuilder, material);
 
     bool hasTransparency;
     Shaders::SpecularGlossinessMaterial outMaterial = {
@@ -243,10 +295,10 @@ MaterialInfo LoadSpecularGlossinessMaterial(
         .Ior = transmission.Ior,
         .Transmission = transmission.Transmission,
         .EmissiveIdx = emissive.TextureIdx,
-        .ColorIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.ColorTexture, &hasTransparency),
-        .NormalIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.NormalTexture),
-        .SpecularIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.SpecularTexture),
-        .GlossinessIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.GlossinessTexture),
+        .ColorIdx = AddTexture(sceneBuilder, context, material, mapping.ColorTexture, &hasTransparency),
+        .NormalIdx = AddTexture(sceneBuilder, context, material, mapping.NormalTexture),
+        .SpecularIdx = AddTexture(sceneBuilder, context, material, mapping.SpecularTexture),
+        .GlossinessIdx = AddTexture(sceneBuilder, context, material, mapping.GlossinessTexture),
     };
 
     return MaterialInfo {
@@ -257,7 +309,7 @@ MaterialInfo LoadSpecularGlossinessMaterial(
 }
 
 MaterialInfo LoadPhongMaterial(
-    const std::filesystem::path &path, SceneBuilder &sceneBuilder, const aiMaterial *material,
+    const TextureContext &context, SceneBuilder &sceneBuilder, const aiMaterial *material,
     const std::string &materialName, PhongTextureMapping mapping
 )
 {
@@ -269,8 +321,8 @@ MaterialInfo LoadPhongMaterial(
     material->Get(AI_MATKEY_SPECULAR_FACTOR, specular);
     material->Get(AI_MATKEY_SHININESS, shininess);
 
-    EmissiveInfo emissive = LoadEmissive(path, sceneBuilder, material);
-    TransmissionInfo transmission = LoadTransmission(path, sceneBuilder, material);
+    EmissiveInfo emissive = LoadEmissive(context, sceneBuilder, material);
+    TransmissionInfo transmission = LoadTransmission(context, sceneBuilder, material);
 
     bool hasTransparency;
     Shaders::PhongMaterial outMaterial = {
@@ -284,10 +336,10 @@ MaterialInfo LoadPhongMaterial(
         .Ior = transmission.Ior,
         .Transmission = transmission.Transmission,
         .EmissiveIdx = emissive.TextureIdx,
-        .ColorIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.ColorTexture, &hasTransparency),
-        .NormalIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.NormalTexture),
-        .SpecularIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.SpecularTexture),
-        .ShininessIdx = AddTexture(sceneBuilder, path.parent_path(), material, mapping.ShininessTexture),
+        .ColorIdx = AddTexture(sceneBuilder, context, material, mapping.ColorTexture, &hasTransparency),
+        .NormalIdx = AddTexture(sceneBuilder, context, material, mapping.NormalTexture),
+        .SpecularIdx = AddTexture(sceneBuilder, context, material, mapping.SpecularTexture),
+        .ShininessIdx = AddTexture(sceneBuilder, context, material, mapping.ShininessTexture),
     };
 
     return MaterialInfo {
@@ -344,6 +396,12 @@ std::vector<MaterialInfo> LoadMaterials(
         .ShininessTexture = TextureType::Shininess,
     };
 
+    const TextureContext context = {
+        .ScenePath = path,
+        .Scene = scene,
+        .EmbeddedTextures = LoadEmbeddedTextures(sceneBuilder, scene),
+    };
+
     const MetallicRoughnessTextureMapping *metallicRoughnessMapping = &defaultMetallicRoughnessMapping;
     const SpecularGlossinessTextureMapping *specularGlossinessMapping = &defaultSpecularGlossinessMapping;
     const PhongTextureMapping *phongMapping = &defaultPhongMapping;
@@ -379,16 +437,16 @@ std::vector<MaterialInfo> LoadMaterials(
         {
         case MaterialType::MetallicRoughness:
             materialInfoMap[i] = LoadMetallicRoughnessMaterial(
-                path, sceneBuilder, material, materialName, *metallicRoughnessMapping
+                context, sceneBuilder, material, materialName, *metallicRoughnessMapping
             );
             break;
         case MaterialType::SpecularGlossiness:
             materialInfoMap[i] = LoadSpecularGlossinessMaterial(
-                path, sceneBuilder, material, materialName, *specularGlossinessMapping
+                context, sceneBuilder, material, materialName, *specularGlossinessMapping
             );
             break;
         case MaterialType::Phong:
-            materialInfoMap[i] = LoadPhongMaterial(path, sceneBuilder, material, materialName, *phongMapping);
+            materialInfoMap[i] = LoadPhongMaterial(context, sceneBuilder, material, materialName, *phongMapping);
         default:
             throw error("Unsupported material type");
         }
@@ -399,19 +457,6 @@ std::vector<MaterialInfo> LoadMaterials(
     return materialInfoMap;
 }
 
-// Some meshes might differ only in material, but have the same geometry
-uint32_t FindSameGeometry(std::span<aiMesh *const> haystack, const aiMesh *needle)
-{
-    // TODO: Should check that both materials are opaque
-
-    for (uint32_t i = 0; i < haystack.size(); i++)
-        if (haystack[i]->mFaces == needle->mFaces && haystack[i]->mNumFaces == needle->mNumFaces &&
-            haystack[i]->mBones == needle->mBones)
-            return i;
-
-    return haystack.size();
-}
-
 bool CheckAnimated(const aiMesh *mesh)
 {
     return mesh->HasBones();
@@ -450,6 +495,77 @@ void LoadBones(
             assert(vertexBoneIndex < Shaders::MaxBonesPerVertex);
         }
     }
+
+    // Quantized weights of the packed skinning vertices are only exact when they sum to one
+    for (auto &vertex : std::span(vertices).subspan(vertexOffset, mesh->mNumVertices))
+    {
+        const float weightSum =
+            std::accumulate(std::begin(vertex.BoneWeights), std::end(vertex.BoneWeights), 0.0f);
+        if (weightSum > 0.0f)
+            for (float &weight : vertex.BoneWeights)
+                weight /= weightSum;
+    }
+}
+
+std::pair<glm::vec3, glm::vec3> ComputeTangentSpace(glm::vec3 normal)
+{
+    glm::vec3 t1 = glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::vec3 t2 = glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glm::vec3 tangent = glm::length(t1) > glm::length(t2) ? t1 : t2;
+    glm::vec3 bitangent = cross(normal, tangent);
+
+    return { glm::normalize(tangent), glm::normalize(bitangent) };
+}
+
+template<typename V> void LoadVertices(const aiMesh *mesh, std::span<V> vertices)
+{
+    assert(!mesh->HasTextureCoords(0) || mesh->mNumUVComponents[0] == 2);
+
+    for (int j = 0; j < vertices.size(); j++)
+    {
+        V &vertex = vertices[j];
+
+        vertex.Position = TrivialCopy<aiVector3D, glm::vec3>(mesh->mVertices[j]);
+        if (mesh->HasTextureCoords(0))
+            vertex.TexCoords = TrivialCopy<aiVector3D, glm::vec2>(mesh->mTextureCoords[0][j]);
+        vertex.Normal = TrivialCopy<aiVector3D, glm::vec3>(mesh->mNormals[j]);
+        if (mesh->HasTangentsAndBitangents())
+        {
+            vertex.Tangent = TrivialCopy<aiVector3D, glm::vec3>(mesh->mTangents[j]);
+            vertex.Bitangent = TrivialCopy<aiVector3D, glm::vec3>(mesh->mBitangents[j]);
+
+            if (vertex.Normal == vertex.Tangent || vertex.Normal == vertex.Bitangent ||
+                vertex.Tangent == vertex.Bitangent)
+            {
+                std::tie(vertex.Tangent, vertex.Bitangent) = ComputeTangentSpace(vertex.Normal);
+            }
+        }
+        else
+        {
+            std::tie(vertex.Tangent, vertex.Bitangent) = ComputeTangentSpace(vertex.Normal);
+        }
+
+        assert(vertex.Normal != vertex.Tangent);
+        assert(vertex.Normal != vertex.Bitangent);
+        assert(vertex.Tangent != vertex.Bitangent);
+    }
+}
+
+void LoadIndices(const aiMesh *mesh, std::span<uint32_t> indices)
+{
+    for (int j = 0; j < mesh->mNumFaces; j++)
+    {
+        const aiFace &face = mesh->mFaces[j];
+        assert(face.mNumIndices == 3);
+        std::ranges::copy(std::span(face.mIndices, 3), indices.begin() + j * 3);
+    }
+}
+
+uint32_t GetImportThreadCount()
+{
+    const uint32_t desiredImportThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::min({ Application::GetConfig().MaxSceneImportThreads, desiredImportThreadCount, 16u });
 }
 
 std::vector<uint32_t> LoadMeshes(
@@ -465,161 +581,119 @@ std::vector<uint32_t> LoadMeshes(
     auto &animatedIndices = sceneBuilder.GetAnimatedIndices();
 
     std::vector<uint32_t> meshToGeometry(scene->mNumMeshes);
-    uint32_t vertexOffset = vertices.size(), indexOffset = indices.size();
-    uint32_t animatedVertexOffset = animatedVertices.size(), animatedIndexOffset = animatedIndices.size();
+    std::vector<uint32_t> meshVertexOffsets(scene->mNumMeshes), meshIndexOffsets(scene->mNumMeshes);
+    const uint32_t firstVertexOffset = vertices.size(), firstIndexOffset = indices.size();
 
+    // Every mesh gets its own ranges, so that the meshes can be converted independently
     {
-        uint32_t vertexCount = 0, indexCount = 0;
-        uint32_t animatedVertexCount = 0, animatedIndexCount = 0;
+        uint32_t vertexOffset = vertices.size(), indexOffset = indices.size();
+        uint32_t animatedVertexOffset = animatedVertices.size(), animatedIndexOffset = animatedIndices.size();
         for (int i = 0; i < scene->mNumMeshes; i++)
         {
             const aiMesh *mesh = scene->mMeshes[i];
 
-            uint32_t &vc = CheckAnimated(mesh) ? animatedVertexCount : vertexCount;
-            uint32_t &ic = CheckAnimated(mesh) ? animatedIndexCount : indexCount;
+            uint32_t &vo = CheckAnimated(mesh) ? animatedVertexOffset : vertexOffset;
+            uint32_t &io = CheckAnimated(mesh) ? animatedIndexOffset : indexOffset;
+
+            meshVertexOffsets[i] = vo;
+            meshIndexOffsets[i] = io;
 
-            vc += mesh->mNumVertices;
-            ic += mesh->mNumFaces * 3;
+            vo += mesh->mNumVertices;
+            io += mesh->mNumFaces * 3;
         }
 
-        vertices.resize(vertices.size() + vertexCount);
-        animatedVertices.resize(animatedVertices.size() + animatedVertexCount);
-        indices.resize(indices.size() + indexCount);
-        animatedIndices.resize(animatedIndices.size() + animatedIndexCount);
+        vertices.resize(vertexOffset);
+        animatedVertices.resize(animatedVertexOffset);
+        indices.resize(indexOffset);
+        animatedIndices.resize(animatedIndexOffset);
     }
 
-    for (uint32_t i = 0; i < scene->mNumMeshes; i++)
-    {
-        const aiMesh *mesh = scene->mMeshes[i];
+    ThreadDispatch<uint32_t> dispatch(GetImportThreadCount());
+    dispatch.DispatchBlocking(
+        scene->mNumMeshes, [&](uint32_t threadId, uint32_t meshIndex, std::stop_token stopToken) {
+            const aiMesh *mesh = scene->mMeshes[meshIndex];
+            const uint32_t vertexOffset = meshVertexOffsets[meshIndex];
+            const uint32_t indexOffset = meshIndexOffsets[meshIndex];
 
-        const uint32_t otherGeometryIndex = FindSameGeometry(std::span(scene->mMeshes, i), mesh);
-        if (otherGeometryIndex != i)
-        {
-            const aiMesh *other = scene->mMeshes[otherGeometryIndex];
-            logger::debug(
-                "Adding geometry of mesh {} (idx: {}) as the same as geometry of mesh {} (idx: {})",
-                mesh->mName.C_Str(), i, other->mName.C_Str(), otherGeometryIndex
-            );
+            if (CheckAnimated(mesh))
+            {
+                LoadVertices(mesh, std::span(animatedVertices).subspan(vertexOffset, mesh->mNumVertices));
+                LoadIndices(mesh, std::span(animatedIndices).subspan(indexOffset, mesh->mNumFaces * 3));
+            }
+            else
+            {
+                LoadVertices(mesh, std::span(vertices).subspan(vertexOffset, mesh->mNumVertices));
+                LoadIndices(mesh, std::span(indices).subspan(indexOffset, mesh->mNumFaces * 3));
+            }
 
             Application::IncrementBackgroundTaskDone(BackgroundTaskType::SceneImport);
-            continue;
         }
+    );
+
+    // Geometries are added in mesh order, so the result doesn't depend on the thread scheduling
+    uint32_t vertexOffset = firstVertexOffset, indexOffset = firstIndexOffset;
+    uint32_t duplicateCount = 0;
+    for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        const aiMesh *mesh = scene->mMeshes[i];
 
         const uint32_t vertexCount = mesh->mNumVertices;
         const uint32_t indexCount = mesh->mNumFaces * 3;
 
-        uint32_t &vo = CheckAnimated(mesh) ? animatedVertexOffset : vertexOffset;
-        uint32_t &io = CheckAnimated(mesh) ? animatedIndexOffset : indexOffset;
-
-        assert(!mesh->HasTextureCoords(0) || mesh->mNumUVComponents[0] == 2);
+        bool isOpaque = materialInfoMap[mesh->mMaterialIndex].IsOpaque;
 
-        for (int j = 0; j < vertexCount; j++)
+        if (CheckAnimated(mesh))
         {
-            const uint32_t idx = vo + j;
-
-            auto computeTangentSpace = [](glm::vec3 normal) -> std::pair<glm::vec3, glm::vec3> {
-                glm::vec3 t1 = glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f));
-                glm::vec3 t2 = glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f));
-
-                glm::vec3 tangent = glm::length(t1) > glm::length(t2) ? t1 : t2;
-                glm::vec3 bitangent = cross(normal, tangent);
-                
-                return { glm::normalize(tangent), glm::normalize(bitangent) };
-            };
+            LoadBones(
+                sceneBuilder, scene, animatedVertices, meshVertexOffsets[i], mesh, sceneNodeIndices, armatures
+            );
+            meshToGeometry[i] = sceneBuilder.AddGeometry(
+                { meshVertexOffsets[i], vertexCount, meshIndexOffsets[i], indexCount, isOpaque, true }
+            );
+        }
+        else
+        {
+            // Close the gaps left by the merged geometries
+            if (vertexOffset != meshVertexOffsets[i])
+                std::copy_n(
+                    vertices.begin() + meshVertexOffsets[i], vertexCount, vertices.begin() + vertexOffset
+                );
+            if (indexOffset != meshIndexOffsets[i])
+                std::copy_n(indices.begin() + meshIndexOffsets[i], indexCount, indices.begin() + indexOffset);
 
-            if (CheckAnimated(mesh))
-            {
-                animatedVertices[idx].Position = TrivialCopy<aiVector3D, glm::vec3>(mesh->mVertices[j]);
-                if (mesh->HasTextureCoords(0))
-                    animatedVertices[idx].TexCoords =
-                        TrivialCopy<aiVector3D, glm::vec2>(mesh->mTextureCoords[0][j]);
-                animatedVertices[idx].Normal = TrivialCopy<aiVector3D, glm::vec3>(mesh->mNormals[j]);
-                if (mesh->HasTangentsAndBitangents())
-                {
-                    animatedVertices[idx].Tangent = TrivialCopy<aiVector3D, glm::vec3>(mesh->mTangents[j]);
-                    animatedVertices[idx].Bitangent =
-                        TrivialCopy<aiVector3D, glm::vec3>(mesh->mBitangents[j]);
-
-                    if (animatedVertices[idx].Normal == animatedVertices[idx].Tangent ||
-                        animatedVertices[idx].Normal == animatedVertices[idx].Bitangent ||
-                        animatedVertices[idx].Tangent == animatedVertices[idx].Bitangent)
-                    {
-                        std::tie(animatedVertices[idx].Tangent, animatedVertices[idx].Bitangent) =
-                            computeTangentSpace(animatedVertices[idx].Normal);
-                    }
-                }
-                else
-                {
-                    std::tie(animatedVertices[idx].Tangent, animatedVertices[idx].Bitangent) =
-                        computeTangentSpace(animatedVertices[idx].Normal);
-                }
+            // Meshes might differ only in material or come from different files, but have the same geometry
+            bool isDuplicate = false;
+            meshToGeometry[i] = sceneBuilder.AddGeometry(
+                { vertexOffset, vertexCount, indexOffset, indexCount, isOpaque, false }, &isDuplicate
+            );
 
-                assert(animatedVertices[idx].Normal != animatedVertices[idx].Tangent);
-                assert(animatedVertices[idx].Normal != animatedVertices[idx].Bitangent);
-                assert(animatedVertices[idx].Tangent != animatedVertices[idx].Bitangent);
-            }
-            else
+            if (isDuplicate)
             {
-                vertices[idx].Position = TrivialCopy<aiVector3D, glm::vec3>(mesh->mVertices[j]);
-                if (mesh->HasTextureCoords(0))
-                    vertices[idx].TexCoords = TrivialCopy<aiVector3D, glm::vec2>(mesh->mTextureCoords[0][j]);
-                vertices[idx].Normal = TrivialCopy<aiVector3D, glm::vec3>(mesh->mNormals[j]);
-                if (mesh->HasTangentsAndBitangents())
-                {
-                    vertices[idx].Tangent = TrivialCopy<aiVector3D, glm::vec3>(mesh->mTangents[j]);
-                    vertices[idx].Bitangent = TrivialCopy<aiVector3D, glm::vec3>(mesh->mBitangents[j]);
-
-                    if (vertices[idx].Normal == vertices[idx].Tangent ||
-                        vertices[idx].Normal == vertices[idx].Bitangent ||
-                        vertices[idx].Tangent == vertices[idx].Bitangent)
-                    {
-                        std::tie(vertices[idx].Tangent, vertices[idx].Bitangent) =
-                            computeTangentSpace(vertices[idx].Normal);
-                    }
-                }
-                else
-                {
-                    std::tie(vertices[idx].Tangent, vertices[idx].Bitangent) =
-                        computeTangentSpace(vertices[idx].Normal);
-                }
-
-                assert(vertices[idx].Normal != vertices[idx].Tangent);
-                assert(vertices[idx].Normal != vertices[idx].Bitangent);
-                assert(vertices[idx].Tangent != vertices[idx].Bitangent);
+                logger::debug(
+                    "Adding geometry of mesh {} (idx: {}) as the same as geometry {}", mesh->mName.C_Str(), i,
+                    meshToGeometry[i]
+                );
+                duplicateCount++;
+                continue;
             }
-        }
 
-        for (int j = 0; j < mesh->mNumFaces; j++)
-        {
-            const uint32_t idx = io + j * 3;
-            const aiFace &face = mesh->mFaces[j];
-            assert(face.mNumIndices == 3);
-            std::vector<uint32_t> &i = !CheckAnimated(mesh) ? indices : animatedIndices;
-            std::ranges::copy(std::span(face.mIndices, 3), i.begin() + idx);
+            vertexOffset += vertexCount;
+            indexOffset += indexCount;
         }
 
-        if (CheckAnimated(mesh))
-            LoadBones(sceneBuilder, scene, animatedVertices, vo, mesh, sceneNodeIndices, armatures);
-
-        bool isOpaque = materialInfoMap[mesh->mMaterialIndex].IsOpaque;
-
-        if (!CheckAnimated(mesh))
-            meshToGeometry[i] =
-                sceneBuilder.AddGeometry({ vo, vertexCount, io, indexCount, isOpaque, false });
-        else
-            meshToGeometry[i] = sceneBuilder.AddGeometry({ vo, vertexCount, io, indexCount, isOpaque, true });
-
-        vo += vertexCount;
-        io += indexCount;
-
         logger::debug(
             "Adding geometry (mesh {}) ({}) with {} vertices and {} indices", mesh->mName.C_Str(),
             isOpaque ? "Opaque" : "Not opaque", vertexCount, indexCount
         );
-
-        Application::IncrementBackgroundTaskDone(BackgroundTaskType::SceneImport);
     }
 
+    // Drop the space of the merged geometries
+    vertices.resize(vertexOffset);
+    indices.resize(indexOffset);
+
+    if (duplicateCount > 0)
+        logger::debug("Merged {} meshes into already existing geometries", duplicateCount);
+
     return meshToGeometry;
 }
 
@@ -692,7 +766,6 @@ std::unordered_map<const aiNode *, uint32_t> LoadSceneNodes(
             {
                 .Parent = parentNodeIndex,
                 .Transform = TrivialCopy<aiMatrix4x4, glm::mat4>(node->mTransformation),
-                .CurrentTransform = glm::mat4(1.0f),
             }
         );
 
@@ -860,16 +933,16 @@ void LoadAnimations(
 
             AnimationNode outAnimNode(nodeIndex);
 
-            outAnimNode.Positions.Keys.reserve(animNode->mNumPositionKeys);
-            outAnimNode.Rotations.Keys.reserve(animNode->mNumRotationKeys);
-            outAnimNode.Scales.Keys.reserve(animNode->mNumScalingKeys);
+            outAnimNode.Positions.Reserve(animNode->mNumPositionKeys);
+            outAnimNode.Rotations.Reserve(animNode->mNumRotationKeys);
+            outAnimNode.Scales.Reserve(animNode->mNumScalingKeys);
 
             for (int k = 0; k < animNode->mNumPositionKeys; k++)
             {
                 const aiVectorKey *key = &animNode->mPositionKeys[k];
                 assert(key->mInterpolation == aiAnimInterpolation_Linear);
 
-                outAnimNode.Positions.Keys.emplace_back(
+                outAnimNode.Positions.AddKey(
                     TrivialCopy<aiVector3D, glm::vec3>(key->mValue), static_cast<float>(key->mTime)
                 );
             }
@@ -882,7 +955,7 @@ void LoadAnimations(
                     key->mInterpolation == aiAnimInterpolation_Spherical_Linear
                 );
 
-                outAnimNode.Rotations.Keys.emplace_back(
+                outAnimNode.Rotations.AddKey(
                     glm::quat(key->mValue.w, key->mValue.x, key->mValue.y, key->mValue.z),
                     static_cast<float>(key->mTime)
                 );
@@ -893,7 +966,7 @@ void LoadAnimations(
                 const aiVectorKey *key = &animNode->mScalingKeys[k];
                 assert(key->mInterpolation == aiAnimInterpolation_Linear);
 
-                outAnimNode.Scales.Keys.emplace_back(
+                outAnimNode.Scales.AddKey(
                     TrivialCopy<aiVector3D, glm::vec3>(key->mValue), static_cast<float>(key->mTime)
                 );
             }
@@ -1043,54 +1116,73 @@ private:
     uint32_t m_PreviousDone = 0;
 };
 
-}
-
-SceneBuilder &SceneImporter::AddFile(
-    SceneBuilder &sceneBuilder, const std::filesystem::path &path, TextureMapping textureMapping
-)
+// Records the files assimp opens, e.g. buffers and material libraries referenced by the scene file
+class DependencyIOSystem : public Assimp::DefaultIOSystem
 {
-    // Import by assimp will be half the entire task
-    const uint32_t assimpTasks = 100;
-    Application::ResetBackgroundTask(BackgroundTaskType::SceneImport);
-    Application::AddBackgroundTask(BackgroundTaskType::SceneImport, 2 * assimpTasks);
+public:
+    DependencyIOSystem(std::vector<std::filesystem::path> &dependencies) : m_Dependencies(dependencies)
+    {
+    }
 
-    logger::info("Loading Scene {}", path.string());
-    Timer timer("Scene Load");
+    ~DependencyIOSystem() override = default;
 
-    const aiScene *scene = nullptr;
+    Assimp::IOStream *Open(const char *file, const char *mode) override
     {
-        unsigned int flags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace |
-                             aiProcess_LimitBoneWeights | aiProcess_GenNormals |
-                             aiProcess_PopulateArmatureData;
+        Assimp::IOStream *stream = DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr)
+            m_Dependencies.emplace_back(file);
+
+        return stream;
+    }
+
+private:
+    std::vector<std::filesystem::path> &m_Dependencies;
+};
+
+// Import by assimp will be half the entire task
+const uint32_t AssimpTaskCount = 100;
+
+const aiScene *ReadFile(
+    Assimp::Importer &importer, const std::filesystem::path &path,
+    std::vector<std::filesystem::path> *dependencies
+)
+{
+    unsigned int flags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace |
+                         aiProcess_LimitBoneWeights | aiProcess_GenNormals | aiProcess_PopulateArmatureData;
 #ifdef CONFIG_OPTIMIZE_SCENE
-        flags |= aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes;
+    flags |= aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes;
 #endif
 
-        Timer timer("File Import");
-        s_Importer->SetProgressHandler(new ProgressHandler(assimpTasks));
-        scene = s_Importer->ReadFile(path.string().c_str(), flags);
+    importer.SetProgressHandler(new ProgressHandler(AssimpTaskCount));
+    importer.SetIOHandler(dependencies != nullptr ? new DependencyIOSystem(*dependencies) : nullptr);
+    const aiScene *scene = importer.ReadFile(path.string().c_str(), flags);
 
-        if (scene == nullptr)
-            throw error(s_Importer->GetErrorString());
-    }
+    // The importer keeps the handler, which must not outlive the dependency list
+    importer.SetIOHandler(nullptr);
+    return scene;
+}
 
+void LoadScene(
+    SceneBuilder &sceneBuilder, const std::filesystem::path &path, const aiScene *scene,
+    TextureMapping textureMapping
+)
+{
     assert((scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) == false);
     assert(scene->mRootNode != nullptr);
 
+    logger::info("Adding Scene {}", path.string());
     logger::info("Number of meshes in the scene: {}", scene->mNumMeshes);
     logger::info("Number of materials in the scene: {}", scene->mNumMaterials);
     logger::info("Number of lights in the scene: {}", scene->mNumLights);
     logger::info("Number of cameras in the scene: {}", scene->mNumCameras);
+    logger::info("Number of embedded textures in the scene: {}", scene->mNumTextures);
     logger::info("Number of animations in the scene: {}", scene->mNumAnimations);
 
     // Report half of the task as done
     const uint32_t taskSize = scene->mNumMeshes + scene->mNumAnimations;
-    Application::AddBackgroundTask(BackgroundTaskType::SceneImport, 2 * taskSize - assimpTasks);
+    Application::AddBackgroundTask(BackgroundTaskType::SceneImport, 2 * taskSize - AssimpTaskCount);
     Application::IncrementBackgroundTaskDone(BackgroundTaskType::SceneImport, taskSize);
 
-    // TODO: Support embedded textures
-    assert(scene->HasTextures() == false);
-
     std::vector<const aiNode *> nodes;
     std::unordered_map<const aiNode *, uint32_t> sceneNodeIndices =
         LoadSceneNodes(sceneBuilder, scene, nodes);
@@ -1109,6 +1201,81 @@ SceneBuilder &SceneImporter::AddFile(
 
     LoadLights(sceneBuilder, scene, sceneNodeIndices);
     LoadCameras(sceneBuilder, scene, sceneNodeIndices);
+}
+
+}
+
+SceneBuilder &SceneImporter::AddFile(
+    SceneBuilder &sceneBuilder, const std::filesystem::path &path, TextureMapping textureMapping,
+    std::vector<std::filesystem::path> *dependencies
+)
+{
+    Application::ResetBackgroundTask(BackgroundTaskType::SceneImport);
+    Application::AddBackgroundTask(BackgroundTaskType::SceneImport, 2 * AssimpTaskCount);
+
+    logger::info("Loading Scene {}", path.string());
+    Timer timer("Scene Load");
+
+    const aiScene *scene = nullptr;
+    {
+        Timer timer("File Import");
+        scene = ReadFile(*s_Importer, path, dependencies);
+
+        if (scene == nullptr)
+            throw error(s_Importer->GetErrorString());
+    }
+
+    LoadScene(sceneBuilder, path, scene, textureMapping);
+
+    return sceneBuilder;
+}
+
+SceneBuilder &SceneImporter::AddFiles(
+    SceneBuilder &sceneBuilder, std::span<const std::filesystem::path> paths, TextureMapping textureMapping,
+    std::vector<std::filesystem::path> *dependencies
+)
+{
+    if (paths.size() == 1)
+        return AddFile(sceneBuilder, paths.front(), textureMapping, dependencies);
+
+    Application::ResetBackgroundTask(BackgroundTaskType::SceneImport);
+    Application::AddBackgroundTask(BackgroundTaskType::SceneImport, 2 * AssimpTaskCount * paths.size());
+
+    for (const auto &path : paths)
+        logger::info("Loading Scene {}", path.string());
+    Timer timer("Scene Load");
+
+    // Every file is parsed concurrently by its own importer
+    std::vector<std::unique_ptr<Assimp::Importer>> importers(paths.size());
+    std::vector<const aiScene *> scenes(paths.size());
+    std::vector<std::vector<std::filesystem::path>> fileDependencies(paths.size());
+    {
+        Timer timer("File Import");
+
+        ThreadDispatch<uint32_t> dispatch(std::min<uint32_t>(GetImportThreadCount(), paths.size()));
+        dispatch.DispatchBlocking(
+            paths.size(), [&](uint32_t threadId, uint32_t index, std::stop_token stopToken) {
+                importers[index] = std::make_unique<Assimp::Importer>();
+                auto *indexDependencies = dependencies != nullptr ? &fileDependencies[index] : nullptr;
+                scenes[index] = ReadFile(*importers[index], paths[index], indexDependencies);
+            }
+        );
+    }
+
+    // The scenes are merged in order, textures and materials shared by the files are added only once
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (scenes[i] == nullptr)
+            throw error(importers[i]->GetErrorString());
+
+        LoadScene(sceneBuilder, paths[i], scenes[i], textureMapping);
+
+        if (dependencies != nullptr)
+            dependencies->insert(dependencies->end(), fileDependencies[i].begin(), fileDependencies[i].end());
+
+        // The scene is owned by the importer, release it as soon as it's merged
+        importers[i].reset();
+    }
 
     return sceneBuilder;
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <filesystem>
+#include <span>
 #include <variant>
+#include <vector>
 
 #include "Scene.h"
 
@@ -41,8 +43,16 @@ public:
     static void Init();
     static void Shutdown();
 
+    // Every file read during the import is appended to dependencies if it's set
     static SceneBuilder &AddFile(
-        SceneBuilder &builder, const std::filesystem::path &path, TextureMapping mapping = std::monostate()
+        SceneBuilder &builder, const std::filesystem::path &path, TextureMapping mapping = std::monostate(),
+        std::vector<std::filesystem::path> *dependencies = nullptr
+    );
+
+    // Parses the files concurrently and adds them to the builder in the given order
+    static SceneBuilder &AddFiles(
+        SceneBuilder &builder, std::span<const std::filesystem::path> paths,
+        TextureMapping mapping = std::monostate(), std::vector<std::filesystem::path> *dependencies = nullptr
     );
 };
 
@@ -2,6 +2,7 @@
 
 #include "Application.h"
 #include "ExampleScenes.h"
+#include "SceneCache.h"
 #include "SceneManager.h"
 #include "TextureImporter.h"
 
@@ -46,8 +47,12 @@ bool CombinedSceneLoader::HasContent() const
 
 void CombinedSceneLoader::Load(SceneBuilder &sceneBuilder)
 {
-    for (const auto &path : m_ComponentPaths)
-        SceneImporter::AddFile(sceneBuilder, path, m_TextureMapping);
+    if (!m_ComponentPaths.empty() && !SceneCache::Load(sceneBuilder, m_ComponentPaths, m_TextureMapping))
+    {
+        std::vector<std::filesystem::path> dependencies = {};
+        SceneImporter::AddFiles(sceneBuilder, m_ComponentPaths, m_TextureMapping, &dependencies);
+        SceneCache::Save(sceneBuilder, m_ComponentPaths, m_TextureMapping, dependencies);
+    }
 
     if (m_SkyboxPath.has_value())
     {
@@ -24,29 +24,114 @@ vec3 computeBarycentricCoords(vec3 attribs)
     return vec3(1.0f - attribs.x - attribs.y, attribs.x, attribs.y);
 }
 
-Vertex getVertex(VertexBuffer vertices, IndexBuffer indices, uint offset)
+// Vertex streams are read as float arrays, these are the vertex sizes in floats
+const uint PositionStride = 3;
+const uint VertexAttributesStride = 11;
+const uint PackedVertexAttributesStride = 3;
+
+// Animated vertex buffers are read as vec2 arrays
+const uint PackedAnimatedVertexStride = 5;
+
+// https://jcgt.org/published/0003/02/01/
+vec2 encodeOctahedral(vec3 v)
+{
+    const vec2 p = v.xy / max(abs(v.x) + abs(v.y) + abs(v.z), 1e-20f);
+    const vec2 signs = vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    return v.z >= 0.0f ? p : (1.0f - abs(p.yx)) * signs;
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    const float t = max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+    return normalize(v);
+}
+
+vec3 getPosition(PositionBuffer positions, uint index)
+{
+    return vec3(
+        positions.v[index * PositionStride], positions.v[index * PositionStride + 1],
+        positions.v[index * PositionStride + 2]
+    );
+}
+
+void getPackedAttributes(inout Vertex v, AttributeBuffer attributes, uint index)
 {
-    const uint index = indices.v[offset];
-    const vec2 p1 = vertices.v[index * 7];
-    const vec2 p2 = vertices.v[index * 7 + 1];
-    const vec2 p3 = vertices.v[index * 7 + 2];
-    const vec2 p4 = vertices.v[index * 7 + 3];
-    const vec2 p5 = vertices.v[index * 7 + 4];
-    const vec2 p6 = vertices.v[index * 7 + 5];
-    const vec2 p7 = vertices.v[index * 7 + 6];
+    const uint texCoords = floatBitsToUint(attributes.v[index * PackedVertexAttributesStride]);
+    const uint normal = floatBitsToUint(attributes.v[index * PackedVertexAttributesStride + 1]);
+    const uint tangent = floatBitsToUint(attributes.v[index * PackedVertexAttributesStride + 2]);
+
+    v.TexCoords = unpackHalf2x16(texCoords);
+    v.Normal = decodeOctahedral(unpackSnorm2x16(normal));
+    v.Tangent = decodeOctahedral(unpackSnorm2x16(tangent));
+    v.Bitangent = ((tangent & 1u) != 0u ? -1.0f : 1.0f) * cross(v.Normal, v.Tangent);
+}
+
+// Short indices are packed two per word, the first one in the low half
+uint getIndex(IndexBuffer indices, uint indexType, uint offset)
+{
+    if (indexType == IndexTypeUint32)
+        return indices.v[offset];
+
+    const uint word = indices.v[offset >> 1];
+    return (offset & 1u) == 0u ? word & 0xffffu : word >> 16;
+}
+
+Vertex getVertex(PositionBuffer positions, AttributeBuffer attributes, IndexBuffer indices, uint indexType, uint offset, bool isPacked)
+{
+    const uint index = getIndex(indices, indexType, offset);
 
     Vertex v;
+    v.Position = getPosition(positions, index);
+
+    if (isPacked)
+    {
+        getPackedAttributes(v, attributes, index);
+        return v;
+    }
+
+    const uint base = index * VertexAttributesStride;
+    v.TexCoords = vec2(attributes.v[base], attributes.v[base + 1]);
+    v.Normal = vec3(attributes.v[base + 2], attributes.v[base + 3], attributes.v[base + 4]);
+    v.Tangent = vec3(attributes.v[base + 5], attributes.v[base + 6], attributes.v[base + 7]);
+    v.Bitangent = vec3(attributes.v[base + 8], attributes.v[base + 9], attributes.v[base + 10]);
+
+    return v;
+}
+
+AnimatedVertex getPackedAnimatedVertex(AnimatedVertexBuffer vertices, uint index)
+{
+    const vec2 p1 = vertices.v[index * PackedAnimatedVertexStride];
+    const vec2 p2 = vertices.v[index * PackedAnimatedVertexStride + 1];
+    const vec2 p3 = vertices.v[index * PackedAnimatedVertexStride + 2];
+    const uvec2 boneIndices = floatBitsToUint(vertices.v[index * PackedAnimatedVertexStride + 3]);
+    const uvec2 boneWeights = floatBitsToUint(vertices.v[index * PackedAnimatedVertexStride + 4]);
+
+    const uint tangent = floatBitsToUint(p3.y);
+    const vec2 weights1 = unpackUnorm2x16(boneWeights.x);
+    const vec2 weights2 = unpackUnorm2x16(boneWeights.y);
+
+    AnimatedVertex v;
     v.Position = vec3(p1, p2.x);
-    v.TexCoords = vec2(p2.y, p3.x);
-    v.Normal = vec3(p3.y, p4);
-    v.Tangent = vec3(p5, p6.x);
-    v.Bitangent = vec3(p6.y, p7);
+    v.TexCoords = unpackHalf2x16(floatBitsToUint(p2.y));
+    v.Normal = decodeOctahedral(unpackSnorm2x16(floatBitsToUint(p3.x)));
+    v.Tangent = decodeOctahedral(unpackSnorm2x16(tangent));
+    v.Bitangent = ((tangent & 1u) != 0u ? -1.0f : 1.0f) * cross(v.Normal, v.Tangent);
+    v.BoneIndices = uint[4](
+        boneIndices.x & 0xffffu, boneIndices.x >> 16, boneIndices.y & 0xffffu, boneIndices.y >> 16
+    );
+    v.BoneWeights = float[4](weights1.x, weights1.y, weights2.x, weights2.y);
 
     return v;
 }
 
-AnimatedVertex getAnimatedVertex(AnimatedVertexBuffer vertices, uint index)
+AnimatedVertex getAnimatedVertex(AnimatedVertexBuffer vertices, uint index, bool isPacked)
 {
+    if (isPacked)
+        return getPackedAnimatedVertex(vertices, index);
+
     const vec2 p1 = vertices.v[index * 11];
     const vec2 p2 = vertices.v[index * 11 + 1];
     const vec2 p3 = vertices.v[index * 11 + 2];
@@ -71,32 +156,50 @@ AnimatedVertex getAnimatedVertex(AnimatedVertexBuffer vertices, uint index)
     return v;
 }
 
-void writeVertex(VertexWriteBuffer vertices, uint index, Vertex vertex)
+void writePackedAttributes(AttributeWriteBuffer attributes, uint index, Vertex vertex)
 {
-    const vec2 p1 = vertex.Position.xy;
-    const vec2 p2 = vec2(vertex.Position.z, vertex.TexCoords.x);
-    const vec2 p3 = vec2(vertex.TexCoords.y, vertex.Normal.x);
-    const vec2 p4 = vertex.Normal.yz;
-    const vec2 p5 = vertex.Tangent.xy;
-    const vec2 p6 = vec2(vertex.Tangent.z, vertex.Bitangent.x);
-    const vec2 p7 = vec2(vertex.Bitangent.yz);
+    const bool isBitangentFlipped = dot(cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f;
+    const uint tangent = (packSnorm2x16(encodeOctahedral(vertex.Tangent)) & ~1u) | uint(isBitangentFlipped);
+
+    attributes.v[index * PackedVertexAttributesStride] = uintBitsToFloat(packHalf2x16(vertex.TexCoords));
+    attributes.v[index * PackedVertexAttributesStride + 1] =
+        uintBitsToFloat(packSnorm2x16(encodeOctahedral(vertex.Normal)));
+    attributes.v[index * PackedVertexAttributesStride + 2] = uintBitsToFloat(tangent);
+}
+
+void writeVertex(PositionWriteBuffer positions, AttributeWriteBuffer attributes, uint index, Vertex vertex, bool isPacked)
+{
+    positions.v[index * PositionStride] = vertex.Position.x;
+    positions.v[index * PositionStride + 1] = vertex.Position.y;
+    positions.v[index * PositionStride + 2] = vertex.Position.z;
+
+    if (isPacked)
+    {
+        writePackedAttributes(attributes, index, vertex);
+        return;
+    }
 
-    vertices.v[index * 7] = p1;
-    vertices.v[index * 7 + 1] = p2;
-    vertices.v[index * 7 + 2] = p3;
-    vertices.v[index * 7 + 3] = p4;
-    vertices.v[index * 7 + 4] = p5;
-    vertices.v[index * 7 + 5] = p6;
-    vertices.v[index * 7 + 6] = p7;
+    const uint base = index * VertexAttributesStride;
+    attributes.v[base] = vertex.TexCoords.x;
+    attributes.v[base + 1] = vertex.TexCoords.y;
+    attributes.v[base + 2] = vertex.Normal.x;
+    attributes.v[base + 3] = vertex.Normal.y;
+    attributes.v[base + 4] = vertex.Normal.z;
+    attributes.v[base + 5] = vertex.Tangent.x;
+    attributes.v[base + 6] = vertex.Tangent.y;
+    attributes.v[base + 7] = vertex.Tangent.z;
+    attributes.v[base + 8] = vertex.Bitangent.x;
+    attributes.v[base + 9] = vertex.Bitangent.y;
+    attributes.v[base + 10] = vertex.Bitangent.z;
 }
 
-vec2 getTexCoords(VertexBuffer vertices, IndexBuffer indices, uint offset)
+vec2 getTexCoords(AttributeBuffer attributes, IndexBuffer indices, uint indexType, uint offset, bool isPacked)
 {
-    const uint index = indices.v[offset];
-    const float p2 = vertices.v[index * 7 + 1].y;
-    const float p3 = vertices.v[index * 7 + 2].x;
+    const uint index = getIndex(indices, indexType, offset);
+    if (isPacked)
+        return unpackHalf2x16(floatBitsToUint(attributes.v[index * PackedVertexAttributesStride]));
 
-    return vec2(p2, p3);
+    return vec2(attributes.v[index * VertexAttributesStride], attributes.v[index * VertexAttributesStride + 1]);
 }
 
 vec2 interpolate(vec2 v1, vec2 v2, vec2 v3, vec3 barycentricCoords)
@@ -121,11 +224,12 @@ Vertex interpolate(Vertex v1, Vertex v2, Vertex v3, vec3 barycentricCoords)
     return v;
 }
 
-Vertex getInterpolatedVertex(VertexBuffer vertices, IndexBuffer indices, uint indexOffset, vec3 barycentricCoords)
+Vertex getInterpolatedVertex(PositionBuffer positions, AttributeBuffer attributes, IndexBuffer indices, uint indexType, uint indexOffset, vec3 barycentricCoords, bool isPacked)
 {
     return interpolate(
-        getVertex(vertices, indices, indexOffset), getVertex(vertices, indices, indexOffset + 1),
-        getVertex(vertices, indices, indexOffset + 2), barycentricCoords
+        getVertex(positions, attributes, indices, indexType, indexOffset, isPacked),
+        getVertex(positions, attributes, indices, indexType, indexOffset + 1, isPacked),
+        getVertex(positions, attributes, indices, indexType, indexOffset + 2, isPacked), barycentricCoords
     );
 }
 
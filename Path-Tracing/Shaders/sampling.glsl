@@ -9,7 +9,9 @@ Vertex transform(Vertex vertex, uint transformIndex)
     vertex.Position = vec4(vertex.Position, 1.0f) * transform;
     vertex.Tangent = normalize(vec4(vertex.Tangent, 0.0f) * transform);
     vertex.Bitangent = normalize(vec4(vertex.Bitangent, 0.0f) * transform);
-    vertex.Normal = normalize((vec4(vertex.Normal, 0.0f) * transpose(inverse(mat4(transform)))).xyz);  // TODO: Calculate inverse on the CPU
+    // The inverse transpose of the instance transform is the transpose of gl_WorldToObject3x4EXT
+    const vec3 normal = vec4(vertex.Normal, 0.0f) * normalMatrices[transformIndex];
+    vertex.Normal = normalize((gl_WorldToObject3x4EXT * normal).xyz);
 
     return vertex;
 }
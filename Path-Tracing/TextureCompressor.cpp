@@ -0,0 +1,395 @@
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TEXTURE_COMPRESSOR_SSE
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "Core/Core.h"
+
+#include "TextureCompressor.h"
+
+namespace PathTracing
+{
+
+namespace
+{
+
+static inline constexpr uint32_t BlockExtent = 4;
+static inline constexpr uint32_t PowerIterationCount = 8;
+
+using Block = std::array<glm::u8vec4, BlockExtent * BlockExtent>;
+using BlockChannel = std::array<float, BlockExtent * BlockExtent>;
+using BlockChannels = std::array<BlockChannel, 4>;
+using BlockSteps = std::array<uint8_t, BlockExtent * BlockExtent>;
+
+struct ColorEndpoints
+{
+    uint16_t Color0;
+    uint16_t Color1;
+};
+
+size_t GetBlockSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::BC1:
+        return 8;
+    case TextureFormat::BC3:
+    case TextureFormat::BC5:
+        return 16;
+    default:
+        throw error("Unsupported texture format");
+    }
+}
+
+Block LoadBlock(
+    std::span<const glm::u8vec4> texels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY
+)
+{
+    Block block;
+    const uint32_t x = blockX * BlockExtent, y = blockY * BlockExtent;
+
+    if (x + BlockExtent <= width && y + BlockExtent <= height)
+    {
+        for (uint32_t row = 0; row < BlockExtent; row++)
+            std::memcpy(
+                &block[row * BlockExtent], &texels[(y + row) * width + x], BlockExtent * sizeof(glm::u8vec4)
+            );
+        return block;
+    }
+
+    for (uint32_t row = 0; row < BlockExtent; row++)
+        for (uint32_t column = 0; column < BlockExtent; column++)
+        {
+            const uint32_t sourceX = std::min(x + column, width - 1);
+            const uint32_t sourceY = std::min(y + row, height - 1);
+            block[row * BlockExtent + column] = texels[sourceY * width + sourceX];
+        }
+
+    return block;
+}
+
+void SplitChannels(const Block &block, BlockChannels &channels)
+{
+#ifdef TEXTURE_COMPRESSOR_SSE
+    const __m128i mask = _mm_set1_epi32(0xff);
+    for (uint32_t i = 0; i < block.size(); i += 4)
+    {
+        const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&block[i]));
+        _mm_storeu_ps(&channels[0][i], _mm_cvtepi32_ps(_mm_and_si128(texels, mask)));
+        _mm_storeu_ps(&channels[1][i], _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), mask)));
+        _mm_storeu_ps(&channels[2][i], _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), mask)));
+        _mm_storeu_ps(&channels[3][i], _mm_cvtepi32_ps(_mm_srli_epi32(texels, 24)));
+    }
+#else
+    for (uint32_t i = 0; i < block.size(); i++)
+        for (uint32_t channel = 0; channel < channels.size(); channel++)
+            channels[channel][i] = block[i][channel];
+#endif
+}
+
+glm::vec2 GetRange(const BlockChannel &values)
+{
+#ifdef TEXTURE_COMPRESSOR_SSE
+    __m128 low = _mm_loadu_ps(&values[0]);
+    __m128 high = low;
+    for (uint32_t i = 4; i < values.size(); i += 4)
+    {
+        const __m128 value = _mm_loadu_ps(&values[i]);
+        low = _mm_min_ps(low, value);
+        high = _mm_max_ps(high, value);
+    }
+
+    low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(2, 3, 0, 1)));
+    low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 0, 3, 2)));
+    high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(2, 3, 0, 1)));
+    high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    return glm::vec2(_mm_cvtss_f32(low), _mm_cvtss_f32(high));
+#else
+    const auto [low, high] = std::minmax_element(values.begin(), values.end());
+    return glm::vec2(*low, *high);
+#endif
+}
+
+// Distance of every texel from the origin along the direction, the direction isn't normalized
+void Project(const BlockChannels &channels, glm::vec3 origin, glm::vec3 direction, BlockChannel &distances)
+{
+#ifdef TEXTURE_COMPRESSOR_SSE
+    const __m128 originR = _mm_set1_ps(origin.r), directionR = _mm_set1_ps(direction.r);
+    const __m128 originG = _mm_set1_ps(origin.g), directionG = _mm_set1_ps(direction.g);
+    const __m128 originB = _mm_set1_ps(origin.b), directionB = _mm_set1_ps(direction.b);
+    for (uint32_t i = 0; i < distances.size(); i += 4)
+    {
+        const __m128 r = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels[0][i]), originR), directionR);
+        const __m128 g = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels[1][i]), originG), directionG);
+        const __m128 b = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels[2][i]), originB), directionB);
+        _mm_storeu_ps(&distances[i], _mm_add_ps(_mm_add_ps(r, g), b));
+    }
+#else
+    for (uint32_t i = 0; i < distances.size(); i++)
+    {
+        const glm::vec3 color(channels[0][i], channels[1][i], channels[2][i]);
+        distances[i] = glm::dot(color - origin, direction);
+    }
+#endif
+}
+
+// Rounds `value * scale + offset` to the closest step between 0 and maxStep
+void Quantize(const BlockChannel &values, float scale, float offset, float maxStep, BlockSteps &steps)
+{
+#ifdef TEXTURE_COMPRESSOR_SSE
+    const __m128 scales = _mm_set1_ps(scale), offsets = _mm_set1_ps(offset);
+    const __m128 zero = _mm_setzero_ps(), maxSteps = _mm_set1_ps(maxStep);
+
+    auto quantizeRow = [&](uint32_t row) {
+        const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&values[4 * row]), scales), offsets);
+        return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(value, zero), maxSteps));
+    };
+
+    const __m128i packed = _mm_packus_epi16(
+        _mm_packs_epi32(quantizeRow(0), quantizeRow(1)), _mm_packs_epi32(quantizeRow(2), quantizeRow(3))
+    );
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(steps.data()), packed);
+#else
+    for (uint32_t i = 0; i < steps.size(); i++)
+    {
+        const float value = std::clamp(values[i] * scale + offset, 0.0f, maxStep);
+        steps[i] = static_cast<uint8_t>(std::nearbyint(value));
+    }
+#endif
+}
+
+uint16_t ToRgb565(glm::vec3 color)
+{
+    const glm::uvec3 quantized(
+        glm::round(glm::clamp(color, 0.0f, 255.0f) * glm::vec3(31.0f, 63.0f, 31.0f) / 255.0f)
+    );
+    return static_cast<uint16_t>((quantized.r << 11) | (quantized.g << 5) | quantized.b);
+}
+
+glm::vec3 FromRgb565(uint16_t color)
+{
+    const uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// Steps are the positions of texels between the two endpoints, they are mapped to indices when writing
+float FitColorSteps(
+    const BlockChannels &channels, glm::vec3 start, glm::vec3 end, ColorEndpoints &endpoints,
+    BlockSteps &steps
+)
+{
+    endpoints = { ToRgb565(start), ToRgb565(end) };
+    const glm::vec3 color0 = FromRgb565(endpoints.Color0), color1 = FromRgb565(endpoints.Color1);
+
+    const glm::vec3 direction = color1 - color0;
+    const float lengthSquared = glm::dot(direction, direction);
+
+    BlockChannel distances;
+    Project(channels, color0, lengthSquared > 0.0f ? direction / lengthSquared : glm::vec3(0.0f), distances);
+    Quantize(distances, 3.0f, 0.0f, 3.0f, steps);
+
+    float error = 0.0f;
+    for (uint32_t i = 0; i < steps.size(); i++)
+    {
+        const glm::vec3 color(channels[0][i], channels[1][i], channels[2][i]);
+        const glm::vec3 difference = color - glm::mix(color0, color1, steps[i] / 3.0f);
+        error += glm::dot(difference, difference);
+    }
+
+    return error;
+}
+
+// Least squares fit of the endpoints to the texels, given the steps that were selected for them
+bool RefineColorEndpoints(
+    const BlockChannels &channels, const BlockSteps &steps, glm::vec3 &start, glm::vec3 &end
+)
+{
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    glm::vec3 x0(0.0f), x1(0.0f);
+    for (uint32_t i = 0; i < steps.size(); i++)
+    {
+        const glm::vec3 color(channels[0][i], channels[1][i], channels[2][i]);
+        const float weight = steps[i] / 3.0f;
+
+        a += (1.0f - weight) * (1.0f - weight);
+        b += (1.0f - weight) * weight;
+        c += weight * weight;
+        x0 += (1.0f - weight) * color;
+        x1 += weight * color;
+    }
+
+    const float determinant = a * c - b * b;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+
+    start = (c * x0 - b * x1) / determinant;
+    end = (a * x1 - b * x0) / determinant;
+    return true;
+}
+
+void WriteColorBlock(ColorEndpoints endpoints, BlockSteps &steps, std::byte *block)
+{
+    // The first color has to be greater, otherwise the block is decoded with 3 colors and transparency
+    if (endpoints.Color0 < endpoints.Color1)
+    {
+        std::swap(endpoints.Color0, endpoints.Color1);
+        for (uint8_t &step : steps)
+            step = 3 - step;
+    }
+
+    static constexpr std::array<uint32_t, 4> StepIndices = { 0, 2, 3, 1 };
+
+    uint32_t indices = 0;
+    for (uint32_t i = 0; i < steps.size(); i++)
+        indices |= StepIndices[steps[i]] << (2 * i);
+
+    std::memcpy(block, &endpoints.Color0, sizeof(uint16_t));
+    std::memcpy(block + 2, &endpoints.Color1, sizeof(uint16_t));
+    std::memcpy(block + 4, &indices, sizeof(uint32_t));
+}
+
+// Endpoints are the extremes of the colors along their principal axis, refined once by least squares
+void EncodeColorBlock(const BlockChannels &channels, std::byte *block)
+{
+    glm::vec3 low, high, mean(0.0f);
+    for (uint32_t channel = 0; channel < 3; channel++)
+    {
+        const glm::vec2 range = GetRange(channels[channel]);
+        low[channel] = range.x;
+        high[channel] = range.y;
+    }
+
+    for (uint32_t i = 0; i < channels[0].size(); i++)
+        mean += glm::vec3(channels[0][i], channels[1][i], channels[2][i]);
+    mean /= static_cast<float>(channels[0].size());
+
+    ColorEndpoints endpoints;
+    BlockSteps steps;
+
+    if (high == low)
+    {
+        FitColorSteps(channels, mean, mean, endpoints, steps);
+        WriteColorBlock(endpoints, steps, block);
+        return;
+    }
+
+    glm::mat3 covariance(0.0f);
+    for (uint32_t i = 0; i < channels[0].size(); i++)
+    {
+        const glm::vec3 difference = glm::vec3(channels[0][i], channels[1][i], channels[2][i]) - mean;
+        covariance += glm::outerProduct(difference, difference);
+    }
+
+    // The extent of the channels is orthogonal to the principal axis when channels are anti-correlated
+    // (e.g. red and blue texels), starting from the largest covariance column avoids that
+    glm::vec3 axis = covariance[0];
+    for (uint32_t channel = 1; channel < 3; channel++)
+        if (glm::dot(covariance[channel], covariance[channel]) > glm::dot(axis, axis))
+            axis = covariance[channel];
+
+    for (uint32_t iteration = 0; iteration < PowerIterationCount; iteration++)
+    {
+        const glm::vec3 next = covariance * axis;
+        const float length = glm::max(glm::max(std::abs(next.x), std::abs(next.y)), std::abs(next.z));
+        if (length == 0.0f)
+            break;
+        axis = next / length;
+    }
+    axis = glm::normalize(axis);
+
+    BlockChannel distances;
+    Project(channels, mean, axis, distances);
+    const glm::vec2 extent = GetRange(distances);
+
+    glm::vec3 start = mean + axis * extent.x, end = mean + axis * extent.y;
+    const float error = FitColorSteps(channels, start, end, endpoints, steps);
+
+    ColorEndpoints refinedEndpoints;
+    BlockSteps refinedSteps;
+    if (RefineColorEndpoints(channels, steps, start, end) &&
+        FitColorSteps(channels, start, end, refinedEndpoints, refinedSteps) < error)
+        WriteColorBlock(refinedEndpoints, refinedSteps, block);
+    else
+        WriteColorBlock(endpoints, steps, block);
+}
+
+// Always uses the mode with 8 interpolated values, with the maximum as the first endpoint
+void EncodeChannelBlock(const BlockChannel &values, std::byte *block)
+{
+    const glm::vec2 range = GetRange(values);
+    const uint8_t low = static_cast<uint8_t>(range.x), high = static_cast<uint8_t>(range.y);
+
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        BlockSteps steps;
+        const float scale = 7.0f / (high - low);
+        Quantize(values, -scale, high * scale, 7.0f, steps);
+
+        static constexpr std::array<uint64_t, 8> StepIndices = { 0, 2, 3, 4, 5, 6, 7, 1 };
+        for (uint32_t i = 0; i < steps.size(); i++)
+            indices |= StepIndices[steps[i]] << (3 * i);
+    }
+
+    block[0] = static_cast<std::byte>(high);
+    block[1] = static_cast<std::byte>(low);
+    for (uint32_t i = 0; i < 6; i++)
+        block[2 + i] = static_cast<std::byte>(indices >> (8 * i));
+}
+
+}
+
+size_t TextureCompressor::GetCompressedSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+    const size_t blockCount = static_cast<size_t>((width + BlockExtent - 1) / BlockExtent) *
+                              ((height + BlockExtent - 1) / BlockExtent);
+    return blockCount * GetBlockSize(format);
+}
+
+void TextureCompressor::Compress(
+    TextureFormat format, std::span<const glm::u8vec4> texels, uint32_t width, uint32_t height,
+    std::span<std::byte> blocks
+)
+{
+    assert(texels.size() == static_cast<size_t>(width) * height);
+    assert(blocks.size() == GetCompressedSize(format, width, height));
+
+    const size_t blockSize = GetBlockSize(format);
+    const uint32_t blocksX = (width + BlockExtent - 1) / BlockExtent;
+    const uint32_t blocksY = (height + BlockExtent - 1) / BlockExtent;
+
+    BlockChannels channels;
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            SplitChannels(LoadBlock(texels, width, height, blockX, blockY), channels);
+            std::byte *block = &blocks[(static_cast<size_t>(blockY) * blocksX + blockX) * blockSize];
+
+            switch (format)
+            {
+            case TextureFormat::BC1:
+                EncodeColorBlock(channels, block);
+                break;
+            case TextureFormat::BC3:
+                EncodeChannelBlock(channels[3], block);
+                EncodeColorBlock(channels, block + 8);
+                break;
+            case TextureFormat::BC5:
+                EncodeChannelBlock(channels[0], block);
+                EncodeChannelBlock(channels[1], block + 8);
+                break;
+            default:
+                throw error("Unsupported texture format");
+            }
+        }
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+
+#include "Scene.h"
+
+namespace PathTracing
+{
+
+// Encodes RGBA8 images into the block compressed formats, called from the texture loader threads
+// Every 4x4 block is processed as 4 rows of 4 texels with SSE2 when compiling for x86
+class TextureCompressor
+{
+public:
+    [[nodiscard]] static size_t GetCompressedSize(TextureFormat format, uint32_t width, uint32_t height);
+
+    // Blocks that cross the edge of the image repeat the edge texels
+    static void Compress(
+        TextureFormat format, std::span<const glm::u8vec4> texels, uint32_t width, uint32_t height,
+        std::span<std::byte> blocks
+    );
+};
+
+}
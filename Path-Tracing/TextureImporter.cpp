@@ -3,13 +3,19 @@
 #include <gli/gli.hpp>
 #include <stb_image.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <fstream>
 #include <set>
+#include <thread>
 
+#include "Core/Cache.h"
 #include "Core/Config.h"
 #include "Core/Core.h"
 
 #include "Application.h"
+#include "TextureCompressor.h"
 #include "TextureImporter.h"
 
 namespace PathTracing
@@ -20,35 +26,9 @@ namespace
 
 static inline constexpr TextureInfo::LoaderType StbiLoader = 0;
 static inline constexpr TextureInfo::LoaderType GliLoader = 1;
+static inline constexpr TextureInfo::LoaderType CachedLoader = 2;
 
-void PremultiplyTextureData(const std::string &name, std::span<std::byte> data)
-{
-    // TODO: Remove when mip map generation is moved into a compute shader
-    // Color channels should be premultiplied by the alpha channel between generation of every mip level
-    // Doing full premultiplication only here would give wrong results
-    // Therefore here we only premultiply pixels that have alpha channel of 0
-    // This improves the mip maps around transparency edges and doesn't produce incorrect result
-
-    auto pixels = SpanCast<std::byte, glm::u8vec4>(data);
-    bool warned = false;
-
-    for (auto &pixel : pixels)
-    {
-        if (pixel.a == 0)
-        {
-            pixel.r = 0;
-            pixel.g = 0;
-            pixel.b = 0;
-        }
-        else if (pixel.a != 255 && !warned)
-        {
-            logger::debug(
-                "Texture {} has semi-transparent pixels. Generated mips may contain artifacts", name
-            );
-            warned = true;
-        }
-    }
-}
+static inline constexpr size_t TextureCacheVersion = 3;
 
 TextureFormat ToTextureFormat(gli::format format)
 {
@@ -65,6 +45,23 @@ TextureFormat ToTextureFormat(gli::format format)
     }
 }
 
+gli::format ToGliFormat(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::RGBAU8:
+        return gli::FORMAT_RGBA8_UNORM_PACK8;
+    case TextureFormat::BC1:
+        return gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8;
+    case TextureFormat::BC3:
+        return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+    case TextureFormat::BC5:
+        return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+    default:
+        throw error("Unsupported texture format");
+    }
+}
+
 // TODO: Make a fork of GLI
 TextureInfo GetDDSTextureInfo(const char *Data, size_t Size)
 {
@@ -255,10 +252,19 @@ TextureInfo GetDDSTextureInfo(TextureSourceVariant source)
 
         return GetDDSTextureInfo(buffer.data(), buffer.size());
     }
+    else if (const MemoryTextureSource *src = std::get_if<MemoryTextureSource>(&source))
+        return GetDDSTextureInfo(reinterpret_cast<const char *>(src->data()), src->size_bytes());
     else
         throw error("Unhandled texture source type");
 }
 
+bool IsDDSData(MemoryTextureSource source)
+{
+    static constexpr std::array<uint8_t, 4> magic = { 'D', 'D', 'S', ' ' };
+    return source.size_bytes() > sizeof(gli::detail::dds_header) &&
+           std::equal(magic.begin(), magic.end(), source.begin());
+}
+
 std::optional<TextureInfo> GetTextureInfoGli(TextureSourceVariant source, bool *hasTransparency)
 {
     if (const FileTextureSource *src = std::get_if<FileTextureSource>(&source))
@@ -269,6 +275,16 @@ std::optional<TextureInfo> GetTextureInfoGli(TextureSourceVariant source, bool *
         if (extension.string() == ".dds")
             return GetDDSTextureInfo(source);
     }
+    else if (const MemoryTextureSource *src = std::get_if<MemoryTextureSource>(&source))
+    {
+        // Embedded textures have no extension, so they are recognized by the DDS magic number
+        if (IsDDSData(*src))
+        {
+            if (hasTransparency)
+                *hasTransparency = true;
+            return GetDDSTextureInfo(source);
+        }
+    }
 
     return std::optional<TextureInfo>();
 }
@@ -297,7 +313,7 @@ std::optional<TextureInfo> GetTextureInfoStbi(TextureSourceVariant source, bool
         return std::optional<TextureInfo>();
 
     if (hasTransparency)
-        *hasTransparency = channels == 4;
+        *hasTransparency = channels == 2 || channels == 4;
 
     return TextureInfo {
         .Format = isHdr ? TextureFormat::RGBAF32 : TextureFormat::RGBAU8,
@@ -308,38 +324,53 @@ std::optional<TextureInfo> GetTextureInfoStbi(TextureSourceVariant source, bool
     };
 }
 
-TextureData LoadTextureDataGli(const TextureInfo &info)
+gli::texture LoadGliTexture(const TextureInfo &info)
 {
     if (const FileTextureSource *src = std::get_if<FileTextureSource>(&info.Source))
     {
-        const auto extension = src->extension();
-        if (extension.string() == ".dds")
-        {
-            gli::texture texture = gli::load(src->string());
-            assert(texture.faces() == 1);
-            assert(texture.layers() == 1);
-
-            assert(info.Loader == GliLoader);
-            assert(info.Width == texture.extent().x);
-            assert(info.Height == texture.extent().y);
-            assert(info.Format == ToTextureFormat(texture.format()));
-            assert(info.Levels == texture.levels());
-
-            TextureData data(new std::byte[texture.size()], texture.size());
-
-            size_t offset = 0;
-            for (int level = 0; level < texture.levels(); level++)
-            {
-                const size_t size = texture.size(level);
-                memcpy(data.data() + offset, texture.data(0, 0, level), size);
-                offset += size;
-            }
-
-            return data;
-        }
+        if (src->extension().string() == ".dds")
+            return gli::load(src->string());
+    }
+    else if (const MemoryTextureSource *src = std::get_if<MemoryTextureSource>(&info.Source))
+    {
+        if (IsDDSData(*src))
+            return gli::load(reinterpret_cast<const char *>(src->data()), src->size_bytes());
     }
 
-    throw error(std::format("Could not load texture {}", info.Name));
+    return gli::texture();
+}
+
+TextureData CopyGliTextureData(const gli::texture &texture)
+{
+    TextureData data(new std::byte[texture.size()], texture.size());
+
+    size_t offset = 0;
+    for (int level = 0; level < texture.levels(); level++)
+    {
+        const size_t size = texture.size(level);
+        memcpy(data.data() + offset, texture.data(0, 0, level), size);
+        offset += size;
+    }
+
+    return data;
+}
+
+TextureData LoadTextureDataGli(const TextureInfo &info)
+{
+    gli::texture texture = LoadGliTexture(info);
+    if (texture.empty())
+        throw error(std::format("Could not load texture {}", info.Name));
+
+    assert(texture.faces() == 1);
+    assert(texture.layers() == 1);
+
+    assert(info.Loader == GliLoader);
+    assert(info.Width == texture.extent().x);
+    assert(info.Height == texture.extent().y);
+    assert(info.Format == ToTextureFormat(texture.format()));
+    assert(info.Levels == texture.levels());
+
+    return CopyGliTextureData(texture);
 }
 
 TextureData LoadTextureDataStbi(const TextureInfo &info)
@@ -348,11 +379,14 @@ TextureData LoadTextureDataStbi(const TextureInfo &info)
     std::byte *data;
     size_t size;
 
+    // Cached textures are decoded to RGBA8 and compressed afterwards
+    const bool isHdr = info.Format == TextureFormat::RGBAF32;
+
     if (const FileTextureSource *source = std::get_if<FileTextureSource>(&info.Source))
     {
         const std::string path = source->string();
 
-        if (info.Format == TextureFormat::RGBAF32)
+        if (isHdr)
         {
             data = reinterpret_cast<std::byte *>(stbi_loadf(path.c_str(), &x, &y, &channels, STBI_rgb_alpha));
             size = static_cast<size_t>(x) * y * 4 * sizeof(float);
@@ -365,12 +399,22 @@ TextureData LoadTextureDataStbi(const TextureInfo &info)
     }
     else if (const MemoryTextureSource *source = std::get_if<MemoryTextureSource>(&info.Source))
     {
-        assert(info.Format != TextureFormat::RGBAF32);
+        const int length = static_cast<int>(source->size_bytes());
 
-        data = reinterpret_cast<std::byte *>(
-            stbi_load_from_memory(source->data(), source->size_bytes(), &x, &y, &channels, STBI_rgb_alpha)
-        );
-        size = static_cast<size_t>(x) * y * 4;
+        if (isHdr)
+        {
+            data = reinterpret_cast<std::byte *>(
+                stbi_loadf_from_memory(source->data(), length, &x, &y, &channels, STBI_rgb_alpha)
+            );
+            size = static_cast<size_t>(x) * y * 4 * sizeof(float);
+        }
+        else
+        {
+            data = reinterpret_cast<std::byte *>(
+                stbi_load_from_memory(source->data(), length, &x, &y, &channels, STBI_rgb_alpha)
+            );
+            size = static_cast<size_t>(x) * y * 4 * sizeof(uint8_t);
+        }
     }
     else
         throw error("Unhandled texture source type");
@@ -378,35 +422,383 @@ TextureData LoadTextureDataStbi(const TextureInfo &info)
     if (data == nullptr)
         throw error(std::format("Could not load texture {}: {}", info.Name, stbi_failure_reason()));
 
-    assert(info.Loader == StbiLoader);
+    assert(info.Loader == StbiLoader || info.Loader == CachedLoader);
     assert(info.Width == x);
     assert(info.Height == y);
-    assert(info.Format == TextureFormat::RGBAU8 || info.Format == TextureFormat::RGBAF32);
-
-    if (info.Type == TextureType::Color && channels == 4 && info.Format == TextureFormat::RGBAU8)
-        PremultiplyTextureData(info.Name, std::span(data, size));
+    assert(
+        info.Format == TextureFormat::RGBAU8 || info.Format == TextureFormat::RGBAF32 ||
+        info.Loader == CachedLoader
+    );
 
     return TextureData(data, size);
 }
 
+size_t GetMipChainSize(TextureFormat format, uint32_t width, uint32_t height, uint32_t levels)
+{
+    size_t size = 0;
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        size += format == TextureFormat::RGBAU8 ? static_cast<size_t>(width) * height * sizeof(glm::u8vec4)
+                                                : TextureCompressor::GetCompressedSize(format, width, height);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return size;
+}
+
+bool IsCacheable(const TextureInfo &info)
+{
+    // Skyboxes are uploaded without mips and embedded textures have no file to key the cache with
+    return Application::GetConfig().CacheTextures && info.Loader == StbiLoader &&
+           info.Format == TextureFormat::RGBAU8 && info.Type != TextureType::Skybox &&
+           std::holds_alternative<FileTextureSource>(info.Source);
+}
+
+// Textures are deduplicated by name, so a texture can be sampled for other channels than its type reads
+// Because of that single channel types are not stored as BC4, which would drop the other channels
+TextureFormat GetCompressedFormat(TextureType type, bool hasAlpha)
+{
+    if (type == TextureType::Normal)
+        return TextureFormat::BC5;
+
+    return hasAlpha ? TextureFormat::BC3 : TextureFormat::BC1;
+}
+
+// Cache files are named by their source path, so a changed source replaces its old entry
+std::filesystem::path GetCachePath(const TextureInfo &info)
+{
+    const FileTextureSource &source = std::get<FileTextureSource>(info.Source);
+    const std::string path = std::filesystem::absolute(source).lexically_normal().generic_string();
+
+    // The type is a part of the name, since it decides the color space and alpha weighting of the mips
+    // The format is too, since compression can be disabled
+    const std::array<size_t, 4> key = {
+        std::hash<std::string>()(path),
+        static_cast<size_t>(info.Type),
+        static_cast<size_t>(info.Format),
+        TextureCacheVersion,
+    };
+
+    return Application::GetConfig().TextureCachePath /
+           std::format("{:016x}.dds", FNVHash<std::array<size_t, 4>>()(key));
+}
+
+// The sidecar of a cache file records the source it was generated from
+struct TextureCacheKey
+{
+    uint64_t Size = 0;
+    int64_t ModificationTime = 0;
+    size_t Hash = 0;
+};
+
+std::filesystem::path GetCacheKeyPath(const std::filesystem::path &cachePath)
+{
+    return std::filesystem::path(cachePath).replace_extension("key");
+}
+
+std::optional<TextureCacheKey> ReadCacheKey(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    TextureCacheKey key;
+    if (!file.read(reinterpret_cast<char *>(&key), sizeof(TextureCacheKey)))
+        return std::nullopt;
+
+    return key;
+}
+
+// Loader threads may save the same texture, so files are renamed into place once they are complete
+std::filesystem::path GetTemporaryPath(const std::filesystem::path &path)
+{
+    return path.string() + std::format(".{}", std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+bool MoveIntoPlace(const std::filesystem::path &temporaryPath, const std::filesystem::path &path)
+{
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+        std::filesystem::remove(temporaryPath, error);
+
+    return !error;
+}
+
+void WriteCacheKey(const std::filesystem::path &path, const TextureCacheKey &key)
+{
+    const std::filesystem::path temporaryPath = GetTemporaryPath(path);
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(&key), sizeof(TextureCacheKey));
+        file.close();
+
+        if (!file.good())
+        {
+            logger::warn("Could not write texture cache file {}", path.string());
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+    }
+
+    MoveIntoPlace(temporaryPath, path);
+}
+
+// Color textures are filtered in linear space, like blits of the srgb formats picked by the uploader
+bool IsSrgbTexture(TextureType type)
+{
+    return type == TextureType::Color || type == TextureType::Specular || type == TextureType::Emisive ||
+           type == TextureType::Skybox;
+}
+
+float SrgbToLinear(uint8_t value)
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> table;
+        for (int i = 0; i < table.size(); i++)
+        {
+            const float srgb = i / 255.0f;
+            table[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    return table[value];
+}
+
+float LinearToSrgb(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Alpha weighted filtering premultiplies texels, so transparent texels don't bleed into the color
+void GenerateMip(
+    std::span<const glm::u8vec4> source, uint32_t width, uint32_t height, std::span<glm::u8vec4> mip,
+    bool isSrgb, bool isAlphaWeighted
+)
+{
+    const uint32_t mipWidth = std::max(width / 2, 1u);
+    const uint32_t mipHeight = std::max(height / 2, 1u);
+
+    for (uint32_t y = 0; y < mipHeight; y++)
+        for (uint32_t x = 0; x < mipWidth; x++)
+        {
+            glm::vec3 color(0.0f);
+            float alpha = 0.0f, totalWeight = 0.0f;
+
+            for (uint32_t dy = 0; dy < 2; dy++)
+                for (uint32_t dx = 0; dx < 2; dx++)
+                {
+                    const uint32_t sourceX = std::min(2 * x + dx, width - 1);
+                    const uint32_t sourceY = std::min(2 * y + dy, height - 1);
+                    const glm::u8vec4 texel = source[sourceY * width + sourceX];
+
+                    const glm::vec3 texelColor =
+                        isSrgb
+                            ? glm::vec3(SrgbToLinear(texel.r), SrgbToLinear(texel.g), SrgbToLinear(texel.b))
+                            : glm::vec3(texel) / 255.0f;
+                    const float texelAlpha = texel.a / 255.0f;
+                    const float weight = isAlphaWeighted ? texelAlpha : 1.0f;
+
+                    color += weight * texelColor;
+                    alpha += texelAlpha;
+                    totalWeight += weight;
+                }
+
+            color = totalWeight > 0.0f ? color / totalWeight : glm::vec3(0.0f);
+            const uint8_t mipAlpha = static_cast<uint8_t>(std::round(alpha / 4.0f * 255.0f));
+
+            if (isSrgb)
+                color = glm::vec3(LinearToSrgb(color.r), LinearToSrgb(color.g), LinearToSrgb(color.b));
+
+            mip[y * mipWidth + x] = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f), mipAlpha);
+        }
+}
+
+TextureData GenerateMipChain(const TextureInfo &info, TextureData level)
+{
+    const size_t size = GetMipChainSize(TextureFormat::RGBAU8, info.Width, info.Height, info.Levels);
+    TextureData data(new std::byte[size], size);
+    std::memcpy(data.data(), level.data(), level.size());
+
+    const bool isSrgb = IsSrgbTexture(info.Type);
+    const bool isAlphaWeighted = info.Type == TextureType::Color;
+
+    uint32_t width = info.Width, height = info.Height;
+    size_t offset = 0;
+    for (uint32_t mip = 1; mip < info.Levels; mip++)
+    {
+        const size_t sourceSize = static_cast<size_t>(width) * height * sizeof(glm::u8vec4);
+        auto source = SpanCast<std::byte, const glm::u8vec4>(data.subspan(offset, sourceSize));
+        offset += sourceSize;
+
+        const uint32_t mipWidth = std::max(width / 2, 1u), mipHeight = std::max(height / 2, 1u);
+        const size_t mipSize = static_cast<size_t>(mipWidth) * mipHeight * sizeof(glm::u8vec4);
+        GenerateMip(
+            source, width, height, SpanCast<std::byte, glm::u8vec4>(data.subspan(offset, mipSize)), isSrgb,
+            isAlphaWeighted
+        );
+
+        width = mipWidth;
+        height = mipHeight;
+    }
+
+    return data;
+}
+
+TextureData CompressMipChain(const TextureInfo &info, TextureData mips)
+{
+    const size_t size = GetMipChainSize(info.Format, info.Width, info.Height, info.Levels);
+    TextureData data(new std::byte[size], size);
+
+    uint32_t width = info.Width, height = info.Height;
+    size_t sourceOffset = 0, offset = 0;
+    for (uint32_t mip = 0; mip < info.Levels; mip++)
+    {
+        const size_t sourceSize = static_cast<size_t>(width) * height * sizeof(glm::u8vec4);
+        const size_t mipSize = TextureCompressor::GetCompressedSize(info.Format, width, height);
+        auto source = SpanCast<std::byte, const glm::u8vec4>(mips.subspan(sourceOffset, sourceSize));
+        TextureCompressor::Compress(info.Format, source, width, height, data.subspan(offset, mipSize));
+
+        sourceOffset += sourceSize;
+        offset += mipSize;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return data;
+}
+
+bool SaveCachedTexture(const TextureInfo &info, TextureData data, const std::filesystem::path &path)
+{
+    gli::texture2d texture(ToGliFormat(info.Format), gli::extent2d(info.Width, info.Height), info.Levels);
+
+    size_t offset = 0;
+    for (int level = 0; level < texture.levels(); level++)
+    {
+        const size_t size = texture.size(level);
+        memcpy(texture.data(0, 0, level), data.data() + offset, size);
+        offset += size;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    const std::filesystem::path temporaryPath = GetTemporaryPath(path);
+    if (!gli::save_dds(texture, temporaryPath.string()))
+    {
+        logger::warn("Could not write texture cache file {}", temporaryPath.string());
+        return false;
+    }
+
+    return MoveIntoPlace(temporaryPath, path);
+}
+
+TextureData LoadTextureDataCached(const TextureInfo &info)
+{
+    assert(info.Loader == CachedLoader);
+
+    const FileTextureSource &source = std::get<FileTextureSource>(info.Source);
+    const std::filesystem::path cachePath = GetCachePath(info);
+    const std::filesystem::path keyPath = GetCacheKeyPath(cachePath);
+
+    TextureCacheKey key = { std::filesystem::file_size(source), GetModificationTime(source) };
+    bool isHashed = false;
+
+    // Hits are decided by the size and modification time, the source is only hashed when its time changed
+    const std::optional<TextureCacheKey> cachedKey = ReadCacheKey(keyPath);
+    bool isHit = false;
+    if (cachedKey.has_value() && cachedKey->Size == key.Size)
+    {
+        if (cachedKey->ModificationTime == key.ModificationTime)
+            isHit = true;
+        else
+        {
+            key.Hash = HashFile(source);
+            isHashed = true;
+            isHit = key.Hash == cachedKey->Hash;
+            if (isHit && Application::GetConfig().CacheTextures)
+                WriteCacheKey(keyPath, key);
+        }
+    }
+
+    if (isHit)
+    {
+        gli::texture texture = gli::load(cachePath.string());
+        if (!texture.empty() && texture.format() == ToGliFormat(info.Format) &&
+            texture.extent().x == info.Width && texture.extent().y == info.Height &&
+            texture.levels() == info.Levels && texture.faces() == 1 && texture.layers() == 1)
+            return CopyGliTextureData(texture);
+    }
+
+    // The stale entry is removed, so it doesn't outlive its source when caching is disabled
+    std::error_code error;
+    std::filesystem::remove(keyPath, error);
+    std::filesystem::remove(cachePath, error);
+
+    // Scene caches keep the loader, so a missing texture cache file is regenerated even when disabled
+    TextureData level = LoadTextureDataStbi(info);
+    TextureData data = GenerateMipChain(info, level);
+    stbi_image_free(level.data());
+
+    if (info.Format != TextureFormat::RGBAU8)
+    {
+        TextureData compressed = CompressMipChain(info, data);
+        delete[] data.data();
+        data = compressed;
+    }
+
+    // The sidecar is written last, so it's never newer than the texture it describes
+    if (Application::GetConfig().CacheTextures)
+    {
+        if (!isHashed)
+            key.Hash = HashFile(source);
+        if (SaveCachedTexture(info, data, cachePath))
+            WriteCacheKey(keyPath, key);
+    }
+
+    logger::debug("Generated mips of texture {} on the CPU", info.Name);
+    return data;
+}
+
 }
 
 TextureInfo TextureImporter::GetTextureInfo(
     TextureSourceVariant source, TextureType type, std::string &&name, bool *hasTransparency
 )
 {
-    std::optional<TextureInfo> info = GetTextureInfoGli(source, hasTransparency);
+    bool hasAlpha = false;
+    std::optional<TextureInfo> info = GetTextureInfoGli(source, &hasAlpha);
 
     if (!info.has_value())
-        info = GetTextureInfoStbi(source, hasTransparency);
+        info = GetTextureInfoStbi(source, &hasAlpha);
 
     if (!info.has_value())
         throw error(std::format("Could not get info for texture {}", name));
 
+    if (hasTransparency)
+        *hasTransparency = hasAlpha;
+
     TextureInfo &ret = info.value();
     ret.Type = type;
     ret.Name = std::move(name);
     ret.Source = std::move(source);
+
+    if (IsCacheable(ret))
+    {
+        const uint32_t levels = std::bit_width(std::max(ret.Width, ret.Height));
+        const TextureFormat format = Application::GetConfig().CompressTextures
+                                         ? GetCompressedFormat(ret.Type, hasAlpha)
+                                         : TextureFormat::RGBAU8;
+
+        // The limit applies to the chain that is stored and uploaded, so compressed textures can be larger
+        if (GetMipChainSize(format, ret.Width, ret.Height, levels) <= MaxCachedTextureSize)
+        {
+            ret.Loader = CachedLoader;
+            ret.Levels = levels;
+            ret.Format = format;
+        }
+    }
+
     return ret;
 }
 
@@ -418,6 +810,8 @@ TextureData TextureImporter::LoadTextureData(const TextureInfo &info)
         return LoadTextureDataStbi(info);
     case GliLoader:
         return LoadTextureDataGli(info);
+    case CachedLoader:
+        return LoadTextureDataCached(info);
     default:
         throw error(std::format("Unknown loader texture {}", info.Loader));
     }
@@ -425,7 +819,7 @@ TextureData TextureImporter::LoadTextureData(const TextureInfo &info)
 
 void TextureImporter::ReleaseTextureData(const TextureInfo &info, TextureData &data)
 {
-    assert(info.Loader == StbiLoader || info.Loader == GliLoader);
+    assert(info.Loader == StbiLoader || info.Loader == GliLoader || info.Loader == CachedLoader);
 
     if (info.Loader == StbiLoader)
         stbi_image_free(data.data());
@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "Core/Core.h"
+
 #include "Scene.h"
 
 namespace PathTracing
@@ -13,6 +15,9 @@ public:
     static TextureInfo GetTextureInfo(TextureSourceVariant source, TextureType type, std::string &&name, bool *hasTransparency = nullptr);
     static TextureData LoadTextureData(const TextureInfo &info);
     static void ReleaseTextureData(const TextureInfo &info, TextureData &data);
+
+    // Decoded textures are cached on disk with their full mip chain, so it has to fit a staging buffer
+    static inline constexpr size_t MaxCachedTextureSize = 64_MiB;
 };
 
 }